@@ -0,0 +1,47 @@
+/* gcc -c -o ls_arena.o ls_arena.c 
+ *
+ * See ls_arena.h. */
+
+#include "ls_arena.h"
+/* ====================================================================== */
+
+/* The blocks are aligned as malloc() would align them. */
+#define LS_ARENA_ALIGN (2 * sizeof(void *))
+
+struct ls_arena {
+	/* Offset of the first free byte in 'buf'. */
+	size_t top;
+	char buf[LS_ARENA_SIZE] __attribute__((aligned(LS_ARENA_ALIGN)));
+};
+
+static __thread struct ls_arena arena;
+/* ====================================================================== */
+
+void *
+ls_arena_alloc(size_t size)
+{
+	void *p;
+	
+	size = (size + LS_ARENA_ALIGN - 1) & ~(LS_ARENA_ALIGN - 1);
+	if (size > LS_ARENA_SIZE - arena.top)
+		return NULL;
+	
+	p = &arena.buf[arena.top];
+	arena.top += size;
+	return p;
+}
+
+int
+ls_arena_free(void *p)
+{
+	char *block = p;
+	
+	if (block < arena.buf || block >= arena.buf + LS_ARENA_SIZE)
+		return 0;
+	
+	/* If some of the exits have been skipped (longjmp(), etc.), the 
+	 * blocks of these functions are freed here too. */
+	arena.top = block - arena.buf;
+	return 1;
+}
+/* ====================================================================== */
@@ -0,0 +1,31 @@
+/* Per-thread arena for the local storage of the instrumented functions.
+ *
+ * The local storage is allocated at the entry to each function and freed
+ * at the exit from it, so the blocks are allocated and freed in LIFO 
+ * order within a thread. The arena is a stack of such blocks: allocation
+ * and freeing are just the changes of the top of the stack, with no calls
+ * to the memory allocator and no locks. 
+ *
+ * If the arena is full (deep recursion), ls_arena_alloc() returns NULL
+ * and the caller should allocate the block some other way. */
+
+#ifndef LS_ARENA_H_1706_INCLUDED
+#define LS_ARENA_H_1706_INCLUDED
+
+#include <stddef.h>
+
+/* Size of the arena of each thread, in bytes. */
+#define LS_ARENA_SIZE 16384
+
+/* Allocates a block of 'size' bytes in the arena of the current thread. 
+ * Returns NULL if there is not enough space. The block is not zeroed. */
+void *
+ls_arena_alloc(size_t size);
+
+/* Frees the block 'p' as well as the blocks allocated after it in the 
+ * arena of the current thread. Returns 0 if 'p' is not from that arena 
+ * (in this case, nothing is done), non-zero otherwise. */
+int
+ls_arena_free(void *p);
+
+#endif /* LS_ARENA_H_1706_INCLUDED */
@@ -0,0 +1,170 @@
+/* Microbenchmark for the allocation of the local storage at the function
+ * entry and exit: the per-thread arena (ls_arena.c) vs. malloc() the
+ * handlers used before.
+ *
+ * gcc -O2 -pthread -o ls_bench ls_bench.c ls_arena.c
+ * ./ls_bench [-n <iterations>] [-d <depth>] [-t <threads>]
+ *
+ * Each iteration imitates <depth> nested calls of instrumented functions:
+ * <depth> allocations of the local storage followed by <depth>
+ * deallocations. The time per entry/exit pair is reported. The threads,
+ * if more than one, run the same loop concurrently. With <depth> large
+ * enough to fill the arena, the cost of the fallback to malloc() is seen
+ * too. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ls_arena.h"
+/* ====================================================================== */
+
+/* The same size as struct my_struct in my_funcs.c. */
+#define LS_SIZE (10 * sizeof(unsigned long) + 2 * sizeof(void *))
+
+#define MAX_DEPTH 4096
+
+static unsigned long iterations = 1000000;
+static unsigned int depth = 4;
+static unsigned int nthreads = 1;
+/* ====================================================================== */
+
+/* noinline, so that the compiler does not optimize the pairs away. */
+static __attribute__((noinline)) void *
+entry_malloc(void)
+{
+	return malloc(LS_SIZE);
+}
+
+static __attribute__((noinline)) void
+exit_malloc(void *p)
+{
+	free(p);
+}
+
+static __attribute__((noinline)) void *
+entry_arena(void)
+{
+	void *p = ls_arena_alloc(LS_SIZE);
+	if (p == NULL)
+		p = malloc(LS_SIZE);
+	return p;
+}
+
+static __attribute__((noinline)) void
+exit_arena(void *p)
+{
+	if (!ls_arena_free(p))
+		free(p);
+}
+
+struct bench_ops {
+	const char *name;
+	void *(*entry)(void);
+	void (*exit)(void *);
+};
+
+static struct bench_ops ops[] = {
+	{"malloc", entry_malloc, exit_malloc},
+	{"arena", entry_arena, exit_arena},
+};
+/* ====================================================================== */
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *
+bench_thread(void *arg)
+{
+	struct bench_ops *bops = arg;
+	void *blocks[MAX_DEPTH];
+	unsigned long i;
+	unsigned int j;
+
+	for (i = 0; i < iterations; ++i) {
+		for (j = 0; j < depth; ++j) {
+			blocks[j] = bops->entry();
+			if (blocks[j] == NULL) {
+				fprintf(stderr, "Out of memory.\n");
+				exit(EXIT_FAILURE);
+			}
+			/* Touch the block as the handlers do. */
+			memset(blocks[j], 0, sizeof(void *));
+		}
+		for (j = depth; j > 0; --j)
+			bops->exit(blocks[j - 1]);
+	}
+	return NULL;
+}
+
+/* Returns the time per entry/exit pair, in nanoseconds. */
+static double
+run_bench(struct bench_ops *bops)
+{
+	pthread_t threads[nthreads];
+	unsigned int i;
+	double start;
+
+	start = now();
+	for (i = 0; i < nthreads; ++i) {
+		if (pthread_create(&threads[i], NULL, bench_thread, bops) != 0) {
+			fprintf(stderr, "Failed to create a thread.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (i = 0; i < nthreads; ++i)
+		pthread_join(threads[i], NULL);
+
+	/* The threads run concurrently, so this is the wall time per pair
+	 * made by a single thread. */
+	return (now() - start) * 1e9 / ((double)iterations * depth);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:d:t:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 10);
+			break;
+		case 'd':
+			depth = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			nthreads = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			iterations = 0;
+		}
+	}
+	if (optind != argc || iterations == 0 || depth == 0 ||
+	    depth > MAX_DEPTH || nthreads == 0) {
+		fprintf(stderr,
+	"Usage: %s [-n <iterations>] [-d <depth> (1..%u)] [-t <threads>]\n",
+			argv[0], MAX_DEPTH);
+		return EXIT_FAILURE;
+	}
+
+	printf("Depth %u (%lu byte(s) per thread), %u thread(s), "
+		"arena: %u byte(s) per thread.\n",
+		depth, (unsigned long)(depth * LS_SIZE), nthreads,
+		LS_ARENA_SIZE);
+
+	for (i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+		printf("%-8s %8.2f ns per entry/exit\n", ops[i].name,
+			run_bench(&ops[i]));
+	}
+	return 0;
+}
@@ -1,9 +1,13 @@
 /* gcc -c -o my_funcs.o my_funcs.c */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <unistd.h>
+
+#include "ls_arena.h"
 /* ====================================================================== */
 
 void *
@@ -40,7 +44,11 @@ my_func_dummy_entry(void *func, unsigned int nargs, void **args)
 	struct my_struct *p;
 	unsigned int i;
 	
-	p = malloc(sizeof(struct my_struct));
+	/* If the arena is full, the recursion is likely to be too deep. 
+	 * Fall back to malloc() in this case. */
+	p = ls_arena_alloc(sizeof(struct my_struct));
+	if (p == NULL)
+		p = malloc(sizeof(struct my_struct));
 		
 	printf("[DBG] Function entry, func = %p, nargs = %u, "
 		"my_struct = %p, ret_addr = %p\n",
@@ -82,95 +90,253 @@ my_func_dummy_exit(struct my_struct *p)
 		printf("[DBG] Function exit, my_struct is at %p\n", p);
 	}
 	
-	free(p);
+	if (!ls_arena_free(p))
+		free(p);
 }
 /* ====================================================================== */
 
 /* Handling of memory reads and writes. 
  *
- * pc - address of the instruction somewhere near the place where the event
- * 	occurred;
+ * The plugin places a record for each place in the code where a memory 
+ * event is reported into "kedr_sites" section, read-only. The handlers get
+ * the address of the record, so they need not resolve the return address 
+ * to find the location of the event. The layout must be the same as the 
+ * plugin uses, see build_access_site_type(). 'size' is 0 for the accesses
+ * made by a loop: the size of the area is only known at run time then. */
+struct kedr_access_site {
+	const char *file;
+	const char *func;
+	unsigned int line;
+	unsigned int size;
+	unsigned int is_write;
+};
+
+/* site - the place of the access;
  * addr - address of the accessed memory area; 
  * size - size of the memory area;
- * is_write - non-zero for writes, 0 for reads;
  * ls - pointer to the local storage. */
 static void
-report_memory_event(void *pc, void *addr, unsigned int size, int is_write,
-		    struct my_struct *ls)
+report_memory_event(const struct kedr_access_site *site, void *addr, 
+		    unsigned long size, struct my_struct *ls)
 {
 	printf(
-"[DBG] TID=%lu: memory %s at %p: accessed %u byte(s) starting from %p.\n",
-		ls->pid, (is_write ? "write" : "read"), pc, size, addr);
+"[DBG] TID=%lu: memory %s at %s:%u (%s): accessed %lu byte(s) starting from %p.\n",
+		ls->pid, (site->is_write ? "write" : "read"), site->file,
+		site->line, site->func, size, addr);
+}
+
+void
+my_func_read1(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
+{
+	report_memory_event(site, addr, site->size, ls);
+}
+
+void
+my_func_read2(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
+{
+	report_memory_event(site, addr, site->size, ls);
+}
+
+void
+my_func_read4(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
+{
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read1(void *addr, struct my_struct *ls)
+my_func_read8(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 1, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read2(void *addr, struct my_struct *ls)
+my_func_read16(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 2, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read4(void *addr, struct my_struct *ls)
+my_func_write1(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 4, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read8(void *addr, struct my_struct *ls)
+my_func_write2(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 8, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read16(void *addr, struct my_struct *ls)
+my_func_write4(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 16, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write1(void *addr, struct my_struct *ls)
+my_func_write8(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 1, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write2(void *addr, struct my_struct *ls)
+my_func_write16(void *addr, const struct kedr_access_site *site,
+		struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 2, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
+/* Several adjacent accesses to the same object, merged by the plugin into
+ * one event, or the accesses made by a loop, reported on entry to it. In 
+ * the latter case, 'size' is 0 if the loop makes no accesses. */
 void
-my_func_write4(void *addr, struct my_struct *ls)
+my_func_read_range(void *addr, unsigned long size,
+		const struct kedr_access_site *site, struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 4, 1, ls);
+	if (size == 0)
+		return;
+	report_memory_event(site, addr, size, ls);
 }
 
 void
-my_func_write8(void *addr, struct my_struct *ls)
+my_func_write_range(void *addr, unsigned long size,
+		const struct kedr_access_site *site, struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 8, 1, ls);
+	if (size == 0)
+		return;
+	report_memory_event(site, addr, size, ls);
 }
 
+/* Memory accesses recorded by the instrumented code in batch mode 
+ * ("batch" argument of the plugin). The layout must be the same as the 
+ * plugin uses, see build_access_log_decls(). The actual number of entries
+ * is set by the plugin. */
+struct kedr_access {
+	void *addr;
+	unsigned long size;
+	unsigned int line;
+	unsigned int is_write;
+};
+
+struct kedr_access_log {
+	unsigned long count;
+	struct kedr_access accesses[];
+};
+
+/* Called when the log is full, before function calls and at the exit from
+ * the function. */
 void
-my_func_write16(void *addr, struct my_struct *ls)
+my_func_flush_accesses(struct kedr_access_log *log, struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 16, 1, ls);
+	unsigned long i;
+	
+	for (i = 0; i < log->count; ++i) {
+		struct kedr_access *a = &log->accesses[i];
+		printf(
+"[DBG] TID=%lu: memory %s in %p, line %u: accessed %lu byte(s) starting from %p.\n",
+			ls->pid, (a->is_write ? "write" : "read"), ls->func,
+			a->line, a->size, a->addr);
+	}
+	log->count = 0;
+}
+
+/* -log2(x / 2^32) for x > 0, in 32.32 fixed point. The fractional bits of
+ * the logarithm are found one by one by squaring the mantissa. */
+static uint64_t
+neg_log2_fraction(uint32_t x)
+{
+	unsigned int n = 32 - __builtin_clz(x);
+	uint64_t m = (uint64_t)x << (32 - n); /* m / 2^31 is in [1, 2) */
+	uint64_t frac = 0;
+	int i;
+
+	for (i = 31; i >= 0; --i) {
+		m = (m * m) >> 31;
+		if (m >= (1ULL << 32)) {
+			m >>= 1;
+			frac |= 1ULL << i;
+		}
+	}
+	/* log2(x) = n - 1 + frac */
+	return ((uint64_t)(33 - n) << 32) - frac;
+}
+
+/* Returns a random countdown with geometric distribution: the probability 
+ * that it is greater than k is (1 - 1/period)^k. This is what reporting 
+ * each event with probability 1/period independently gives. The 
+ * distribution is memoryless, so restarting the countdown at each call of
+ * an instrumented function does not change the rate, whatever the number
+ * of events in the calls. 'rnd' is a random 32-bit value. */
+static unsigned long
+geometric_countdown(unsigned long period, uint32_t rnd)
+{
+	/* -log2(1 - 1/period), rounded down to 32 bits of the fraction. */
+	uint32_t q = (uint32_t)((((uint64_t)(period - 1)) << 32) / period);
+	uint64_t denom = neg_log2_fraction(q != 0 ? q : 1);
+
+	if (denom == 0)
+		return ULONG_MAX; /* period is too large to tell from 1 - 0 */
+	
+	/* -log2(U) / -log2(1 - 1/period) with U uniform in (0, 1]. */
+	return 1 + (unsigned long)(neg_log2_fraction(rnd != 0 ? rnd : 1) / denom);
+}
+
+/* Sampling mode ("sample" argument of the plugin). The instrumented code 
+ * reports a memory event only when its countdown reaches 0, then it asks 
+ * for the next countdown here. Each event is reported with probability
+ * 1/sample_period, see geometric_countdown(). The countdown starts anew 
+ * in each call of an instrumented function.
+ *
+ * The period may be changed at any time with my_func_set_sample_period(),
+ * the initial value is taken from KEDR_SAMPLE_PERIOD environment variable
+ * if it is set. Period 1 means each event is reported. */
+#define DEFAULT_SAMPLE_PERIOD 100
+
+static volatile unsigned long sample_period = DEFAULT_SAMPLE_PERIOD;
+
+/* State of the random number generator, per thread. */
+static __thread unsigned int sample_seed;
+
+void
+my_func_set_sample_period(unsigned long period)
+{
+	sample_period = (period != 0 ? period : 1);
+}
+
+static __attribute__((constructor)) void
+init_sample_period(void)
+{
+	const char *value = getenv("KEDR_SAMPLE_PERIOD");
+	if (value != NULL)
+		my_func_set_sample_period(strtoul(value, NULL, 10));
+}
+
+unsigned long
+my_func_sample_countdown(struct my_struct *ls)
+{
+	unsigned long period = sample_period;
+	
+	if (period <= 1)
+		return 1;
+	
+	if (sample_seed == 0) {
+		sample_seed = (unsigned int)ls->pid ^ 
+			(unsigned int)(unsigned long)&sample_seed;
+	}
+	
+	/* rand_r() gives at most 31 random bits. */
+	return geometric_countdown(period, 
+		((uint32_t)rand_r(&sample_seed) << 16) ^ 
+		(uint32_t)rand_r(&sample_seed));
 }
 /* ====================================================================== */
 
@@ -5,7 +5,7 @@ PWD=$(shell pwd)
 
 all: ${module_name}.ko
 
-${module_name}.ko: cfake.c cfake.h my_funcs.c
+${module_name}.ko: cfake.c cfake.h my_funcs.c ls_arena.c ls_arena.h
 	$(MAKE) -C ${KBUILD_DIR} M=${PWD} modules
 
 clean:
@@ -0,0 +1,115 @@
+/* See ls_arena.h. */
+
+#include <linux/kernel.h>
+#include <linux/compiler.h>
+#include <linux/hardirq.h>
+#include <linux/hash.h>
+#include <linux/sched.h>
+
+#include "ls_arena.h"
+/* ====================================================================== */
+
+#define LS_ARENA_ALIGN sizeof(unsigned long long)
+
+struct ls_arena {
+	/* Offset of the first free byte in 'buf'. */
+	size_t top;
+	char buf[LS_ARENA_SIZE] __aligned(LS_ARENA_ALIGN);
+};
+
+static struct ls_arena arenas[LS_NR_ARENAS];
+
+/* ls_owners[i] is the task that uses arenas[i], NULL if the arena is
+ * free. The owners are kept apart from the arenas so that looking for 
+ * the arena of a task touches only a few cache lines. */
+static struct task_struct *ls_owners[LS_NR_ARENAS];
+/* ====================================================================== */
+
+/* Returns the index of the arena of the task, takes a free arena if the
+ * task has none. Returns -1 if there are no free arenas. 
+ *
+ * Only the task itself may take or return its arena, so the arena found
+ * here cannot be taken by another task in the meantime. */
+static int
+ls_arena_get(struct task_struct *task)
+{
+	unsigned int start = hash_ptr(task, LS_ARENA_BITS);
+	unsigned int i;
+	int free_idx = -1;
+	
+	/* The arena taken by the task is likely to be at the place 
+	 * determined by the hash or close to it. */
+	for (i = 0; i < LS_NR_ARENAS; ++i) {
+		unsigned int idx = (start + i) & (LS_NR_ARENAS - 1);
+		struct task_struct *owner = ACCESS_ONCE(ls_owners[idx]);
+		
+		if (owner == task)
+			return idx;
+		if (owner == NULL && free_idx == -1)
+			free_idx = idx;
+	}
+	
+	if (free_idx == -1)
+		return -1;
+	
+	for (i = 0; i < LS_NR_ARENAS; ++i) {
+		unsigned int idx = (free_idx + i) & (LS_NR_ARENAS - 1);
+		if (cmpxchg(&ls_owners[idx], NULL, task) == NULL)
+			return idx;
+	}
+	return -1;
+}
+
+void *
+ls_arena_alloc(size_t size)
+{
+	struct ls_arena *arena;
+	void *p;
+	int idx;
+	
+	/* An interrupt handler could take or return the arena of the 
+	 * interrupted task while the latter is changing it. */
+	if (in_interrupt())
+		return NULL;
+	
+	idx = ls_arena_get(current);
+	if (idx < 0)
+		return NULL;
+	arena = &arenas[idx];
+	
+	size = ALIGN(size, LS_ARENA_ALIGN);
+	if (size > LS_ARENA_SIZE - arena->top) {
+		if (arena->top == 0)
+			cmpxchg(&ls_owners[idx], current, NULL);
+		return NULL;
+	}
+	
+	p = &arena->buf[arena->top];
+	arena->top += size;
+	return p;
+}
+
+int
+ls_arena_free(void *p)
+{
+	char *block = p;
+	struct ls_arena *arena;
+	int idx;
+	
+	if (block < (char *)arenas || block >= (char *)&arenas[LS_NR_ARENAS])
+		return 0;
+	
+	idx = (block - (char *)arenas) / sizeof(struct ls_arena);
+	arena = &arenas[idx];
+	
+	/* If some of the exits have been skipped, the blocks of these 
+	 * functions are freed here too. */
+	arena->top = block - arena->buf;
+	
+	/* The arena is returned to the pool with the top already reset.
+	 * cmpxchg() implies a full memory barrier. */
+	if (arena->top == 0)
+		cmpxchg(&ls_owners[idx], current, NULL);
+	return 1;
+}
+/* ====================================================================== */
@@ -0,0 +1,39 @@
+/* Per-task arenas for the local storage of the instrumented functions.
+ *
+ * The local storage is allocated at the entry to each function and freed
+ * at the exit from it, so the blocks are allocated and freed in LIFO 
+ * order within a task. An arena is a stack of such blocks: allocation and
+ * freeing are just the changes of the top of the stack. 
+ *
+ * There is a fixed pool of arenas. A task takes an arena from the pool at
+ * the entry to the outermost instrumented function and returns it when 
+ * the last block is freed. Taking and returning the arenas are lock-free.
+ *
+ * ls_arena_alloc() returns NULL if the pool is exhausted, if the arena 
+ * of the task is full (deep recursion) or in interrupt context. The 
+ * caller should allocate the block some other way then. */
+
+#ifndef LS_ARENA_H_1706_INCLUDED
+#define LS_ARENA_H_1706_INCLUDED
+
+#include <linux/types.h>
+
+/* Number of the arenas in the pool, must be a power of 2. */
+#define LS_ARENA_BITS 5
+#define LS_NR_ARENAS (1 << LS_ARENA_BITS)
+
+/* Size of each arena, in bytes. */
+#define LS_ARENA_SIZE 2048
+
+/* Allocates a block of 'size' bytes in the arena of the current task. 
+ * Returns NULL if this is not possible. The block is not zeroed. */
+void *
+ls_arena_alloc(size_t size);
+
+/* Frees the block 'p' as well as the blocks allocated after it in the 
+ * arena of the current task. Returns 0 if 'p' is not from an arena (in 
+ * this case, nothing is done), non-zero otherwise. */
+int
+ls_arena_free(void *p);
+
+#endif /* LS_ARENA_H_1706_INCLUDED */
@@ -2,6 +2,11 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/sched.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/math64.h>
+
+#include "ls_arena.h"
 /* ====================================================================== */
 
 #define NUM_LS_DATA_ELEMS 8
@@ -34,7 +39,14 @@ my_func_dummy_entry(void *func, unsigned int nargs, void **args)
 	struct my_struct *p;
 	unsigned int i;
 	
-	p = kzalloc(sizeof(struct my_struct), GFP_ATOMIC);
+	/* The arena cannot be used in interrupt context, if the recursion 
+	 * is too deep or if too many tasks execute the instrumented code at
+	 * the same time. Fall back to kzalloc() in these cases. */
+	p = ls_arena_alloc(sizeof(struct my_struct));
+	if (p != NULL)
+		memset(p, 0, sizeof(struct my_struct));
+	else
+		p = kzalloc(sizeof(struct my_struct), GFP_ATOMIC);
 		
 	pr_info("[DBG] Function entry, func = %pf, nargs = %u, "
 		"my_struct = %p, ret_addr = %p\n",
@@ -71,7 +83,8 @@ my_func_dummy_exit(struct my_struct *p)
 		pr_info(
 		"[DBG] Function exit, func = %pf, my_struct is at %p\n", 
 			p->func, p);
-		kfree(p);
+		if (!ls_arena_free(p))
+			kfree(p);
 	}
 	else {
 		pr_info("[DBG] Function exit, my_struct is at %p (invalid_ls)\n",
@@ -82,89 +95,222 @@ my_func_dummy_exit(struct my_struct *p)
 
 /* Handling of memory reads and writes. 
  *
- * pc - address of the instruction somewhere near the place where the event
- * 	occurred;
+ * The plugin places a record for each place in the code where a memory 
+ * event is reported into "kedr_sites" section, read-only. The handlers get
+ * the address of the record, so they need not resolve the return address 
+ * to find the location of the event. The layout must be the same as the 
+ * plugin uses, see build_access_site_type(). 'size' is 0 for the accesses
+ * made by a loop: the size of the area is only known at run time then. */
+struct kedr_access_site {
+	const char *file;
+	const char *func;
+	unsigned int line;
+	unsigned int size;
+	unsigned int is_write;
+};
+
+/* site - the place of the access;
  * addr - address of the accessed memory area; 
  * size - size of the memory area;
- * is_write - non-zero for writes, 0 for reads;
  * ls - pointer to the local storage. */
 static void
-report_memory_event(void *pc, void *addr, unsigned int size, int is_write,
-		    struct my_struct *ls)
+report_memory_event(const struct kedr_access_site *site, void *addr, 
+		    unsigned long size, struct my_struct *ls)
 {
 	pr_info(
-"[DBG] TID=%lx: memory %s at %pS: accessed %u byte(s) starting from %p.\n",
-		ls->pid, (is_write ? "write" : "read"), pc, size, addr);
+"[DBG] TID=%lx: memory %s at %s:%u (%s): accessed %lu byte(s) starting from %p.\n",
+		ls->pid, (site->is_write ? "write" : "read"), site->file,
+		site->line, site->func, size, addr);
+}
+
+void
+my_func_read1(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
+{
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read1(void *addr, struct my_struct *ls)
+my_func_read2(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 1, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read2(void *addr, struct my_struct *ls)
+my_func_read4(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 2, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read4(void *addr, struct my_struct *ls)
+my_func_read8(void *addr, const struct kedr_access_site *site,
+	      struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 4, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read8(void *addr, struct my_struct *ls)
+my_func_read16(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 8, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_read16(void *addr, struct my_struct *ls)
+my_func_write1(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 16, 0, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write1(void *addr, struct my_struct *ls)
+my_func_write2(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 1, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write2(void *addr, struct my_struct *ls)
+my_func_write4(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 2, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write4(void *addr, struct my_struct *ls)
+my_func_write8(void *addr, const struct kedr_access_site *site,
+	       struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 4, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
 void
-my_func_write8(void *addr, struct my_struct *ls)
+my_func_write16(void *addr, const struct kedr_access_site *site,
+		struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 8, 1, ls);
+	report_memory_event(site, addr, site->size, ls);
 }
 
+/* Several adjacent accesses to the same object, merged by the plugin into
+ * one event, or the accesses made by a loop, reported on entry to it. In 
+ * the latter case, 'size' is 0 if the loop makes no accesses. */
+void
+my_func_read_range(void *addr, unsigned long size,
+		const struct kedr_access_site *site, struct my_struct *ls)
+{
+	if (size == 0)
+		return;
+	report_memory_event(site, addr, size, ls);
+}
+
+void
+my_func_write_range(void *addr, unsigned long size,
+		const struct kedr_access_site *site, struct my_struct *ls)
+{
+	if (size == 0)
+		return;
+	report_memory_event(site, addr, size, ls);
+}
+
+/* Memory accesses recorded by the instrumented code in batch mode 
+ * ("batch" argument of the plugin). The layout must be the same as the 
+ * plugin uses, see build_access_log_decls(). The actual number of entries
+ * is set by the plugin. */
+struct kedr_access {
+	void *addr;
+	unsigned long size;
+	unsigned int line;
+	unsigned int is_write;
+};
+
+struct kedr_access_log {
+	unsigned long count;
+	struct kedr_access accesses[];
+};
+
+/* Called when the log is full, before function calls and at the exit from
+ * the function. */
 void
-my_func_write16(void *addr, struct my_struct *ls)
+my_func_flush_accesses(struct kedr_access_log *log, struct my_struct *ls)
 {
-	report_memory_event(
-		(void *)__builtin_return_address(0), addr, 16, 1, ls);
+	unsigned long i;
+	
+	for (i = 0; i < log->count; ++i) {
+		struct kedr_access *a = &log->accesses[i];
+		pr_info(
+"[DBG] TID=%lx: memory %s in %pf, line %u: accessed %lu byte(s) starting from %p.\n",
+			ls->pid, (a->is_write ? "write" : "read"), ls->func,
+			a->line, a->size, a->addr);
+	}
+	log->count = 0;
+}
+
+/* -log2(x / 2^32) for x > 0, in 32.32 fixed point. The fractional bits of
+ * the logarithm are found one by one by squaring the mantissa. */
+static u64
+neg_log2_fraction(u32 x)
+{
+	unsigned int n = fls(x);
+	u64 m = (u64)x << (32 - n); /* m / 2^31 is in [1, 2) */
+	u64 frac = 0;
+	int i;
+
+	for (i = 31; i >= 0; --i) {
+		m = (m * m) >> 31;
+		if (m >= (1ULL << 32)) {
+			m >>= 1;
+			frac |= 1ULL << i;
+		}
+	}
+	/* log2(x) = n - 1 + frac */
+	return ((u64)(33 - n) << 32) - frac;
+}
+
+/* Returns a random countdown with geometric distribution: the probability 
+ * that it is greater than k is (1 - 1/period)^k. This is what reporting 
+ * each event with probability 1/period independently gives. The 
+ * distribution is memoryless, so restarting the countdown at each call of
+ * an instrumented function does not change the rate, whatever the number
+ * of events in the calls. 'rnd' is a random 32-bit value. */
+static unsigned long
+geometric_countdown(unsigned long period, u32 rnd)
+{
+	/* -log2(1 - 1/period), rounded down to 32 bits of the fraction. */
+	u32 q = (u32)((((u64)(period - 1)) << 32) / period);
+	u64 denom = neg_log2_fraction(q != 0 ? q : 1);
+
+	if (denom == 0)
+		return ULONG_MAX; /* period is too large to tell from 1 - 0 */
+	
+	/* -log2(U) / -log2(1 - 1/period) with U uniform in (0, 1]. */
+	return 1 + (unsigned long)(div64_u64(neg_log2_fraction(rnd != 0 ? rnd : 1), denom));
+}
+
+/* Sampling mode ("sample" argument of the plugin). The instrumented code 
+ * reports a memory event only when its countdown reaches 0, then it asks 
+ * for the next countdown here. Each event is reported with probability
+ * 1/sample_period, see geometric_countdown(). The countdown starts anew 
+ * in each call of an instrumented function.
+ *
+ * The period may be changed at any time via 
+ * /sys/module/kedr_sample_target/parameters/sample_period. Period 1 (or 0)
+ * means each event is reported. */
+static unsigned long sample_period = 100;
+module_param(sample_period, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sample_period, 
+	"Report about one of this many memory events in sampling mode.");
+
+unsigned long
+my_func_sample_countdown(struct my_struct *ls)
+{
+	unsigned long period = ACCESS_ONCE(sample_period);
+	
+	if (period <= 1)
+		return 1;
+	
+	return geometric_countdown(period, prandom_u32());
 }
 /* ====================================================================== */
 
@@ -71,6 +71,8 @@
 #endif
 
 #include "gimple.h"
+#include "tree-chrec.h"
+#include "tree-scalar-evolution.h"
 
 #if BUILDING_GCC_VERSION >= 4009
 #include "tree-ssa-operands.h"
@@ -0,0 +1,204 @@
+/* Selection of the functions to instrument, see filters.h. */
+
+#include <stdio.h>
+#include <fstream>
+
+#include "filters.h"
+/* ====================================================================== */
+
+GlobSet::GlobSet()
+	: npatterns(0)
+{
+	/* The root. */
+	add_node();
+}
+
+unsigned int
+GlobSet::add_node()
+{
+	nodes.push_back(Node());
+	return nodes.size() - 1;
+}
+
+void
+GlobSet::add(const std::string &pattern)
+{
+	unsigned int node = 0;
+	bool after_seq = false;
+
+	for (size_t i = 0; i < pattern.size(); ++i) {
+		char c = pattern[i];
+		unsigned int next;
+
+		if (c == '*') {
+			/* "**" is the same as "*". */
+			if (after_seq)
+				continue;
+			after_seq = true;
+			next = nodes[node].any_seq;
+			if (next == 0) {
+				next = add_node();
+				nodes[node].any_seq = next;
+				nodes[next].is_seq = true;
+			}
+		}
+		else if (c == '?') {
+			after_seq = false;
+			next = nodes[node].any_char;
+			if (next == 0) {
+				next = add_node();
+				nodes[node].any_char = next;
+			}
+		}
+		else {
+			after_seq = false;
+			if (c == '\\' && i + 1 < pattern.size())
+				c = pattern[++i];
+
+			std::map<unsigned char, unsigned int>::iterator it =
+				nodes[node].literals.find(c);
+			if (it != nodes[node].literals.end()) {
+				next = it->second;
+			}
+			else {
+				next = add_node();
+				/* 'nodes' may have been reallocated. */
+				nodes[node].literals[c] = next;
+			}
+		}
+		node = next;
+	}
+	nodes[node].terminal = true;
+	++npatterns;
+}
+
+/* Adds the node to the set of the active ones unless it is there already,
+ * along with the node after '*' that follows it: '*' may match an empty
+ * sequence. 'mark[n] == gen' if the node n is in the set. */
+void
+GlobSet::activate(unsigned int node, std::vector<unsigned int> &active,
+		  std::vector<unsigned int> &mark, unsigned int gen) const
+{
+	while (node != 0 && mark[node] != gen) {
+		mark[node] = gen;
+		active.push_back(node);
+		node = nodes[node].any_seq;
+	}
+}
+
+bool
+GlobSet::matches(const char *str) const
+{
+	if (npatterns == 0)
+		return false;
+
+	std::vector<unsigned int> active;
+	std::vector<unsigned int> next;
+	std::vector<unsigned int> mark(nodes.size(), 0);
+	unsigned int gen = 1;
+
+	/* The root is never a child, so it is added by hand. */
+	mark[0] = gen;
+	active.push_back(0);
+	activate(nodes[0].any_seq, active, mark, gen);
+
+	for (; *str != 0 && !active.empty(); ++str) {
+		++gen;
+		next.clear();
+		for (size_t i = 0; i < active.size(); ++i) {
+			const Node &n = nodes[active[i]];
+
+			if (n.is_seq)
+				activate(active[i], next, mark, gen);
+			activate(n.any_char, next, mark, gen);
+
+			std::map<unsigned char, unsigned int>::const_iterator
+				it = n.literals.find(*str);
+			if (it != n.literals.end())
+				activate(it->second, next, mark, gen);
+		}
+		active.swap(next);
+	}
+
+	for (size_t i = 0; i < active.size(); ++i) {
+		if (nodes[active[i]].terminal)
+			return true;
+	}
+	return false;
+}
+/* ====================================================================== */
+
+struct EventFilter {
+	GlobSet funcs[2];
+	GlobSet files[2];
+};
+
+/* Index 0 for the exclude lists, 1 for the include lists. */
+static EventFilter filters[EC_NUM_CLASSES];
+
+static std::string
+trim(const std::string &s)
+{
+	static const char spaces[] = " \t\r\n";
+	size_t first = s.find_first_not_of(spaces);
+	if (first == std::string::npos)
+		return std::string();
+	return s.substr(first, s.find_last_not_of(spaces) - first + 1);
+}
+
+bool
+load_filter_file(const char *path, bool include, EEventClass ec)
+{
+	static const char file_prefix[] = "file:";
+	static const size_t prefix_len = sizeof(file_prefix) - 1;
+
+	std::ifstream in(path);
+	if (!in) {
+		fprintf(stderr, "Failed to open \"%s\".\n", path);
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(in, line)) {
+		line = trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		bool is_file = (line.compare(0, prefix_len, file_prefix) == 0);
+		if (is_file)
+			line = trim(line.substr(prefix_len));
+
+		for (int i = 0; i < EC_NUM_CLASSES; ++i) {
+			if (ec != EC_NUM_CLASSES && ec != i)
+				continue;
+			if (is_file)
+				filters[i].files[include].add(line);
+			else
+				filters[i].funcs[include].add(line);
+		}
+	}
+
+	if (in.bad()) {
+		fprintf(stderr, "Failed to read \"%s\".\n", path);
+		return false;
+	}
+	return true;
+}
+
+bool
+filter_allows(EEventClass ec, const char *name, const char *file)
+{
+	const EventFilter &f = filters[ec];
+
+	if ((!f.funcs[1].empty() || !f.files[1].empty()) &&
+	    !f.funcs[1].matches(name) &&
+	    !(file != NULL && f.files[1].matches(file)))
+		return false;
+
+	if (f.funcs[0].matches(name) ||
+	    (file != NULL && f.files[0].matches(file)))
+		return false;
+
+	return true;
+}
+/* ====================================================================== */
@@ -0,0 +1,86 @@
+/* Selection of the functions to instrument by their names and the source
+ * files they are defined in. */
+
+#ifndef FILTERS_H_1706_INCLUDED
+#define FILTERS_H_1706_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+
+/* A set of glob patterns, compiled into a trie so that a string is
+ * matched against all of them at once. In the patterns, '*' matches any
+ * sequence of characters (including '/'), '?' matches any character, '\'
+ * makes the next character match literally.
+ *
+ * The trie is used as a nondeterministic automaton: the string is read
+ * once, keeping the set of the nodes it may have reached so far, so the
+ * time is O(nodes * length) whatever the number of '*' in the patterns. */
+class GlobSet {
+public:
+	GlobSet();
+
+	void add(const std::string &pattern);
+
+	bool empty() const { return npatterns == 0; }
+
+	/* Returns true if 'str' matches at least one of the patterns. */
+	bool matches(const char *str) const;
+
+private:
+	struct Node {
+		/* Indexes of the nodes for the literal characters and for
+		 * '?' and '*', 0 if there are no such nodes (the root is
+		 * never a child). */
+		std::map<unsigned char, unsigned int> literals;
+		unsigned int any_char;
+		unsigned int any_seq;
+
+		/* Whether a pattern ends here. */
+		bool terminal;
+
+		/* Whether this is the node after '*': it stays active
+		 * whatever character is read. */
+		bool is_seq;
+
+		Node() : any_char(0), any_seq(0), terminal(false), 
+			 is_seq(false) {}
+	};
+	std::vector<Node> nodes;
+	unsigned int npatterns;
+
+	unsigned int add_node();
+	void activate(unsigned int node, std::vector<unsigned int> &active,
+		      std::vector<unsigned int> &mark, unsigned int gen) const;
+};
+
+/* The kinds of events the lists are specified for. */
+enum EEventClass {
+	/* Memory accesses. */
+	EC_MEMORY,
+	/* Handlers of the function calls. */
+	EC_CALLS,
+	/* Entry and exit of the function itself. */
+	EC_FUNCTIONS,
+	EC_NUM_CLASSES
+};
+
+/* Loads the patterns from the file to the include or exclude list for the
+ * given class of events, for all classes if 'ec' is EC_NUM_CLASSES. Each
+ * line of the file is a pattern for the function names or, if it starts
+ * with "file:", for the source files. Empty lines and the lines starting
+ * with '#' are ignored.
+ *
+ * Returns false and reports the error to stderr if the file cannot be
+ * read. */
+bool
+load_filter_file(const char *path, bool include, EEventClass ec);
+
+/* Returns true if the events of the given class should be reported for
+ * the function 'name' defined in the source file 'file': if the include
+ * list for the class is empty or matches the function and the exclude
+ * list does not match it. */
+bool
+filter_allows(EEventClass ec, const char *name, const char *file);
+
+#endif /*FILTERS_H_1706_INCLUDED*/
@@ -650,15 +650,19 @@ enum EMemHandlers {
 };
 
 static tree memory_event_handlers[MH_NUM_HANDLERS];
+static tree memory_range_read_handler;
+static tree memory_range_write_handler;
 
 static void 
 build_memory_event_decls(void)
 {
 	tree fntype;
 	
-	/* void my_func_{read|write}N(void *addr, struct my_struct *ls). */
+	/* void my_func_{read|write}N(void *addr, 
+	 *	const struct kedr_access_site *site, struct my_struct *ls). */
 	fntype = build_function_type_list(void_type_node /* return type */,
 		ptr_type_node /* addr */,
+		ptr_type_node /* site */,
 		ptr_type_node /* ls */, NULL_TREE);
 	
 	memory_event_handlers[MH_READ1] = 
@@ -686,6 +690,22 @@ build_memory_event_decls(void)
 	for (unsigned int i = 0; i < MH_NUM_HANDLERS; ++i) {
 		set_handler_decl_properties(memory_event_handlers[i]);
 	}
+	
+	/* void my_func_{read|write}_range(void *addr, unsigned long size,
+	 *	const struct kedr_access_site *site, struct my_struct *ls). */
+	fntype = build_function_type_list(void_type_node /* return type */,
+		ptr_type_node /* addr */,
+		long_unsigned_type_node /* size */,
+		ptr_type_node /* site */,
+		ptr_type_node /* ls */, NULL_TREE);
+	
+	memory_range_read_handler = 
+		build_fn_decl("my_func_read_range", fntype);
+	set_handler_decl_properties(memory_range_read_handler);
+	
+	memory_range_write_handler = 
+		build_fn_decl("my_func_write_range", fntype);
+	set_handler_decl_properties(memory_range_write_handler);
 }
 
 tree
@@ -708,6 +728,141 @@ get_memory_event_decl(unsigned int size, bool is_write)
 	
 	return memory_event_handlers[mh];
 }
+
+tree
+get_memory_range_event_decl(bool is_write)
+{
+	return is_write ? memory_range_write_handler : 
+			  memory_range_read_handler;
+}
+
+static tree sample_countdown_decl;
+
+tree
+get_sample_countdown_decl(void)
+{
+	return sample_countdown_decl;
+}
+
+static void
+build_sample_countdown_decl(void)
+{
+	/* unsigned long my_func_sample_countdown(struct my_struct *ls) */
+	tree fntype = build_function_type_list(
+		long_unsigned_type_node /* return type */,
+		ptr_type_node /* ls */, NULL_TREE);
+	sample_countdown_decl = build_fn_decl("my_func_sample_countdown", 
+					      fntype);
+	set_handler_decl_properties(sample_countdown_decl);
+}
+/* ====================================================================== */
+
+static AccessLogInfo access_log_info;
+
+const AccessLogInfo &
+get_access_log_info(void)
+{
+	return access_log_info;
+}
+
+/* Create the fields of a record type, in the given order. */
+static void
+build_record_fields(tree record, tree *fields, const char **names, 
+		    tree *types, unsigned int nfields)
+{
+	for (unsigned int i = 0; i < nfields; ++i) {
+		fields[i] = build_decl(UNKNOWN_LOCATION, FIELD_DECL, 
+			get_identifier(names[i]), types[i]);
+		DECL_CONTEXT(fields[i]) = record;
+		if (i)
+			DECL_CHAIN(fields[i - 1]) = fields[i];
+	}
+	TYPE_FIELDS(record) = fields[0];
+	layout_type(record);
+}
+
+static AccessSiteInfo access_site_info;
+
+const AccessSiteInfo &
+get_access_site_info(void)
+{
+	return access_site_info;
+}
+
+static void
+build_access_site_type(void)
+{
+	AccessSiteInfo &info = access_site_info;
+	tree const_char_ptr = build_pointer_type(
+		build_qualified_type(char_type_node, TYPE_QUAL_CONST));
+	
+	/* struct kedr_access_site */
+	tree fields[5];
+	const char *names[5] = {"file", "func", "line", "size", "is_write"};
+	tree types[5] = {
+		const_char_ptr,
+		const_char_ptr,
+		unsigned_type_node,
+		unsigned_type_node,
+		unsigned_type_node
+	};
+	
+	info.site_type = make_node(RECORD_TYPE);
+	build_record_fields(info.site_type, fields, names, types, 5);
+	info.file_field = fields[0];
+	info.func_field = fields[1];
+	info.line_field = fields[2];
+	info.size_field = fields[3];
+	info.is_write_field = fields[4];
+}
+
+void
+build_access_log_decls(unsigned int nentries)
+{
+	AccessLogInfo &info = access_log_info;
+	info.nentries = nentries;
+	
+	/* struct kedr_access */
+	tree entry_fields[4];
+	const char *entry_names[4] = {"addr", "size", "line", "is_write"};
+	tree entry_types[4] = {
+		ptr_type_node, 
+		long_unsigned_type_node,
+		unsigned_type_node,
+		unsigned_type_node
+	};
+	
+	info.entry_type = make_node(RECORD_TYPE);
+	build_record_fields(info.entry_type, entry_fields, entry_names,
+			    entry_types, 4);
+	info.addr_field = entry_fields[0];
+	info.size_field = entry_fields[1];
+	info.line_field = entry_fields[2];
+	info.is_write_field = entry_fields[3];
+	
+	/* struct kedr_access_log */
+	tree log_fields[2];
+	const char *log_names[2] = {"count", "accesses"};
+	tree log_types[2] = {
+		long_unsigned_type_node,
+		build_array_type_nelts(info.entry_type, nentries)
+	};
+	
+	info.log_type = make_node(RECORD_TYPE);
+	build_record_fields(info.log_type, log_fields, log_names, 
+			    log_types, 2);
+	info.count_field = log_fields[0];
+	info.accesses_field = log_fields[1];
+	
+	/* void my_func_flush_accesses(struct kedr_access_log *log, 
+	 *	struct my_struct *ls) */
+	tree fntype = build_function_type_list(
+		void_type_node /* return type */,
+		ptr_type_node /* log */,
+		ptr_type_node /* ls */, NULL_TREE);
+	info.flush_decl = build_fn_decl("my_func_flush_accesses", fntype);
+	set_handler_decl_properties(info.flush_decl);
+}
 /* ====================================================================== */
 
 void
@@ -749,5 +904,7 @@ build_handler_decls(void)
 	
 	/* DECLs for the handlers memory events. */
 	build_memory_event_decls();
+	build_access_site_type();
+	build_sample_countdown_decl();
 }
 /* ====================================================================== */
@@ -45,8 +45,96 @@ const HandlerInfo *
 get_handlers_by_function_name(const char *name, tree fndecl);
 
 /* Returns the decl for a function that reports memory access of the given
- * type (read/write) when size bytes are accessed. */
+ * type (read/write) when size bytes are accessed:
+ * void my_func_{read|write}N(void *addr, 
+ *	const struct kedr_access_site *site, struct my_struct *ls) */
 tree
 get_memory_event_decl(unsigned int size, bool is_write);
 
+/* Returns the decl for a function that reports memory access of the given
+ * type (read/write) to the area of arbitrary size. Such an event is 
+ * emitted for several adjacent accesses merged together:
+ * void my_func_{read|write}_range(void *addr, unsigned long size,
+ *	const struct kedr_access_site *site, struct my_struct *ls) */
+tree
+get_memory_range_event_decl(bool is_write);
+
+/* Each memory event emitted by the plugin has a read-only record in 
+ * "kedr_sites" section of the object file, describing the place of the 
+ * access:
+ *
+ * struct kedr_access_site {
+ *	const char *file;
+ *	const char *func;
+ *	unsigned int line;
+ *	unsigned int size;
+ *	unsigned int is_write;
+ * };
+ *
+ * The handlers of the event get the address of the record, so they need
+ * not resolve the return addresses to find where the event comes from. 
+ * 'size' is the size of the accessed area, 0 if it is only known at run 
+ * time. */
+struct AccessSiteInfo {
+	tree site_type;
+	tree file_field;
+	tree func_field;
+	tree line_field;
+	tree size_field;
+	tree is_write_field;
+};
+
+const AccessSiteInfo &
+get_access_site_info(void);
+
+/* Returns the decl for the function that tells the instrumented code in
+ * sampling mode how many memory events to skip before the next one is 
+ * reported:
+ * unsigned long my_func_sample_countdown(struct my_struct *ls) 
+ * The returned value must be positive. */
+tree
+get_sample_countdown_decl(void);
+
+/* The log where the instrumented function records memory accesses in 
+ * batch mode, instead of calling a handler for each access. The log is a
+ * local variable of the function:
+ *
+ * struct kedr_access_log {
+ *	unsigned long count;
+ *	struct kedr_access {
+ *		void *addr;
+ *		unsigned long size;
+ *		unsigned int line;
+ *		unsigned int is_write;
+ *	} accesses[nentries];
+ * };
+ *
+ * 'line' is the source line of the access. The records are passed to 
+ * void my_func_flush_accesses(struct kedr_access_log *log, 
+ *	struct my_struct *ls)
+ * which processes 'count' records and resets 'count' to 0. */
+struct AccessLogInfo {
+	unsigned int nentries;
+	
+	tree log_type;
+	tree count_field;
+	tree accesses_field;
+	
+	tree entry_type;
+	tree addr_field;
+	tree size_field;
+	tree line_field;
+	tree is_write_field;
+	
+	tree flush_decl;
+};
+
+/* Build the types for the log with the given number of entries and the 
+ * decl for the flush handler. Call this when processing START_UNIT event,
+ * after build_handler_decls(). */
+void build_access_log_decls(unsigned int nentries);
+
+const AccessLogInfo &
+get_access_log_info(void);
+
 #endif /*HANDLERS_H_1750_INCLUDED*/
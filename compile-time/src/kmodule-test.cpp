@@ -3,11 +3,14 @@
 
 #include <assert.h>
 #include <string.h>
+#include <vector>
+#include <map>
 #include <gcc-plugin.h>
 #include <plugin-version.h>
 
 #include "common_includes.h"
 #include "handlers.h"
+#include "filters.h"
 
 //<>
 #include <stdio.h> // for debugging
@@ -17,6 +20,10 @@
 #if BUILDING_GCC_VERSION <= 4008
 #define ENTRY_BLOCK_PTR_FOR_FN(FN)	ENTRY_BLOCK_PTR_FOR_FUNCTION(FN)
 #define EXIT_BLOCK_PTR_FOR_FN(FN)	EXIT_BLOCK_PTR_FOR_FUNCTION(FN)
+#define BASIC_BLOCK_FOR_FN(FN, N)	BASIC_BLOCK_FOR_FUNCTION(FN, N)
+#define n_basic_blocks_for_fn(FN)	n_basic_blocks_for_function(FN)
+#define tree_fits_shwi_p(T)		host_integerp(T, 0)
+#define tree_to_shwi(T)			tree_low_cst(T, 0)
 #endif
 
 /* ====================================================================== */
@@ -50,6 +57,55 @@ plugin_init(struct plugin_name_args *plugin_info,
 #endif
 /* ====================================================================== */
 
+/* Whether the adjacent memory accesses should be reported by a single 
+ * event. Set to false by "no-coalesce" argument of the plugin. */
+static bool coalesce_accesses = true;
+
+/* Number of entries in the log of memory accesses, 0 if the accesses 
+ * are reported by the handler calls rather than logged. Set by "batch" 
+ * argument of the plugin. */
+static unsigned int access_log_size = 0;
+
+/* The log is a local variable of each instrumented function that makes 
+ * memory accesses, so it takes the stack in each such frame of a call 
+ * chain: 24 bytes per entry plus 8 on x86_64, i.e. 200 bytes by default 
+ * and 392 bytes at most. Kernel stacks are only 8-16 Kb, hence the small
+ * limits. The log is not kept in the local storage because the latter may
+ * be the shared fallback object if allocation fails (see the samples), and
+ * the log must be private to the call. */
+#define DEFAULT_ACCESS_LOG_SIZE 8
+#define MAX_ACCESS_LOG_SIZE 16
+
+/* Whether the instrumentation should be done after inlining and IPA 
+ * rather than right after the function is converted to SSA form. Set by
+ * "late" argument of the plugin. */
+static bool instrument_late = false;
+
+/* Whether only some of the memory events should be reported, as decided 
+ * at run time by my_func_sample_countdown(). Set by "sample" argument of 
+ * the plugin. */
+static bool sample_accesses = false;
+
+/* Whether the repeated reads from the same memory should be left 
+ * unreported and the accesses made in the loops should be reported on 
+ * entry to the loops where possible. Set to false by "no-eliminate" 
+ * argument of the plugin. */
+static bool eliminate_accesses = true;
+
+/* Statistics for the current compilation unit. */
+static unsigned int stat_accesses = 0;
+static unsigned int stat_events = 0;
+/* The events not emitted because the accesses are to non-escaping 
+ * objects or because the functions were inlined. */
+static unsigned int stat_local_accesses = 0;
+static unsigned int stat_inlined_functions = 0;
+static unsigned int stat_redundant_reads = 0;
+/* The accesses in the loops reported on entry to the loops. */
+static unsigned int stat_hoisted_accesses = 0;
+/* The functions not instrumented at all because of the include/exclude 
+ * lists. */
+static unsigned int stat_excluded_functions = 0;
+
 /* Before GCC starts processing a compilation unit, create the necessary 
  * declarations. 
  *
@@ -59,6 +115,41 @@ static void
 my_start_unit(void * /*gcc_data*/, void * /*user_data*/)
 {
 	build_handler_decls();
+	if (access_log_size != 0)
+		build_access_log_decls(access_log_size);
+	
+	stat_accesses = 0;
+	stat_events = 0;
+	stat_local_accesses = 0;
+	stat_inlined_functions = 0;
+	stat_redundant_reads = 0;
+	stat_hoisted_accesses = 0;
+	stat_excluded_functions = 0;
+}
+
+/* Report how many memory accesses were found in the compilation unit, 
+ * how many calls to the handlers were emitted for them and how many events
+ * were eliminated. */
+static void 
+my_finish_unit(void * /*gcc_data*/, void * /*user_data*/)
+{
+	fprintf(stderr, 
+	"[DBG] Memory accesses instrumented: %u, memory events %s: %u.\n",
+		stat_accesses, 
+		(access_log_size != 0 ? "logged" : "emitted"), 
+		stat_events);
+	fprintf(stderr, 
+	"[DBG] Events eliminated: %u for accesses to non-escaping objects, "
+	"%u for redundant reads, "
+	"%u for entries/exits of inlined functions.\n",
+		stat_local_accesses, stat_redundant_reads,
+		2 * stat_inlined_functions);
+	fprintf(stderr, 
+	"[DBG] Accesses in loops reported on entry to the loops: %u.\n",
+		stat_hoisted_accesses);
+	fprintf(stderr, 
+	"[DBG] Functions excluded by the lists: %u.\n",
+		stat_excluded_functions);
 }
 /* ====================================================================== */
 
@@ -114,8 +205,69 @@ tree_for_param_rhs(tree param)
 	return ddef;
 }
 
+/* log.count */
+static tree
+build_access_log_count_ref(tree log)
+{
+	const AccessLogInfo &info = get_access_log_info();
+	return build3(COMPONENT_REF, TREE_TYPE(info.count_field), log,
+		      info.count_field, NULL_TREE);
+}
+
+/* log.accesses[index].field */
+static tree
+build_access_log_entry_ref(tree log, tree index, tree field)
+{
+	const AccessLogInfo &info = get_access_log_info();
+	
+	tree accesses = build3(COMPONENT_REF, TREE_TYPE(info.accesses_field),
+			       log, info.accesses_field, NULL_TREE);
+	tree entry = build4(ARRAY_REF, info.entry_type, accesses, index,
+			    NULL_TREE, NULL_TREE);
+	return build3(COMPONENT_REF, TREE_TYPE(field), entry, field, 
+		      NULL_TREE);
+}
+
+/* Creates the log for the memory accesses of the current function. */
+static tree
+create_access_log(void)
+{
+	tree log = create_tmp_var(get_access_log_info().log_type, 
+				  "__kedr_access_log");
+	add_referenced_var(log);
+	mark_addressable(log);
+	return log;
+}
+
+/* log.count = 0 at the entry to the function. */
 static void
-instrument_fentry(tree *ls_ptr)
+instrument_access_log_init(tree log)
+{
+	gimple g = gimple_build_assign(
+		build_access_log_count_ref(log), 
+		build_int_cst(long_unsigned_type_node, 0));
+	gimple_set_location(g, cfun->function_start_locus);
+	
+	/* The first block may be a loop header, so the edge from the entry
+	 * block is used rather than the block itself. */
+	gsi_insert_on_edge_immediate(
+		single_succ_edge(ENTRY_BLOCK_PTR_FOR_FN(cfun)), g);
+}
+
+/* Call: my_func_flush_accesses(&log, ls) */
+static gimple
+build_access_log_flush(tree log, tree *ls_ptr, location_t loc)
+{
+	gimple g = gimple_build_call(get_access_log_info().flush_decl, 2,
+				     build_fold_addr_expr(log), *ls_ptr);
+	gimple_set_location(g, loc);
+	return g;
+}
+
+/* In sampling mode, 'countdown' is the local variable to be initialized
+ * right after the entry handler, NULL_TREE otherwise. */
+static void
+instrument_fentry(tree *ls_ptr, tree countdown)
 {
 	basic_block on_entry;
 	gimple_stmt_iterator gsi;
@@ -198,12 +350,23 @@ instrument_fentry(tree *ls_ptr)
 	gimple_set_location(g, cfun->function_start_locus);
 	gimple_seq_add_stmt(&seq, g);
 	
+	if (countdown != NULL_TREE) {
+		/* countdown = my_func_sample_countdown(ls) */
+		g = gimple_build_call(get_sample_countdown_decl(), 1, 
+				      *ls_ptr);
+		gimple_call_set_lhs(g, countdown);
+		gimple_set_location(g, cfun->function_start_locus);
+		gimple_seq_add_stmt(&seq, g);
+	}
+	
 	gsi_insert_seq_before (&gsi, seq, GSI_SAME_STMT);
 	return;	
 }
 
+/* 'log' is the log of memory accesses to be flushed before the exit, 
+ * NULL_TREE if none. */
 static void
-instrument_fexit(tree *ls_ptr)
+instrument_fexit(tree *ls_ptr, tree log)
 {
 	location_t loc;
 	basic_block at_exit;
@@ -229,6 +392,12 @@ instrument_fexit(tree *ls_ptr)
 			   gimple_call_builtin_p(stmt, BUILT_IN_RETURN));
 		loc = gimple_location(stmt);
 		
+		if (log != NULL_TREE) {
+			gsi_insert_before(&gsi, 
+				build_access_log_flush(log, ls_ptr, loc),
+				GSI_SAME_STMT);
+		}
+		
 		/* Call: my_func_dummy_exit(ls) */
 		g = gimple_build_call(get_exit_handler_decl(), 1, *ls_ptr);
 		gimple_set_location(g, loc);
@@ -468,19 +637,85 @@ instrument_function_call(gimple_stmt_iterator *gsi, tree *ls_ptr)
 	}
 }
 
-/* This function was taken from the implementation of TSan in GCC 4.9 
+/* A memory access to be reported. */
+struct MemAccess {
+	/* The statement that makes the access. */
+	gimple stmt;
+	
+	/* The accessed memory area. */
+	tree expr;
+	HOST_WIDE_INT size;
+	bool is_write;
+	
+	/* The accessed object and the offset of the area in it, in bytes 
+	 * (see get_inner_reference()). The variable part of the offset, if 
+	 * any, is 'var_offset'. */
+	tree base;
+	HOST_WIDE_INT offset;
+	tree var_offset;
+	
+	/* false if the offset is not constant or the access is volatile. 
+	 * Such accesses are always reported on their own. */
+	bool can_merge;
+};
+
+/* The accesses of the same kind (reads or writes) to adjacent or 
+ * overlapping areas of the same object within a basic block, with no calls
+ * or barriers between them. They are reported by a single event at the 
+ * place of the first one. */
+struct MemAccessGroup {
+	/* The first access in the group. */
+	MemAccess first;
+	
+	/* The area accessed by the group is [start, end) relative to 
+	 * 'first.base'. */
+	HOST_WIDE_INT start;
+	HOST_WIDE_INT end;
+	
+	unsigned int naccesses;
+};
+
+typedef std::vector<MemAccessGroup> MemAccessGroups;
+
+/* A loop-invariant read or the accesses to consecutive areas made by a 
+ * loop, reported by a single event on entry to the loop. */
+struct HoistedAccess {
+	struct loop *loop;
+	
+	/* The accessed area is [start, start + size), both are computed at 
+	 * the end of the preheader of the loop. */
+	tree start;
+	tree size;
+	bool is_write;
+	
+	location_t loc;
+};
+
+/* The memory accesses found in the function so far. */
+struct MemAccessCollector {
+	/* The groups the accesses may still be added to. */
+	MemAccessGroups open_groups;
+	MemAccessGroups groups;
+	
+	std::vector<HoistedAccess> hoisted;
+	
+	/* The reads reported so far, by the virtual operand they use. The 
+	 * statements with the same virtual operand see the same state of 
+	 * memory, i.e. there are no writes or calls between them. */
+	std::map<tree, std::vector<MemAccess> > reads;
+};
+
+/* Checks if the access to 'expr' made by 'stmt' should be reported and 
+ * fills 'access' if so.
+ * 
+ * This function was taken from the implementation of TSan in GCC 4.9 
  * (gcc/tsan.c), with several modifications. */
-static void
-instrument_expr(gimple_stmt_iterator gsi, tree expr, bool is_write, 
-		tree *ls_ptr)
+static bool
+get_memory_access(gimple stmt, tree expr, bool is_write, MemAccess *access)
 {
-	gimple stmt = gsi_stmt(gsi);
-	gimple_seq seq = NULL;
-	gimple g;
-
 	HOST_WIDE_INT size = int_size_in_bytes(TREE_TYPE (expr));
 	if (size < 1)
-		return;
+		return false;
 
 	/* TODO: Check how this works when bit fields are accessed, update 
 	 * if needed (~ report touching the corresponding bytes as a 
@@ -498,10 +733,12 @@ instrument_expr(gimple_stmt_iterator gsi, tree expr, bool is_write,
 	/* No need to instrument accesses to decls that don't escape,
 	 * they can't escape to other threads then. 
 	 * 
-	 * [?] Looks like (gcc/passes.def) IPA passes come after "einline" 
-	 * pass, so we may need another pass to use the results of IPA 
-	 * analysis. This is because most of the instrumentation is done 
-	 * here before "einline" pass. */
+	 * [NB] The points-to information is computed by "alias" pass, 
+	 * which runs after IPA (see gcc/passes.def). So with the default
+	 * placement of our pass (before "einline"), only the decls whose 
+	 * address is never taken are recognized here. In "late" mode, the 
+	 * accesses via the pointers to non-escaping local objects are 
+	 * recognized too. */
 	if (DECL_P(base)) {
 		struct pt_solution pt;
 		memset(&pt, 0, sizeof(pt));
@@ -512,84 +749,782 @@ instrument_expr(gimple_stmt_iterator gsi, tree expr, bool is_write,
 			//<>
 			fprintf(stderr, "[DBG] The decl does not escape.\n");
 			//<>
-			return;
+			++stat_local_accesses;
+			return false;
 		}
 		if (!is_global_var(base) && !may_be_aliased(base)) {
 			//<>
 			fprintf(stderr, "[DBG] Neither global nor may be aliased.\n");
 			//<>
-			return;
+			++stat_local_accesses;
+			return false;
 		}
 	}
+	else if ((TREE_CODE(base) == MEM_REF || 
+		  TREE_CODE(base) == TARGET_MEM_REF) &&
+		 TREE_CODE(TREE_OPERAND(base, 0)) == SSA_NAME &&
+		 !ptr_deref_may_alias_global_p(TREE_OPERAND(base, 0))) {
+		/* The pointer may only point to the local objects that do 
+		 * not escape. Without points-to information (before "alias"
+		 * pass), any pointer may point to global memory. */
+		//<>
+		fprintf(stderr, "[DBG] The pointed-to object does not escape.\n");
+		//<>
+		++stat_local_accesses;
+		return false;
+	}
 
 	if (TREE_READONLY (base) || 
 	   (TREE_CODE (base) == VAR_DECL && DECL_HARD_REGISTER (base))) {
 		//<>
 		fprintf(stderr, "[DBG] Read-only or register variable.\n");
 		//<>
-		return;
+		return false;
 	}
 
 	// TODO: bit field access. How to handle it properly?
 	if (bitpos % (size * BITS_PER_UNIT) ||
 	    bitsize != size * BITS_PER_UNIT) {
-		return;
+		return false;
 	}
 
 	gcc_checking_assert(is_gimple_addressable (expr));
-	tree expr_ptr = build_fold_addr_expr(unshare_expr(expr));
+	
+	access->stmt = stmt;
+	access->expr = expr;
+	access->size = size;
+	access->is_write = is_write;
+	access->base = base;
+	access->offset = bitpos / BITS_PER_UNIT;
+	access->var_offset = offset;
+	access->can_merge = (offset == NULL_TREE && !volatilep &&
+			     !TREE_THIS_VOLATILE(expr));
+	return true;
+}
 
-	if (!is_gimple_val(expr_ptr)) {
-		g = gimple_build_assign(
-			make_ssa_name(TREE_TYPE(expr_ptr), NULL),
-			expr_ptr);
-		expr_ptr = gimple_assign_lhs(g);
-		gimple_set_location(g, gimple_location(stmt));
-		gimple_seq_add_stmt(&seq, g);
+/* Adds the access to the open group it is adjacent to, or opens a new 
+ * group. */
+static void
+add_memory_access(MemAccessGroups &open_groups, const MemAccess &access)
+{
+	++stat_accesses;
+	
+	HOST_WIDE_INT start = access.offset;
+	HOST_WIDE_INT end = access.offset + access.size;
+	
+	if (coalesce_accesses && access.can_merge) {
+		for (unsigned int i = 0; i < open_groups.size(); ++i) {
+			MemAccessGroup &group = open_groups[i];
+			
+			if (!group.first.can_merge || 
+			    group.first.is_write != access.is_write ||
+			    start > group.end || end < group.start ||
+			    !operand_equal_p(group.first.base, access.base, 0))
+				continue;
+			
+			if (start < group.start)
+				group.start = start;
+			if (end > group.end)
+				group.end = end;
+			++group.naccesses;
+			return;
+		}
 	}
+	
+	MemAccessGroup group;
+	group.first = access;
+	group.start = start;
+	group.end = end;
+	group.naccesses = 1;
+	open_groups.push_back(group);
+}
 
-	/* call my_func_{read|write}N(addr, ls) */
-	g = gimple_build_call(get_memory_event_decl(size, is_write), 2, 
-			      expr_ptr, *ls_ptr);
-	gimple_set_location(g, gimple_location(stmt));
-	gimple_seq_add_stmt(&seq, g);
-	gsi_insert_seq_before(&gsi, seq, GSI_SAME_STMT);
+/* No accesses may be added to the open groups after that. */
+static void
+close_memory_access_groups(MemAccessGroups &open_groups, 
+			   MemAccessGroups &groups)
+{
+	groups.insert(groups.end(), open_groups.begin(), open_groups.end());
+	open_groups.clear();
 }
 
+/* Checks if the same memory has already been read by a statement that 
+ * dominates the one making 'access', with no writes or calls in between.
+ * The read is remembered otherwise.
+ *
+ * The dominators must be processed first for this to find such reads. */
+static bool
+is_redundant_read(MemAccessCollector &collector, const MemAccess &access)
+{
+	tree vuse = gimple_vuse(access.stmt);
+	
+	if (access.is_write || vuse == NULL_TREE || 
+	    gimple_has_volatile_ops(access.stmt) || 
+	    TREE_THIS_VOLATILE(access.expr))
+		return false;
+	
+	std::vector<MemAccess> &reads = collector.reads[vuse];
+	basic_block bb = gimple_bb(access.stmt);
+	
+	for (unsigned int i = 0; i < reads.size(); ++i) {
+		if (reads[i].size == access.size &&
+		    dominated_by_p(CDI_DOMINATORS, bb, 
+				   gimple_bb(reads[i].stmt)) &&
+		    operand_equal_p(reads[i].expr, access.expr, 0))
+			return true;
+	}
+	reads.push_back(access);
+	return false;
+}
+
+/* Checks if the access made in a loop can be reported by a single event 
+ * on entry to the loop and fills 'hoisted' if so. This is possible for:
+ * 
+ * - the reads from the same location in each iteration if the loop does
+ *   not write to memory or call functions;
+ * - the accesses to the consecutive areas in consecutive iterations (the
+ *   stride is the size of the access) if the number of iterations is 
+ *   known on entry to the loop.
+ * 
+ * The statement must be executed in each iteration, so that the number of
+ * the accesses is known too. Only the innermost loop is considered. */
+static bool
+get_hoisted_access(const MemAccess &access, HoistedAccess *hoisted)
+{
+	basic_block bb = gimple_bb(access.stmt);
+	struct loop *loop = bb->loop_father;
+	
+	if (loop == NULL || loop_outer(loop) == NULL ||
+	    gimple_has_volatile_ops(access.stmt) || 
+	    TREE_THIS_VOLATILE(access.expr))
+		return false;
+	
+	/* If the loop has a single exit, the statement that dominates the 
+	 * latch is executed in each iteration if it is before the exit 
+	 * test and in each iteration except the last one if it is after 
+	 * the test. */
+	edge exit = single_exit(loop);
+	if (exit == NULL || !dominated_by_p(CDI_DOMINATORS, loop->latch, bb))
+		return false;
+	
+	bool before_exit = dominated_by_p(CDI_DOMINATORS, exit->src, bb);
+	if (!before_exit && !dominated_by_p(CDI_DOMINATORS, bb, exit->src))
+		return false;
+	
+	/* The address of the accessed area as a function of the 
+	 * iteration number. */
+	tree offset = size_int(access.offset);
+	if (access.var_offset != NULL_TREE) {
+		offset = size_binop(PLUS_EXPR, 
+			fold_convert(sizetype, access.var_offset), offset);
+	}
+	tree addr = fold_build_pointer_plus(
+		build_fold_addr_expr(unshare_expr(access.base)), offset);
+	/* GCC before 8 takes the block the chrec is instantiated below, 
+	 * i.e. the preheader, rather than the edge from it. */
+	tree ev = instantiate_scev(loop_preheader_edge(loop)->src, loop,
+		analyze_scalar_evolution(loop, addr));
+	if (chrec_contains_undetermined(ev))
+		return false;
+	
+	hoisted->loop = loop;
+	hoisted->is_write = access.is_write;
+	hoisted->loc = gimple_location(access.stmt);
+	
+	if (!tree_contains_chrecs(ev, NULL)) {
+		/* The address does not change in the loop. The read must be
+		 * executed at least once and the state of memory it sees 
+		 * must come from outside of the loop. */
+		tree vuse = gimple_vuse(access.stmt);
+		if (access.is_write || !before_exit || vuse == NULL_TREE ||
+		    (!SSA_NAME_IS_DEFAULT_DEF(vuse) &&
+		     flow_bb_inside_loop_p(
+			loop, gimple_bb(SSA_NAME_DEF_STMT(vuse)))))
+			return false;
+		
+		hoisted->start = ev;
+		hoisted->size = size_int(access.size);
+		return true;
+	}
+	
+	if (TREE_CODE(ev) != POLYNOMIAL_CHREC || 
+	    CHREC_VARIABLE(ev) != (unsigned int)loop->num ||
+	    tree_contains_chrecs(CHREC_LEFT(ev), NULL) ||
+	    TREE_CODE(CHREC_RIGHT(ev)) != INTEGER_CST)
+		return false;
+	
+	/* With a larger stride, the area would contain the gaps the loop 
+	 * does not access. */
+	tree step = fold_convert(ssizetype, CHREC_RIGHT(ev));
+	if (!tree_fits_shwi_p(step) || 
+	    (tree_to_shwi(step) != access.size && 
+	     tree_to_shwi(step) != -access.size))
+		return false;
+	
+	tree niter = number_of_latch_executions(loop);
+	if (chrec_contains_undetermined(niter) || 
+	    tree_contains_chrecs(niter, NULL))
+		return false;
+	
+	tree count = fold_convert(sizetype, niter);
+	if (before_exit)
+		count = size_binop(PLUS_EXPR, count, size_one_node);
+	
+	hoisted->start = CHREC_LEFT(ev);
+	hoisted->size = size_binop(MULT_EXPR, count, size_int(access.size));
+	if (tree_to_shwi(step) < 0) {
+		/* The area ends with the first accessed location. */
+		tree delta = size_binop(MINUS_EXPR, ssize_int(access.size),
+			fold_convert(ssizetype, hoisted->size));
+		hoisted->start = fold_build_pointer_plus(
+			hoisted->start, fold_convert(sizetype, delta));
+	}
+	return true;
+}
+
+/* Decides how the access should be reported, if at all. */
 static void
-instrument_gimple(gimple_stmt_iterator *gsi, tree *ls_ptr)
+add_collected_access(MemAccessCollector &collector, const MemAccess &access)
 {
-	gimple stmt;
-	stmt = gsi_stmt (*gsi);
+	HoistedAccess hoisted;
+	
+	if (eliminate_accesses) {
+		if (is_redundant_read(collector, access)) {
+			//<>
+			fprintf(stderr, "[DBG] Redundant read.\n");
+			//<>
+			++stat_redundant_reads;
+			return;
+		}
+		if (get_hoisted_access(access, &hoisted)) {
+			//<>
+			fprintf(stderr, 
+			"[DBG] The %s is reported on entry to loop %d.\n",
+				(access.is_write ? "write" : "read"),
+				hoisted.loop->num);
+			//<>
+			++stat_accesses;
+			++stat_hoisted_accesses;
+			collector.hoisted.push_back(hoisted);
+			return;
+		}
+	}
+	add_memory_access(collector.open_groups, access);
+}
+
+/* Finds the memory accesses to be reported. The code is not changed. */
+static void
+collect_memory_accesses(gimple stmt, MemAccessCollector &collector)
+{
+	MemAccess access;
 	
-	if (is_gimple_call(stmt)) {
-		instrument_function_call(gsi, ls_ptr);
+	if (is_gimple_call(stmt) || gimple_code(stmt) == GIMPLE_ASM) {
+		/* The callee may access the same memory, inline assembly
+		 * may be a memory barrier or may access memory itself. So
+		 * the accesses before and after these must not be merged. 
+		 */
+		close_memory_access_groups(collector.open_groups, 
+					   collector.groups);
 	}
 	else if (is_gimple_assign(stmt) && !gimple_clobber_p(stmt)) {
 		if (gimple_store_p(stmt)) {
 			tree lhs = gimple_assign_lhs(stmt);
-			instrument_expr(*gsi, lhs, true, ls_ptr);
+			if (get_memory_access(stmt, lhs, true, &access))
+				add_collected_access(collector, access);
 		}
 		if (gimple_assign_load_p(stmt)) {
 			tree rhs = gimple_assign_rhs1(stmt);
-			instrument_expr(*gsi, rhs, false, ls_ptr);
+			if (get_memory_access(stmt, rhs, false, &access))
+				add_collected_access(collector, access);
 		}
 	}
 }
 
-/* Process the body of the function. */
+/* Returns the address of the area accessed by the group, as a GIMPLE 
+ * value. The statements needed to compute it are added to 'seq'. */
+static tree
+build_memory_access_group_addr(const MemAccessGroup &group, 
+			       gimple_seq *seq, location_t loc)
+{
+	gimple g;
+	
+	if (group.naccesses == 1) {
+		tree expr_ptr = build_fold_addr_expr(
+			unshare_expr(group.first.expr));
+
+		if (!is_gimple_val(expr_ptr)) {
+			g = gimple_build_assign(
+				make_ssa_name(TREE_TYPE(expr_ptr), NULL),
+				expr_ptr);
+			expr_ptr = gimple_assign_lhs(g);
+			gimple_set_location(g, loc);
+			gimple_seq_add_stmt(seq, g);
+		}
+		return expr_ptr;
+	}
+	
+	/* &base + start. The base is the same for all the accesses in the
+	 * group, so it is available before the first of them. */
+	gimple_seq addr_seq = NULL;
+	tree addr = fold_build_pointer_plus_hwi(
+		build_fold_addr_expr(unshare_expr(group.first.base)),
+		group.start);
+	addr = force_gimple_operand(addr, &addr_seq, true, NULL_TREE);
+	for (gimple_stmt_iterator i = gsi_start(addr_seq); !gsi_end_p(i); 
+	     gsi_next(&i)) {
+		gimple_set_location(gsi_stmt(i), loc);
+	}
+	gimple_seq_add_seq(seq, addr_seq);
+	return addr;
+}
+
+/* Name of the section with the table of access sites, see handlers.h. 
+ * There is no leading dot, so that the linker provides __start_kedr_sites 
+ * and __stop_kedr_sites symbols for the table in the executables. */
+#define ACCESS_SITE_SECTION "kedr_sites"
+
+/* Returns the address of a new record in the table of access sites. 
+ * 'size' is 0 if the size of the accessed area is only known at run time.
+ */
+static tree
+build_access_site(location_t loc, HOST_WIDE_INT size, bool is_write)
+{
+	const AccessSiteInfo &info = get_access_site_info();
+	const char *file = LOCATION_FILE(loc);
+	const char *func = current_function_name();
+	
+	if (file == NULL)
+		file = DECL_SOURCE_FILE(current_function_decl);
+	if (file == NULL)
+		file = "";
+	
+	/* static const struct kedr_access_site __kedr_site.N = {...}; */
+	tree site = build_decl(loc, VAR_DECL, 
+			       create_tmp_var_name("__kedr_site"),
+			       build_qualified_type(info.site_type, 
+						    TYPE_QUAL_CONST));
+	TREE_STATIC(site) = 1;
+	TREE_READONLY(site) = 1;
+	TREE_PUBLIC(site) = 0;
+	TREE_ADDRESSABLE(site) = 1;
+	DECL_ARTIFICIAL(site) = 1;
+	DECL_IGNORED_P(site) = 1;
+	DECL_SECTION_NAME(site) = build_string(strlen(ACCESS_SITE_SECTION),
+					       ACCESS_SITE_SECTION);
+	
+	vec<constructor_elt, va_gc> *elts = NULL;
+	CONSTRUCTOR_APPEND_ELT(elts, info.file_field, 
+		fold_convert(TREE_TYPE(info.file_field), 
+			     build_string_literal(strlen(file) + 1, file)));
+	CONSTRUCTOR_APPEND_ELT(elts, info.func_field, 
+		fold_convert(TREE_TYPE(info.func_field), 
+			     build_string_literal(strlen(func) + 1, func)));
+	CONSTRUCTOR_APPEND_ELT(elts, info.line_field, 
+		build_int_cst(unsigned_type_node, LOCATION_LINE(loc)));
+	CONSTRUCTOR_APPEND_ELT(elts, info.size_field, 
+		build_int_cst(unsigned_type_node, size));
+	CONSTRUCTOR_APPEND_ELT(elts, info.is_write_field, 
+		build_int_cst(unsigned_type_node, is_write));
+	
+	tree init = build_constructor(info.site_type, elts);
+	TREE_CONSTANT(init) = 1;
+	TREE_STATIC(init) = 1;
+	DECL_INITIAL(site) = init;
+	
+	/* Unlike varpool_finalize_decl(), this may be used at any stage of
+	 * compilation, including after IPA ("late" mode). */
+	varpool_add_new_variable(site);
+	
+	return build_fold_addr_expr(site);
+}
+
+/* Adds the call to the handler for the group of memory accesses to 
+ * 'seq', along with the computation of its arguments. */
 static void
-instrument_function(tree *ls_ptr)
+build_memory_access_group_event(const MemAccessGroup &group, tree *ls_ptr,
+				gimple_seq *seq, location_t loc)
+{
+	gimple g;
+	
+	tree addr = build_memory_access_group_addr(group, seq, loc);
+	tree site = build_access_site(loc, group.end - group.start, 
+				      group.first.is_write);
+	
+	if (group.naccesses == 1) {
+		/* call my_func_{read|write}N(addr, site, ls) */
+		g = gimple_build_call(
+			get_memory_event_decl(group.first.size, 
+					      group.first.is_write), 
+			3, addr, site, *ls_ptr);
+	}
+	else {
+		/* call my_func_{read|write}_range(addr, size, site, ls) */
+		g = gimple_build_call(
+			get_memory_range_event_decl(group.first.is_write), 4,
+			addr, 
+			build_int_cst(long_unsigned_type_node, 
+				      group.end - group.start),
+			site, *ls_ptr);
+		
+		//<>
+		fprintf(stderr, 
+			"[DBG] %u %s merged into one event (%ld byte(s)).\n",
+			group.naccesses, 
+			(group.first.is_write ? "writes" : "reads"),
+			(long)(group.end - group.start));
+		//<>
+	}
+	gimple_set_location(g, loc);
+	gimple_seq_add_stmt(seq, g);
+}
+
+/* Emits the call to the handler for the group of memory accesses right 
+ * before the first access in the group. */
+static void
+instrument_memory_access_group(const MemAccessGroup &group, tree *ls_ptr)
+{
+	gimple_stmt_iterator gsi = gsi_for_stmt(group.first.stmt);
+	gimple_seq seq = NULL;
+	
+	++stat_events;
+	
+	build_memory_access_group_event(group, ls_ptr, &seq, 
+					gimple_location(group.first.stmt));
+	gsi_insert_seq_before(&gsi, seq, GSI_SAME_STMT);
+}
+
+/* Splits the block after 'cond', which must be the last statement 
+ * inserted before the access, and creates an empty block executed if the 
+ * condition is true, which is assumed to be very unlikely. Returns that
+ * block. The access and the rest of the original block go to the block 
+ * both branches join in. */
+static basic_block
+create_unlikely_branch(gimple cond)
+{
+	edge e_false = split_block(gimple_bb(cond), cond);
+	basic_block cond_bb = e_false->src;
+	basic_block join_bb = e_false->dest;
+	
+	e_false->flags &= ~EDGE_FALLTHRU;
+	e_false->flags |= EDGE_FALSE_VALUE;
+	e_false->probability = REG_BR_PROB_BASE - PROB_VERY_UNLIKELY;
+	
+	basic_block then_bb = create_empty_bb(cond_bb);
+	edge e_true = make_edge(cond_bb, then_bb, EDGE_TRUE_VALUE);
+	e_true->probability = PROB_VERY_UNLIKELY;
+	make_single_succ_edge(then_bb, join_bb, EDGE_FALLTHRU);
+	if (current_loops)
+		add_bb_to_loop(then_bb, cond_bb->loop_father);
+	
+	return then_bb;
+}
+
+/* Emits the call to the handler for the group of memory accesses in 
+ * sampling mode. The handler is called only when the countdown reaches 0:
+ *
+ *	c = countdown;
+ *	c = c - 1;
+ *	countdown = c;
+ *	if (c == 0) {
+ *		my_func_{read|write}...(addr, ..., ls);
+ *		countdown = my_func_sample_countdown(ls);
+ *	}
+ * 
+ * The block is split for that. */
+static void
+instrument_memory_access_group_sampled(const MemAccessGroup &group, 
+				       tree countdown, tree *ls_ptr)
+{
+	gimple_stmt_iterator gsi = gsi_for_stmt(group.first.stmt);
+	location_t loc = gimple_location(group.first.stmt);
+	gimple_seq seq = NULL;
+	gimple g;
+	
+	++stat_events;
+	
+	tree c = make_ssa_name(long_unsigned_type_node, NULL);
+	g = gimple_build_assign(c, countdown);
+	gimple_seq_add_stmt(&seq, g);
+	
+	tree c_next = make_ssa_name(long_unsigned_type_node, NULL);
+	g = gimple_build_assign_with_ops(MINUS_EXPR, c_next, c, 
+		build_int_cst(long_unsigned_type_node, 1));
+	gimple_seq_add_stmt(&seq, g);
+	
+	g = gimple_build_assign(countdown, c_next);
+	gimple_seq_add_stmt(&seq, g);
+	
+	gimple cond = gimple_build_cond(EQ_EXPR, c_next, 
+		build_int_cst(long_unsigned_type_node, 0),
+		NULL_TREE, NULL_TREE);
+	gimple_seq_add_stmt(&seq, cond);
+	
+	for (gimple_stmt_iterator i = gsi_start(seq); !gsi_end_p(i); 
+	     gsi_next(&i)) {
+		gimple_set_location(gsi_stmt(i), loc);
+	}
+	gsi_insert_seq_before(&gsi, seq, GSI_SAME_STMT);
+	
+	basic_block then_bb = create_unlikely_branch(cond);
+	
+	/* The address is computed only if the event is reported. */
+	seq = NULL;
+	build_memory_access_group_event(group, ls_ptr, &seq, loc);
+	
+	g = gimple_build_call(get_sample_countdown_decl(), 1, *ls_ptr);
+	gimple_call_set_lhs(g, countdown);
+	gimple_set_location(g, loc);
+	gimple_seq_add_stmt(&seq, g);
+	
+	gsi = gsi_start_bb(then_bb);
+	gsi_insert_seq_after(&gsi, seq, GSI_NEW_STMT);
+}
+
+/* Emits the call to the range handler for the hoisted accesses at the end
+ * of the preheader of the loop. In batch mode, the log is flushed first to
+ * keep the events in order. In sampling mode, such events are not subject
+ * to sampling: each of them is executed once per loop and stands for many
+ * accesses. */
+static void
+instrument_hoisted_access(const HoistedAccess &hoisted, tree log, 
+			  tree *ls_ptr)
+{
+	gimple_seq seq = NULL;
+	gimple g;
+	
+	++stat_events;
+	
+	tree start = force_gimple_operand(unshare_expr(hoisted.start), &seq,
+					  true, NULL_TREE);
+	tree size = force_gimple_operand(
+		fold_convert(long_unsigned_type_node, 
+			     unshare_expr(hoisted.size)),
+		&seq, true, NULL_TREE);
+	
+	if (log != NULL_TREE) {
+		gimple_seq_add_stmt(&seq, 
+			build_access_log_flush(log, ls_ptr, hoisted.loc));
+	}
+	
+	/* call my_func_{read|write}_range(start, size, site, ls) */
+	g = gimple_build_call(get_memory_range_event_decl(hoisted.is_write), 
+			      4, start, size, 
+			      build_access_site(hoisted.loc, 0, 
+						hoisted.is_write),
+			      *ls_ptr);
+	gimple_seq_add_stmt(&seq, g);
+	
+	for (gimple_stmt_iterator i = gsi_start(seq); !gsi_end_p(i); 
+	     gsi_next(&i)) {
+		gimple_set_location(gsi_stmt(i), hoisted.loc);
+	}
+	gsi_insert_seq_on_edge_immediate(loop_preheader_edge(hoisted.loop), 
+					 seq);
+}
+
+/* Records the group of memory accesses into the log right before the 
+ * first access in the group:
+ * 
+ * 	n = log.count;
+ *	log.accesses[n] = {addr, size, line, is_write};
+ *	n = n + 1;
+ *	log.count = n;
+ *	if (n == nentries)
+ *		my_func_flush_accesses(&log, ls);
+ * 
+ * The basic block is split for that. */
+static void
+record_memory_access_group(const MemAccessGroup &group, tree log, 
+			   tree *ls_ptr)
+{
+	const AccessLogInfo &info = get_access_log_info();
+	gimple_stmt_iterator gsi = gsi_for_stmt(group.first.stmt);
+	location_t loc = gimple_location(group.first.stmt);
+	gimple_seq seq = NULL;
+	gimple g;
+	
+	++stat_events;
+	
+	tree addr = build_memory_access_group_addr(group, &seq, loc);
+	
+	tree n = make_ssa_name(long_unsigned_type_node, NULL);
+	g = gimple_build_assign(n, build_access_log_count_ref(log));
+	gimple_seq_add_stmt(&seq, g);
+	
+	tree values[4] = {
+		addr,
+		build_int_cst(long_unsigned_type_node, 
+			      group.end - group.start),
+		build_int_cst(unsigned_type_node, LOCATION_LINE(loc)),
+		build_int_cst(unsigned_type_node, group.first.is_write)
+	};
+	tree fields[4] = {
+		info.addr_field, 
+		info.size_field, 
+		info.line_field, 
+		info.is_write_field
+	};
+	for (unsigned int i = 0; i < 4; ++i) {
+		g = gimple_build_assign(
+			build_access_log_entry_ref(log, n, fields[i]), 
+			values[i]);
+		gimple_seq_add_stmt(&seq, g);
+	}
+	
+	tree n_next = make_ssa_name(long_unsigned_type_node, NULL);
+	g = gimple_build_assign_with_ops(PLUS_EXPR, n_next, n, 
+		build_int_cst(long_unsigned_type_node, 1));
+	gimple_seq_add_stmt(&seq, g);
+	
+	g = gimple_build_assign(build_access_log_count_ref(log), n_next);
+	gimple_seq_add_stmt(&seq, g);
+	
+	gimple cond = gimple_build_cond(EQ_EXPR, n_next, 
+		build_int_cst(long_unsigned_type_node, info.nentries),
+		NULL_TREE, NULL_TREE);
+	gimple_seq_add_stmt(&seq, cond);
+	
+	for (gimple_stmt_iterator i = gsi_start(seq); !gsi_end_p(i); 
+	     gsi_next(&i)) {
+		gimple_set_location(gsi_stmt(i), loc);
+	}
+	gsi_insert_seq_before(&gsi, seq, GSI_SAME_STMT);
+	
+	basic_block then_bb = create_unlikely_branch(cond);
+	gsi = gsi_start_bb(then_bb);
+	gsi_insert_after(&gsi, build_access_log_flush(log, ls_ptr, loc), 
+			 GSI_NEW_STMT);
+}
+
+/* Process the body of the function. 'do_memory' and 'do_calls' tell 
+ * whether memory accesses and function calls, respectively, should be 
+ * instrumented.
+ * 
+ * In batch mode, '*log_ptr' is set to the log of memory accesses if the
+ * function makes any, NULL_TREE otherwise. Similarly, in sampling mode,
+ * '*countdown_ptr' is set to the countdown variable to be initialized at 
+ * the entry to the function. */
+static void
+instrument_function(tree *ls_ptr, tree *log_ptr, tree *countdown_ptr,
+		    bool do_memory, bool do_calls)
 {
 	basic_block bb;
 	gimple_stmt_iterator gsi;
+	MemAccessCollector collector;
+	MemAccessGroups &groups = collector.groups;
+	bool analyze_loops = (do_memory && eliminate_accesses);
+	
+	*log_ptr = NULL_TREE;
+	*countdown_ptr = NULL_TREE;
 	
+	if (analyze_loops) {
+		/* This also creates the preheaders for the loops. */
+		loop_optimizer_init(LOOPS_NORMAL | LOOPS_HAVE_RECORDED_EXITS);
+		scev_initialize();
+		calculate_dominance_info(CDI_DOMINATORS);
+	}
+	
+	/* Memory accesses are found first, because they are instrumented
+	 * differently depending on whether there are any. The blocks are 
+	 * processed in reverse post-order, so that each block comes after 
+	 * its dominators. */
+	if (do_memory) {
+		int *rpo = XNEWVEC(int, n_basic_blocks_for_fn(cfun));
+		int nblocks = pre_and_rev_post_order_compute(NULL, rpo, false);
+		for (int i = 0; i < nblocks; ++i) {
+			bb = BASIC_BLOCK_FOR_FN(cfun, rpo[i]);
+			for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); 
+			     gsi_next(&gsi)) {
+				collect_memory_accesses(gsi_stmt(gsi), 
+							collector);
+			}
+			close_memory_access_groups(collector.open_groups, 
+						   groups);
+		}
+		XDELETEVEC(rpo);
+	}
+	
+	if (analyze_loops)
+		scev_finalize();
+	
+	if (access_log_size != 0 && !groups.empty())
+		*log_ptr = create_access_log();
+	
+	if (sample_accesses && !groups.empty()) {
+		*countdown_ptr = create_tmp_var(long_unsigned_type_node, 
+						"__kedr_sample_countdown");
+		add_referenced_var(*countdown_ptr);
+		mark_addressable(*countdown_ptr);
+	}
+	
+	/* The log is flushed before each call, so the events of the 
+	 * callee and the handlers of the call come after the accesses 
+	 * made before it. */
 	FOR_EACH_BB_FN (bb, cfun) {
 		for (gsi = gsi_start_bb(bb); !gsi_end_p(gsi); 
 		     gsi_next(&gsi)) {
-			instrument_gimple(&gsi, ls_ptr);
+			gimple stmt = gsi_stmt(gsi);
+			if (!is_gimple_call(stmt))
+				continue;
+			
+			if (*log_ptr != NULL_TREE && 
+			    !gimple_call_internal_p(stmt)) {
+				gsi_insert_before(&gsi, 
+					build_access_log_flush(
+						*log_ptr, ls_ptr, 
+						gimple_location(stmt)),
+					GSI_SAME_STMT);
+			}
+			if (do_calls)
+				instrument_function_call(&gsi, ls_ptr);
 		}
 	}
+	
+	for (unsigned int i = 0; i < collector.hoisted.size(); ++i) {
+		instrument_hoisted_access(collector.hoisted[i], *log_ptr, 
+					  ls_ptr);
+	}
+	
+	if (*countdown_ptr != NULL_TREE) {
+		for (unsigned int i = 0; i < groups.size(); ++i) {
+			instrument_memory_access_group_sampled(
+				groups[i], *countdown_ptr, ls_ptr);
+		}
+		
+		/* The blocks have been split. */
+		free_dominance_info(CDI_DOMINATORS);
+	}
+	else if (*log_ptr == NULL_TREE) {
+		for (unsigned int i = 0; i < groups.size(); ++i)
+			instrument_memory_access_group(groups[i], ls_ptr);
+	}
+	else {
+		for (unsigned int i = 0; i < groups.size(); ++i)
+			record_memory_access_group(groups[i], *log_ptr, ls_ptr);
+		
+		instrument_access_log_init(*log_ptr);
+		
+		/* The blocks have been split. */
+		free_dominance_info(CDI_DOMINATORS);
+	}
+	
+	if (analyze_loops)
+		loop_optimizer_finalize();
+}
+
+/* Returns the number of the inlined function bodies in the given block 
+ * tree, as far as the tree keeps track of them. */
+static unsigned int
+count_inlined_functions(tree block)
+{
+	unsigned int n = 0;
+	
+	for (; block != NULL_TREE; block = BLOCK_CHAIN(block)) {
+		if (inlined_function_outer_scope_p(block))
+			++n;
+		n += count_inlined_functions(BLOCK_SUBBLOCKS(block));
+	}
+	return n;
 }
 
 /* The main function of the pass. Called for each function to be processed.
@@ -598,6 +1533,8 @@ static unsigned int
 do_execute()
 {
 	tree ls_ptr; /* Pointer to the local storage struct. */
+	tree log; /* Log of memory accesses in batch mode. */
+	tree countdown; /* Countdown to the next event in sampling mode. */
 	
 	if (!should_instrument()) {
 		//<>
@@ -607,6 +1544,26 @@ do_execute()
 		return 0;
 	}
 	
+	/* The entry and exit handlers also create and destroy the local 
+	 * storage the other handlers need. So if memory accesses or calls
+	 * are instrumented in the function, so are its entry and exit, 
+	 * whatever the lists for the latter say. */
+	const char *name = current_function_name();
+	const char *file = DECL_SOURCE_FILE(current_function_decl);
+	bool do_memory = filter_allows(EC_MEMORY, name, file);
+	bool do_calls = filter_allows(EC_CALLS, name, file);
+	
+	if (!do_memory && !do_calls && 
+	    !filter_allows(EC_FUNCTIONS, name, file)) {
+		//<>
+		fprintf(stderr, 
+			"[DBG] Function \"%s\" is excluded by the lists.\n",
+			name);
+		//<>
+		++stat_excluded_functions;
+		return 0;
+	}
+	
 	//<>
 	fprintf(stderr, "[DBG] Processing function \"%s\".\n",
 		current_function_name());
@@ -617,9 +1574,17 @@ do_execute()
 	mark_addressable(ls_ptr);
 	// TREE_THIS_VOLATILE(ls_ptr) = 1;
 	
-	instrument_function(&ls_ptr); /* Keep it first. */
-	instrument_fentry(&ls_ptr);
-	instrument_fexit(&ls_ptr);
+	/* Before inlining, entry and exit of each inlined function would 
+	 * have been reported too. */
+	if (instrument_late) {
+		stat_inlined_functions += count_inlined_functions(
+			DECL_INITIAL(current_function_decl));
+	}
+	
+	/* Keep it first. */
+	instrument_function(&ls_ptr, &log, &countdown, do_memory, do_calls);
+	instrument_fentry(&ls_ptr, countdown);
+	instrument_fexit(&ls_ptr, log);
 	
 
 	/*
@@ -696,6 +1661,58 @@ static struct opt_pass *make_my_pass(void)
 }
 /* ====================================================================== */
 
+/* The include/exclude lists: "include" and "exclude" arguments apply to 
+ * all kinds of events, "include-<class>" and "exclude-<class>" - to the 
+ * given class only. The value is the file with the patterns. */
+struct FilterArg {
+	const char *key;
+	bool include;
+	EEventClass ec;
+};
+
+static const FilterArg filter_args[] = {
+	{"include",		true,	EC_NUM_CLASSES},
+	{"exclude",		false,	EC_NUM_CLASSES},
+	{"include-memory",	true,	EC_MEMORY},
+	{"exclude-memory",	false,	EC_MEMORY},
+	{"include-calls",	true,	EC_CALLS},
+	{"exclude-calls",	false,	EC_CALLS},
+	{"include-functions",	true,	EC_FUNCTIONS},
+	{"exclude-functions",	false,	EC_FUNCTIONS},
+};
+
+static const FilterArg *
+find_filter_arg(const char *key)
+{
+	for (unsigned int i = 0; 
+	     i < sizeof(filter_args) / sizeof(filter_args[0]); ++i) {
+		if (strcmp(key, filter_args[i].key) == 0)
+			return &filter_args[i];
+	}
+	return NULL;
+}
+
+static bool
+is_filter_arg(const char *key)
+{
+	return find_filter_arg(key) != NULL;
+}
+
+/* Loads the patterns for the argument. Each of these arguments may be 
+ * specified several times, the patterns are added to the lists. */
+static bool
+process_filter_arg(const char *key, const char *value)
+{
+	const FilterArg *fa = find_filter_arg(key);
+	
+	if (value == NULL || value[0] == 0) {
+		fprintf(stderr, "\"%s\" argument requires a file name.\n", 
+			key);
+		return false;
+	}
+	return load_filter_file(value, fa->include, fa->ec);
+}
+
 int
 plugin_init(struct plugin_name_args *plugin_info,
 	    struct plugin_gcc_version *version)
@@ -707,10 +1724,69 @@ plugin_init(struct plugin_name_args *plugin_info,
 	
 	// TODO: help string for the plugin, etc.
 	
+	for (int i = 0; i < plugin_info->argc; ++i) {
+		const char *key = plugin_info->argv[i].key;
+		
+		const char *value = plugin_info->argv[i].value;
+		
+		if (strcmp(key, "no-coalesce") == 0) {
+			coalesce_accesses = false;
+		}
+		else if (strcmp(key, "late") == 0) {
+			instrument_late = true;
+		}
+		else if (strcmp(key, "no-eliminate") == 0) {
+			eliminate_accesses = false;
+		}
+		else if (strcmp(key, "sample") == 0) {
+			sample_accesses = true;
+		}
+		else if (is_filter_arg(key)) {
+			if (!process_filter_arg(key, value))
+				return 1;
+		}
+		else if (strcmp(key, "batch") == 0) {
+			access_log_size = (value != NULL) ? 
+				(unsigned int)atoi(value) : 
+				DEFAULT_ACCESS_LOG_SIZE;
+			if (access_log_size == 0 || 
+			    access_log_size > MAX_ACCESS_LOG_SIZE) {
+				fprintf(stderr, 
+			"Number of log entries should be in 1..%u range.\n",
+					MAX_ACCESS_LOG_SIZE);
+				return 1;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown argument of the plugin: %s\n",
+				key);
+			return 1;
+		}
+	}
+	
+	/* The sampled events are reported right away, there is nothing to
+	 * be logged. */
+	if (sample_accesses && access_log_size != 0) {
+		fprintf(stderr, 
+	"\"sample\" and \"batch\" arguments cannot be used together.\n");
+		return 1;
+	}
+	
 	pass_info.pass = make_my_pass();
-	pass_info.reference_pass_name = "ssa";
-	/* consider only the 1st occasion of the reference pass */
-	pass_info.ref_pass_instance_number = 1;
+	if (instrument_late) {
+		/* The 2nd occasion of "fre" is in the main optimization 
+		 * pipeline, after IPA inlining and after "alias" pass has
+		 * computed the points-to information. Only the functions 
+		 * that remain out-of-line get there. 
+		 * [NB] This pipeline is not executed with -O0. */
+		pass_info.reference_pass_name = "fre";
+		pass_info.ref_pass_instance_number = 2;
+	}
+	else {
+		pass_info.reference_pass_name = "ssa";
+		/* consider only the 1st occasion of the reference pass */
+		pass_info.ref_pass_instance_number = 1;
+	}
 	pass_info.pos_op = PASS_POS_INSERT_AFTER;
 	
 	//<>
@@ -727,6 +1803,8 @@ plugin_init(struct plugin_name_args *plugin_info,
 	 * GIMPLE pass. */
 	register_callback(plugin_info->base_name, PLUGIN_START_UNIT, 
 			  &my_start_unit, NULL);
+	register_callback(plugin_info->base_name, PLUGIN_FINISH_UNIT, 
+			  &my_finish_unit, NULL);
 	
 	/* Register the pass */
 	register_callback(plugin_info->base_name, PLUGIN_PASS_MANAGER_SETUP,
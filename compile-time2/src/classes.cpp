@@ -1,77 +1,25 @@
 #include "common_includes.h"
 #include "i13n.h"
 
-#include <map>
+#include <deque>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <cassert>
 /* ====================================================================== */
 
-/* 
-* kmalloc-like functions
-* Arguments: (size_t size, gfp_t gfp); 
-* return value: void *.
-*/
-static struct kedr_function_class class_kmalloc = {
-	.arg_pos = {1 /* size */, 2 /* gfp */, 0},
-	.need_ret = true,
-	.name_pre = "kedr_stub_kmalloc_pre",
-	.name_post = "kedr_stub_kmalloc_post",
-	.decl_pre = NULL_TREE,
-	.decl_post = NULL_TREE
-};
-
-/* 
- * kfree-like functions
- * Arguments: (void *);
- * return value: none. 
- */
-static kedr_function_class class_kfree = {
-	.arg_pos = {1 /* ptr */, 0},
-	.need_ret = false,
-	.name_pre = "kedr_stub_kfree_pre",
-	.name_post = "kedr_stub_kfree_post",
-	.decl_pre = NULL_TREE,
-	.decl_post = NULL_TREE
-};
-
-/* 
- * kmem_cache_alloc-like functions
- * Arguments: (struct kmem_cache *, gfp_t);
- * return value: void *. 
- */
-static kedr_function_class class_kmc_alloc = {
-	.arg_pos = {1 /* kmem_cache */, 2 /* gfp */, 0},
-	.need_ret = true,
-	.name_pre = "kedr_stub_kmc_alloc_pre",
-	.name_post = "kedr_stub_kmc_alloc_post",
-	.decl_pre = NULL_TREE,
-	.decl_post = NULL_TREE
-};
-
-/* 
- * kmem_cache_free
- * Arguments: (struct kmem_cache *, void *);
- * return value: none. 
- */
-static kedr_function_class class_kmc_free = {
-	.arg_pos = {1 /* kmem_cache */, 2 /* ptr */, 0},
-	.need_ret = false,
-	.name_pre = "kedr_stub_kmc_free_pre",
-	.name_post = "kedr_stub_kmc_free_post",
-	.decl_pre = NULL_TREE,
-	.decl_post = NULL_TREE
-};
-/* ====================================================================== */
-
 namespace {
 
 class function_matcher
 {
 private:
-	typedef std::map<std::string, kedr_function_class *> TClassMap;
+	typedef std::unordered_map<std::string, kedr_function_class *> 
+		TClassMap;
 public:
-	function_matcher();
+	function_matcher()
+		: path(NULL), lineno(0), current(NULL)
+	{}
 
 	kedr_function_class *
 	get_class_by_fname(const std::string & fname) {
@@ -84,49 +32,235 @@ public:
 		return it->second;
 	}
 
+	/* Load the classes from the spec file, see i13n.h. */
+	bool load(const char *spec_path);
+
 private:
-	/* Populate the map with {fname => function_class} pairs. */
-	void populate_map();
+	bool parse_line(const std::string & line);
+	bool parse_property(const std::string & key, 
+			    const std::string & value);
+	bool check_class();
 
 private:
+	/* 
+	 * The classes themselves. std::deque does not move its elements
+	 * when new ones are added, so the pointers to them remain valid.
+	 */
+	std::deque<kedr_function_class> storage;
+
+	/* {fname => function_class} */
 	TClassMap classes;
+
+	/* The state of the parser. */
+	const char *path;
+	unsigned int lineno;
+	kedr_function_class *current;
 };
 
-function_matcher::function_matcher()
+static std::string
+trim(const std::string & s)
 {
-	populate_map();
+	static const char spaces[] = " \t\r\n";
+	size_t first = s.find_first_not_of(spaces);
+
+	if (first == std::string::npos)
+		return std::string();
+	return s.substr(first, s.find_last_not_of(spaces) - first + 1);
 }
 
-void
-function_matcher::populate_map()
+/* Split the string into the words separated by spaces or tabs. */
+static std::vector<std::string>
+split(const std::string & s)
 {
-	/* kmalloc */
-	classes["__kmalloc"] = &class_kmalloc;
-	classes["kmalloc_order"] = &class_kmalloc;
-	classes["kmalloc_order_trace"] = &class_kmalloc;
-	classes["alloc_pages_exact"] = &class_kmalloc;
-
-	/* kmem_cache_alloc */
-	classes["kmem_cache_alloc"] = &class_kmc_alloc;
-	classes["kmem_cache_alloc_node"] = &class_kmc_alloc;
-	classes["kmem_cache_alloc_trace"] = &class_kmc_alloc;
-	classes["kmem_cache_alloc_node_trace"] = &class_kmc_alloc;
-	
-	/* kfree */
-	classes["kfree"] = &class_kfree;
-	classes["kzfree"] = &class_kfree;
-	classes["free_pages_exact"] = &class_kfree;
-	classes["vfree"] = &class_kfree;
-	classes["kvfree"] = &class_kfree;
-	
-	/* kmem_cache_free */
-	classes["kmem_cache_free"] = &class_kmc_free;
+	static const char spaces[] = " \t";
+	std::vector<std::string> words;
+	size_t pos = 0;
+
+	for (;;) {
+		size_t first = s.find_first_not_of(spaces, pos);
+		if (first == std::string::npos)
+			break;
+
+		pos = s.find_first_of(spaces, first);
+		words.push_back(s.substr(first, pos - first));
+		if (pos == std::string::npos)
+			break;
+	}
+	return words;
+}
+
+bool
+function_matcher::load(const char *spec_path)
+{
+	FILE *f;
+	char *buf = NULL;
+	size_t len = 0;
+	bool ok = true;
+
+	f = fopen(spec_path, "r");
+	if (!f) {
+		error("kedr-i13n: failed to open \"%s\"", spec_path);
+		return false;
+	}
+
+	path = spec_path;
+	lineno = 0;
+	current = NULL;
+
+	while (ok && getline(&buf, &len, f) != -1) {
+		++lineno;
+		ok = parse_line(buf);
+	}
+	free(buf);
+
+	if (ok && ferror(f)) {
+		error("kedr-i13n: failed to read \"%s\"", spec_path);
+		ok = false;
+	}
+	fclose(f);
+
+	if (ok && current)
+		ok = check_class();
+	return ok;
+}
+
+bool
+function_matcher::parse_line(const std::string & raw)
+{
+	std::string line = trim(raw.substr(0, raw.find('#')));
+
+	if (line.empty())
+		return true;
+
+	if (line[0] == '[') {
+		if (current && !check_class())
+			return false;
+
+		std::string name;
+		if (line[line.size() - 1] == ']')
+			name = trim(line.substr(1, line.size() - 2));
+		if (name.empty()) {
+			error("%s:%u: invalid class header \"%s\"", 
+			      path, lineno, line.c_str());
+			return false;
+		}
+
+		/* Value-initialization zeroes arg_pos[], need_ret and the 
+		 * decls. */
+		storage.push_back(kedr_function_class());
+		current = &storage.back();
+		current->name = name;
+		return true;
+	}
+
+	size_t eq = line.find('=');
+	if (eq == std::string::npos) {
+		error("%s:%u: expected \"<key> = <value>\"", path, lineno);
+		return false;
+	}
+	if (!current) {
+		error("%s:%u: no [<class>] header before \"%s\"",
+		      path, lineno, line.c_str());
+		return false;
+	}
+	return parse_property(trim(line.substr(0, eq)), 
+			      trim(line.substr(eq + 1)));
+}
+
+bool
+function_matcher::parse_property(const std::string & key, 
+				 const std::string & value)
+{
+	std::vector<std::string> words = split(value);
+
+	if (key == "args") {
+		if (words.size() > KEDR_NR_ARGS) {
+			error("%s:%u: at most %d arguments can be passed to "
+			      "the handlers", path, lineno, KEDR_NR_ARGS);
+			return false;
+		}
+		for (size_t i = 0; i < words.size(); ++i) {
+			char *end;
+			unsigned long pos = 
+				strtoul(words[i].c_str(), &end, 10);
+			if (*end != 0 || pos == 0 || pos > UCHAR_MAX) {
+				error("%s:%u: invalid argument position "
+				      "\"%s\"", path, lineno, 
+				      words[i].c_str());
+				return false;
+			}
+			current->arg_pos[i] = (unsigned char)pos;
+		}
+		current->arg_pos[words.size()] = 0;
+		return true;
+	}
+
+	if (key == "ret") {
+		if (value == "yes" || value == "no") {
+			current->need_ret = (value == "yes");
+			return true;
+		}
+		error("%s:%u: \"ret\" must be \"yes\" or \"no\"", 
+		      path, lineno);
+		return false;
+	}
+
+	if (key == "pre" || key == "post") {
+		if (words.size() != 1) {
+			error("%s:%u: \"%s\" must be a single name", 
+			      path, lineno, key.c_str());
+			return false;
+		}
+		if (key == "pre")
+			current->name_pre = words[0];
+		else
+			current->name_post = words[0];
+		return true;
+	}
+
+	if (key == "functions") {
+		for (size_t i = 0; i < words.size(); ++i) {
+			std::pair<TClassMap::iterator, bool> res = 
+				classes.insert(std::make_pair(
+					words[i], current));
+			if (!res.second) {
+				error("%s:%u: %s already belongs to class "
+				      "\"%s\"", path, lineno, 
+				      words[i].c_str(), 
+				      res.first->second->name.c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	error("%s:%u: unknown key \"%s\"", path, lineno, key.c_str());
+	return false;
+}
+
+/* Check the class that has just been parsed. */
+bool
+function_matcher::check_class()
+{
+	if (current->name_pre.empty() || current->name_post.empty()) {
+		error("%s: class \"%s\" must have both \"pre\" and \"post\" "
+		      "handlers", path, current->name.c_str());
+		return false;
+	}
+	return true;
 }
 /* ====================================================================== */
 } /* end of anon namespace */
 
-/* This makes sure the matcher is initialized before everything else. */
-static function_matcher fm; 
+/* The classes are loaded by plugin_init(), before any function is
+ * processed. */
+static function_matcher fm;
+
+bool
+kedr_load_function_classes(const char *path)
+{
+	return fm.load(path);
+}
 
 static tree make_decl_pre(const kedr_function_class *fc)
 {
@@ -141,7 +275,7 @@ static tree make_decl_pre(const kedr_function_class *fc)
 
 	tree fntype = build_function_type_array(
 		void_type_node, i + 1, arg_types);
-	tree decl = build_fn_decl(fc->name_pre, fntype);
+	tree decl = build_fn_decl(fc->name_pre.c_str(), fntype);
 
 	assert(decl != NULL_TREE);
 	kedr_set_fndecl_properties(decl);
@@ -161,7 +295,7 @@ static tree make_decl_post(const kedr_function_class *fc)
 
 	tree fntype = build_function_type_array(
 		void_type_node, i + 1, arg_types);
-	tree decl = build_fn_decl(fc->name_post, fntype);
+	tree decl = build_fn_decl(fc->name_post.c_str(), fntype);
 
 	assert(decl != NULL_TREE);
 	kedr_set_fndecl_properties(decl);
@@ -168,6 +168,28 @@ instrument_function_call(gimple_stmt_iterator *gsi, tree &ls_ptr)
 	if (!fc) /* No class is defined for this function, skip it. */
 		return false;
 
+	/* 
+	 * The classes come from the spec file, so check that they fit the 
+	 * call rather than crash on a mistake there.
+	 */
+	for (int i = 0; fc->arg_pos[i]; ++i) {
+		if (fc->arg_pos[i] > gimple_call_num_args(stmt)) {
+			warning_at(gimple_location(stmt), 0,
+				"kedr-i13n: call to %s has no argument #%d "
+				"needed for class \"%s\", not instrumented",
+				name, (int)fc->arg_pos[i], fc->name.c_str());
+			return false;
+		}
+	}
+	if (fc->need_ret && VOID_TYPE_P(
+		gimple_call_return_type(as_a<gcall *>(stmt)))) {
+		warning_at(gimple_location(stmt), 0,
+			"kedr-i13n: %s returns void but class \"%s\" needs "
+			"the return value, not instrumented",
+			name, fc->name.c_str());
+		return false;
+	}
+
 	//<>
 	fprintf(stderr, "[DBG] Direct call to %s\n", name);
 	//<>
@@ -322,6 +344,25 @@ plugin_init(struct plugin_name_args *plugin_info,
 	if (!plugin_default_version_check(version, &gcc_version))
 		return 1;
 
+	for (int i = 0; i < plugin_info->argc; ++i) {
+		const struct plugin_argument *arg = &plugin_info->argv[i];
+
+		/* -fplugin-arg-kedr-i13n-classes=<spec_file> */
+		if (strcmp(arg->key, "classes") == 0) {
+			if (!arg->value) {
+				error("kedr-i13n: \"classes\" requires a spec "
+				      "file");
+				return 1;
+			}
+			if (!kedr_load_function_classes(arg->value))
+				return 1;
+			continue;
+		}
+
+		error("kedr-i13n: unknown argument \"%s\"", arg->key);
+		return 1;
+	}
+
 	// TODO: help string for the plugin, etc.
 
 	pass_info.pass = new kedr_i13n_pass();
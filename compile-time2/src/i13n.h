@@ -1,6 +1,8 @@
 #ifndef I13N_H_1230_INCLUDED
 #define I13N_H_1230_INCLUDED
 
+#include <string>
+
 /* 
  * How many arguments of a called function to pass to the handlers
  * (at most).
@@ -66,14 +68,42 @@ struct kedr_function_class
 	 * instance of struct kedr_local lptr points to. This will make them
 	 * available in the post-handler.
 	 */
-	const char *name_pre;
-	const char *name_post;
+	std::string name_pre;
+	std::string name_post;
+
+	/* Name of the class in the spec file, for diagnostics. */
+	std::string name;
 
 	/* DECLs for the handlers that can be used to generate the calls. */
 	tree decl_pre;
 	tree decl_post;
 };
 
+/*
+ * Loads the function classes from the spec file and adds them to the ones
+ * loaded before. The file is a list of sections, one per class:
+ *
+ *   # Comment
+ *   [kmalloc]
+ *   args = 1 2
+ *   ret = yes
+ *   pre = kedr_stub_kmalloc_pre
+ *   post = kedr_stub_kmalloc_post
+ *   functions = __kmalloc kmalloc_order
+ *   functions = alloc_pages_exact
+ *
+ * 'args' are the positions for arg_pos[] (none by default), 'ret' is
+ * need_ret ("yes" or "no", "no" by default), 'pre' and 'post' are the
+ * names of the handlers (required). 'functions' lists the names of the 
+ * target functions and may be repeated. A function may belong to only one
+ * class.
+ *
+ * Returns false and reports the error if the file cannot be read or is 
+ * invalid.
+ */
+bool
+kedr_load_function_classes(const char *path);
+
 /*
  * Returns a pointer to the kedr_function_class instance for a function with
  * the given name if found, NULL if not.
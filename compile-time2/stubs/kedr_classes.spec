@@ -0,0 +1,46 @@
+# Function classes for the handlers from kedr_stubs.c, see
+# kedr_load_function_classes() in src/i13n.h for the format.
+#
+# Pass the file to the plugin with
+#   -fplugin-arg-kedr-i13n-classes=<path>/kedr_classes.spec
+# The argument may be repeated to load the classes from several files.
+
+# kmalloc-like functions
+# Arguments: (size_t size, gfp_t gfp);
+# return value: void *.
+[kmalloc]
+args = 1 2
+ret = yes
+pre = kedr_stub_kmalloc_pre
+post = kedr_stub_kmalloc_post
+functions = __kmalloc kmalloc_order kmalloc_order_trace
+functions = alloc_pages_exact
+
+# kfree-like functions
+# Arguments: (void *);
+# return value: none.
+[kfree]
+args = 1
+pre = kedr_stub_kfree_pre
+post = kedr_stub_kfree_post
+functions = kfree kzfree free_pages_exact vfree kvfree
+
+# kmem_cache_alloc-like functions
+# Arguments: (struct kmem_cache *, gfp_t);
+# return value: void *.
+[kmc_alloc]
+args = 1 2
+ret = yes
+pre = kedr_stub_kmc_alloc_pre
+post = kedr_stub_kmc_alloc_post
+functions = kmem_cache_alloc kmem_cache_alloc_node
+functions = kmem_cache_alloc_trace kmem_cache_alloc_node_trace
+
+# kmem_cache_free
+# Arguments: (struct kmem_cache *, void *);
+# return value: none.
+[kmc_free]
+args = 1 2
+pre = kedr_stub_kmc_free_pre
+post = kedr_stub_kmc_free_post
+functions = kmem_cache_free
@@ -0,0 +1,85 @@
+/*
+ * Helpers for benchmarks.
+ */
+
+#ifndef BENCHMARK_HH
+#define BENCHMARK_HH
+
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+/* Measure wall-clock time of some operation. */
+class BenchmarkTimer
+{
+public:
+    BenchmarkTimer() {restart();}
+    
+    void restart(void) {clock_gettime(CLOCK_MONOTONIC, &start);}
+    
+    /* Seconds elapsed since construction or last restart(). */
+    double elapsed(void) const
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - start.tv_sec)
+            + (now.tv_nsec - start.tv_nsec) / 1e9;
+    }
+private:
+    struct timespec start;
+};
+
+/* Return size of file in bytes, or -1 on error. */
+static inline long long benchmarkFileSize(const char* filename)
+{
+    struct stat st;
+    if(stat(filename, &st) == -1) return -1;
+    return st.st_size;
+}
+
+/*
+ * Reset peak resident set size of the process, so next call to
+ * benchmarkPeakRss() reports peak for subsequent operations only.
+ *
+ * Return false if not supported(requires Linux 4.0 or later).
+ */
+static inline bool benchmarkResetPeakRss(void)
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if(fd == -1) return false;
+    bool result = write(fd, "5", 1) == 1;
+    close(fd);
+    return result;
+}
+
+/* Return peak resident set size of the process in KB, or -1 on error. */
+static inline long benchmarkPeakRss(void)
+{
+    FILE* f = fopen("/proc/self/status", "r");
+    if(f)
+    {
+        char line[256];
+        long result = -1;
+        while(fgets(line, sizeof(line), f))
+        {
+            if(strncmp(line, "VmHWM:", 6) == 0)
+            {
+                result = atol(line + 6);
+                break;
+            }
+        }
+        fclose(f);
+        if(result != -1) return result;
+    }
+    /* Fallback, peak since start of the process. */
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == -1) return -1;
+    return usage.ru_maxrss;
+}
+
+#endif /* BENCHMARK_HH */
@@ -0,0 +1,101 @@
+// generate_traces.cpp - write synthetic lcov traces into files.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: generate_traces [<generator-options>] [-n <traces>] <dir>
+ *
+ * Write <traces> synthetic traces into files <dir>/trace<i>.info, for
+ * measure performance of the tool itself on traces of needed shape.
+ *
+ * See 'trace_generator.hh' for generator options.
+ */
+
+#include "trace_generator.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h> /* getopt */
+#include <stdlib.h> /* atoi */
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+    TraceGeneratorParams params;
+    int traces = 1;
+
+    string options = string("n:") + TraceGeneratorParams::options;
+
+    bool error = false;
+    for(int opt = getopt(argc, argv, options.c_str());
+        opt != -1;
+        opt = getopt(argc, argv, options.c_str()))
+    {
+        if(opt == 'n')
+        {
+            traces = atoi(optarg);
+            if(traces <= 0) error = true;
+        }
+        else if((opt == '?') || params.setOption(opt, optarg))
+        {
+            error = true;
+        }
+    }
+
+    if(error || (optind != argc - 1))
+    {
+        cerr << "Usage: " << argv[0] << " " << TraceGeneratorParams::usage
+            << " [-n <traces>] <dir>" << endl;
+        return 1;
+    }
+
+    const char* dir = argv[optind];
+
+    try
+    {
+        TraceGenerator generator(params);
+        for(int i = 0; i < traces; i++)
+        {
+            ostringstream filename;
+            filename << dir << "/trace" << i << ".info";
+
+            ofstream os(filename.str().c_str());
+            generator.generate(os, i);
+            os.close();
+            if(!os)
+            {
+                cerr << "Failed to write trace '" << filename.str() << "'." << endl;
+                return 1;
+            }
+        }
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+// group_benchmark.cpp - cost of joining duplicated files in the trace.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: group_benchmark [-s <sources>] [-H <headers>] [-i <includes>]
+ *                        [-l <lines>] [-n <repeats>]
+ *
+ * Generate trace where every one of <sources> source files is grouped
+ * with <includes> headers randomly chosen from <headers> ones, as lcov
+ * does for kernel modules. Every file has <lines> lines. So every header
+ * is duplicated about <sources> * <includes> / <headers> times.
+ *
+ * Measure time of 'groupFiles()' for 'Trace' and 'CompactTrace'. Best
+ * time among repeats is reported. Results of both are compared.
+ */
+
+#include "trace.hh"
+#include "compact_trace.hh"
+
+#include "benchmark.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm> /* swap */
+
+#include <unistd.h> /* getopt */
+#include <stdlib.h> /* atoi, rand_r */
+#include <stdio.h> /* printf */
+
+using namespace std;
+
+static unsigned int seed = 1;
+
+/* Output coverage of one file with 'lines' lines in lcov format. */
+static void generateFile(ostream& os, const string& filename, int lines)
+{
+    os << "SF:" << filename << "\n";
+
+    int nFunctions = lines / 20 + 1;
+    for(int i = 0; i < nFunctions; i++)
+        os << "FN:" << (i * 20 + 1) << ",func_" << i << "\n";
+    for(int i = 0; i < nFunctions; i++)
+        os << "FNDA:" << (rand_r(&seed) % 3) << ",func_" << i << "\n";
+
+    for(int line = 1; line <= lines; line += 4)
+    {
+        for(int branch = 0; branch < 2; branch++)
+        {
+            os << "BRDA:" << line << ",0," << branch << ",";
+            if(rand_r(&seed) % 4 == 0) os << "-";
+            else os << (rand_r(&seed) % 3);
+            os << "\n";
+        }
+    }
+
+    for(int line = 1; line <= lines; line++)
+        os << "DA:" << line << "," << (rand_r(&seed) % 3) << "\n";
+
+    os << "end_of_record\n";
+}
+
+static string generateTrace(int sources, int headers, int includes, int lines)
+{
+    vector<int> order(headers);
+    for(int i = 0; i < headers; i++) order[i] = i;
+
+    ostringstream os;
+    for(int i = 0; i < sources; i++)
+    {
+        os << "TN:\n";
+
+        ostringstream source;
+        source << "/src/drivers/module" << i << ".c";
+        generateFile(os, source.str(), lines);
+
+        /* Headers in group should be different. */
+        for(int j = 0; j < includes; j++)
+        {
+            swap(order[j], order[j + rand_r(&seed) % (headers - j)]);
+
+            ostringstream header;
+            header << "/src/include/header" << order[j] << ".h";
+            generateFile(os, header.str(), lines);
+        }
+    }
+    return os.str();
+}
+
+int main(int argc, char** argv)
+{
+    int sources = 200;
+    int headers = 100;
+    int includes = 50;
+    int lines = 200;
+    int repeats = 3;
+
+    static const char options[] = "s:H:i:l:n:";
+
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        int value = optarg ? atoi(optarg) : 0;
+        if(value <= 0)
+        {
+            cerr << "Usage: " << argv[0] << " [-s <sources>] [-H <headers>] "
+                "[-i <includes>] [-l <lines>] [-n <repeats>]" << endl;
+            return 1;
+        }
+        switch(opt)
+        {
+        case 's': sources = value; break;
+        case 'H': headers = value; break;
+        case 'i': includes = value; break;
+        case 'l': lines = value; break;
+        case 'n': repeats = value; break;
+        }
+    }
+
+    if(includes > headers)
+    {
+        cerr << "Number of includes should not exceed number of headers." << endl;
+        return 1;
+    }
+
+    string text = generateTrace(sources, headers, includes, lines);
+    printf("Trace: %d groups, %d files, %.1f MB\n", sources,
+        sources * (includes + 1), text.size() / 1e6);
+
+    double bestTrace = -1;
+    string resultTrace;
+    for(int i = 0; i < repeats; i++)
+    {
+        istringstream is(text);
+        Trace trace;
+        trace.read(is);
+
+        BenchmarkTimer timer;
+        trace.groupFiles();
+        double t = timer.elapsed();
+        if((bestTrace < 0) || (t < bestTrace)) bestTrace = t;
+
+        ostringstream os;
+        trace.write(os);
+        resultTrace = os.str();
+    }
+
+    double bestCompact = -1;
+    string resultCompact;
+    for(int i = 0; i < repeats; i++)
+    {
+        istringstream is(text);
+        CompactTrace trace;
+        trace.read(is);
+
+        BenchmarkTimer timer;
+        trace.groupFiles();
+        double t = timer.elapsed();
+        if((bestCompact < 0) || (t < bestCompact)) bestCompact = t;
+
+        ostringstream os;
+        trace.write(os);
+        resultCompact = os.str();
+    }
+
+    printf("%-10s%10.3f ms\n", "trace", bestTrace * 1e3);
+    printf("%-10s%10.3f ms\n", "compact", bestCompact * 1e3);
+
+    if(resultTrace != resultCompact)
+    {
+        cerr << "Results of grouping differ." << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+// operation_benchmark.cpp - cost of trace operation per counter.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: operation_benchmark [-n <traces>] [-c <counters>] [-r <repeats>]
+ *
+ * Apply 'add' operation to <traces> random columns of <counters>
+ * counters each(about 10% of counters are absent), <repeats> times, using
+ *
+ * - 'object' - per-object interface(TraceOperation), as user-defined
+ *   operations written for it are called through an adapter;
+ * - 'batch' - batch interface(TraceOperationBatch), as predefined
+ *   operations are called.
+ *
+ * For every interface time per counter is reported. Results of both
+ * interfaces are compared.
+ */
+
+#include "builtin_operations.hh"
+#include "do_trace_operation.hh"
+
+#include "benchmark.hh"
+
+#include <iostream>
+#include <vector>
+
+#include <unistd.h> /* getopt */
+#include <stdlib.h> /* atoi, rand_r */
+#include <stdio.h> /* printf */
+
+using namespace std;
+
+typedef TraceOperation::counter_t counter_t;
+
+/* Same as predefined 'add', but implemented with per-object interface. */
+class TraceOperationAddObject: public TraceOperationUnified
+{
+public:
+    counter_t counterOperation(const vector<counter_t>& operands)
+    {
+        counter_t result = operands[0];
+        
+        for(int i = 1; i < (int)operands.size(); i++)
+        {
+            counter_t op = operands[i];
+            if(op >= 0)
+            {
+                if(result < 0) result = 0;
+                result += op;
+            }
+        }
+        
+        return result;
+    }
+};
+
+static double measure(const char* name, TraceOperationBatch& op,
+    const vector<const counter_t*>& operands, int count, int repeats,
+    vector<counter_t>& result)
+{
+    int n = operands.size();
+    result.resize(count);
+    
+    BenchmarkTimer timer;
+    for(int r = 0; r < repeats; r++)
+        op.lineOperation(&operands[0], n, count, &result[0]);
+    double time = timer.elapsed();
+    
+    double perCounter = time * 1e9 / ((double)n * count * repeats);
+    printf("%-8s %10.3f s, %8.3f ns per counter\n", name, time, perCounter);
+    
+    return perCounter;
+}
+
+int main(int argc, char** argv)
+{
+    int n = 4;
+    int count = 100000;
+    int repeats = 100;
+    
+    static const char options[] = "n:c:r:";
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 'c':
+            count = atoi(optarg);
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+    
+    if((n <= 0) || (count <= 0) || (repeats <= 0))
+    {
+        cerr << "Usage: " << argv[0] << " [-n <traces>] [-c <counters>] "
+            "[-r <repeats>]" << endl;
+        return 1;
+    }
+    
+    unsigned seed = 1;
+    vector<vector<counter_t> > columns(n, vector<counter_t>(count));
+    vector<const counter_t*> operands(n);
+    for(int i = 0; i < n; i++)
+    {
+        for(int k = 0; k < count; k++)
+        {
+            int r = rand_r(&seed) % 100;
+            columns[i][k] = (r < 10) ? -1 : r % 4;
+        }
+        operands[i] = &columns[i][0];
+    }
+    
+    printf("%d traces, %d counters, %d repeats\n", n, count, repeats);
+    
+    TraceOperationAddObject objectOp;
+    TraceOperationAdapter adapter(&objectOp);
+    vector<counter_t> objectResult;
+    double objectCost = measure("object", adapter, operands, count, repeats,
+        objectResult);
+    
+    TraceOperationAdd batchOp;
+    vector<counter_t> batchResult;
+    double batchCost = measure("batch", batchOp, operands, count, repeats,
+        batchResult);
+    
+    if(objectResult != batchResult)
+    {
+        cerr << "Results of interfaces differ." << endl;
+        return 1;
+    }
+    
+    printf("speedup  %10.1fx\n", objectCost / batchCost);
+    
+    return 0;
+}
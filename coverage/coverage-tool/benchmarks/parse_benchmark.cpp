@@ -0,0 +1,231 @@
+// parse_benchmark.cpp - measure throughput of the trace parsers.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: parse_benchmark [-n <repeats>] <trace> ...
+ * 
+ * For every parser('lcov' - lex/yacc one, 'mmap' - hand-written one)
+ * measure time of parsing given traces:
+ * 
+ * - 'parse' - only parsing, events are counted but not processed;
+ * - 'load' - loading of the traces into 'CompactTrace'.
+ * 
+ * Also measure loading of the same traces converted into binary format
+ * ('bin'). Throughput for it is computed using size of the lcov traces.
+ * 
+ * Best time among repeats is used for compute throughput.
+ */
+
+#include "trace_parser.hh"
+#include "trace_mmap_parser.hh"
+#include "compact_trace.hh"
+
+#include "benchmark.hh"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <unistd.h> /* getopt */
+#include <stdlib.h> /* atoi, getenv, mkstemp */
+#include <stdio.h> /* printf */
+
+using namespace std;
+
+/* Event processor which only counts lines with counters. */
+class CountingProcessor: public TraceEventProcessor
+{
+public:
+    CountingProcessor(): nEvents(0) {}
+    
+    void onLineCounter(int /*line*/, counter_t /*counter*/, int /*traceLine*/)
+    {
+        nEvents++;
+    }
+    
+    long nEvents;
+};
+
+static void parseLcov(const vector<const char*>& traces)
+{
+    TraceParser parser;
+    CountingProcessor processor;
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        ifstream is(traces[i]);
+        if(!is) throw runtime_error("Cannot open file");
+        parser.parse(is, processor, traces[i]);
+    }
+}
+
+static void parseMmap(const vector<const char*>& traces)
+{
+    TraceMmapParser parser;
+    CountingProcessor processor;
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        if(!parser.parse(traces[i], processor))
+            throw runtime_error("Hand-written parser failed");
+    }
+}
+
+static void loadLcov(const vector<const char*>& traces)
+{
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        CompactTrace trace;
+        trace.read(traces[i]);
+    }
+}
+
+static void loadMmap(const vector<const char*>& traces)
+{
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        CompactTrace trace;
+        trace.readMapped(traces[i]);
+    }
+}
+
+/* Binary copies of the traces, created in temporary directory. */
+static vector<string> binaryTraces;
+
+static void loadBinary(const vector<const char*>& /*traces*/)
+{
+    for(int i = 0; i < (int)binaryTraces.size(); i++)
+    {
+        CompactTrace trace;
+        trace.read(binaryTraces[i].c_str());
+    }
+}
+
+static void createBinaryTraces(const vector<const char*>& traces)
+{
+    const char* tmpdir = getenv("TMPDIR");
+    if(!tmpdir) tmpdir = "/tmp";
+    
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        string filename = string(tmpdir) + "/parse_benchmark.XXXXXX";
+        int fd = mkstemp(&filename[0]);
+        if(fd == -1) throw runtime_error("Cannot create temporary file");
+        close(fd);
+        binaryTraces.push_back(filename);
+        
+        CompactTrace trace;
+        trace.readMapped(traces[i]);
+        ofstream os(filename.c_str());
+        trace.writeBinary(os);
+        if(!os) throw runtime_error("Cannot write binary trace");
+    }
+}
+
+static void removeBinaryTraces(void)
+{
+    for(int i = 0; i < (int)binaryTraces.size(); i++)
+        unlink(binaryTraces[i].c_str());
+    binaryTraces.clear();
+}
+
+static void measure(const char* parser, const char* mode,
+    void (*f)(const vector<const char*>&),
+    const vector<const char*>& traces, long long size, int repeats)
+{
+    double best = -1;
+    for(int i = 0; i < repeats; i++)
+    {
+        BenchmarkTimer timer;
+        f(traces);
+        double t = timer.elapsed();
+        if((best < 0) || (t < best)) best = t;
+    }
+    
+    printf("%-6s%-7s%10.3f s%10.1f MB/s\n", parser, mode, best,
+        size / 1e6 / best);
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = 3;
+    
+    for(int opt = getopt(argc, argv, "n:");
+        opt != -1;
+        opt = getopt(argc, argv, "n:"))
+    {
+        switch(opt)
+        {
+        case 'n':
+            repeats = atoi(optarg);
+            if(repeats <= 0)
+            {
+                cerr << "Number of repeats should be positive." << endl;
+                return 1;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+    
+    if(optind == argc)
+    {
+        cerr << "Usage: " << argv[0] << " [-n <repeats>] <trace> ..." << endl;
+        return 1;
+    }
+    
+    vector<const char*> traces(argv + optind, argv + argc);
+    long long size = 0;
+    for(int i = 0; i < (int)traces.size(); i++)
+    {
+        long long fileSize = benchmarkFileSize(traces[i]);
+        if(fileSize < 0)
+        {
+            cerr << "Cannot access file '" << traces[i] << "'." << endl;
+            return 1;
+        }
+        size += fileSize;
+    }
+    
+    printf("%d trace(s), %.1f MB, best of %d run(s)\n",
+        (int)traces.size(), size / 1e6, repeats);
+    
+    measure("lcov", "parse", parseLcov, traces, size, repeats);
+    measure("mmap", "parse", parseMmap, traces, size, repeats);
+    measure("lcov", "load", loadLcov, traces, size, repeats);
+    measure("mmap", "load", loadMmap, traces, size, repeats);
+    
+    try
+    {
+        createBinaryTraces(traces);
+        measure("bin", "load", loadBinary, traces, size, repeats);
+    }
+    catch(...)
+    {
+        removeBinaryTraces();
+        throw;
+    }
+    removeBinaryTraces();
+    
+    return 0;
+}
@@ -0,0 +1,164 @@
+// set_cover_benchmark.cpp - compare algorithms for optimize tests set.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: set_cover_benchmark [-n <tests>] [-g <groups>] [-d <density>]
+ *          [-s <seed>] [-t <seconds>]
+ *
+ * Generate random problem of the same kind as 'optimize-tests' solves:
+ * <tests> tests with weights from 1 to 10, each covers every of <groups>
+ * line groups with probability <density>(percents). Every group is
+ * covered by at least two tests(groups covered by one test are excluded
+ * by the optimizer before search).
+ *
+ * Then solve it with
+ *
+ * - 'greedy' - greedy algorithm only;
+ * - 'bnb' - branch-and-bound, started from the greedy solution;
+ * - 'exh' - exhaustive search, used by optimize-tests before.
+ *
+ * Every search is limited by <seconds>(10 by default). For every
+ * algorithm weight of the solution found, time and whether solution is
+ * proven to be optimal are reported.
+ */
+
+#include "set_cover.hh"
+
+#include "benchmark.hh"
+
+#include <iostream>
+#include <vector>
+
+#include <unistd.h> /* getopt */
+#include <stdlib.h> /* atoi, strtod, rand_r */
+#include <stdio.h> /* printf */
+
+using namespace std;
+
+static void generate(SetCoverProblem& problem, int nTests, int nGroups,
+    int density, unsigned seed)
+{
+    vector<Bitset> sets(nTests, Bitset(nGroups));
+    for(int g = 0; g < nGroups; g++)
+    {
+        int nCovers = 0;
+        for(int t = 0; t < nTests; t++)
+        {
+            if((int)(rand_r(&seed) % 100) < density)
+            {
+                sets[t].set(g);
+                nCovers++;
+            }
+        }
+        /* Add missed covers to random tests. */
+        while(nCovers < 2)
+        {
+            int t = rand_r(&seed) % nTests;
+            if(sets[t].test(g)) continue;
+            sets[t].set(g);
+            nCovers++;
+        }
+    }
+
+    for(int t = 0; t < nTests; t++)
+    {
+        problem.addSet(sets[t], 1 + rand_r(&seed) % 10);
+    }
+}
+
+static void report(const char* algorithm, const SetCoverSolver& solver,
+    double time, bool optimal)
+{
+    printf("%-8s weight %8.1f, %4d tests, %10.3f s, %10ld nodes%s\n",
+        algorithm, solver.solutionWeight(), (int)solver.solution().size(),
+        time, solver.nodesVisited(), optimal ? ", optimal" : "");
+}
+
+int main(int argc, char** argv)
+{
+    int nTests = 30;
+    int nGroups = 200;
+    int density = 10;
+    unsigned seed = 1;
+    double timeLimit = 10;
+
+    static const char options[] = "n:g:d:s:t:";
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case 'n':
+            nTests = atoi(optarg);
+            break;
+        case 'g':
+            nGroups = atoi(optarg);
+            break;
+        case 'd':
+            density = atoi(optarg);
+            break;
+        case 's':
+            seed = atoi(optarg);
+            break;
+        case 't':
+            timeLimit = strtod(optarg, NULL);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if((nTests < 2) || (nGroups <= 0) || (density <= 0) || (density > 100)
+        || (timeLimit <= 0))
+    {
+        cerr << "Usage: " << argv[0] << " [-n <tests>] [-g <groups>] "
+            "[-d <density>] [-s <seed>] [-t <seconds>]" << endl;
+        return 1;
+    }
+
+    SetCoverProblem problem(nGroups);
+    generate(problem, nTests, nGroups, density, seed);
+
+    printf("%d tests, %d groups, density %d%%, time limit %.1f s\n",
+        nTests, nGroups, density, timeLimit);
+
+    {
+        SetCoverSolver solver(problem);
+        BenchmarkTimer timer;
+        solver.greedy();
+        report("greedy", solver, timer.elapsed(), false);
+
+        timer.restart();
+        bool optimal = solver.branchAndBound(timeLimit);
+        report("bnb", solver, timer.elapsed(), optimal);
+    }
+
+    {
+        SetCoverSolver solver(problem);
+        BenchmarkTimer timer;
+        bool optimal = solver.exhaustive(timeLimit);
+        report("exh", solver, timer.elapsed(), optimal);
+    }
+
+    return 0;
+}
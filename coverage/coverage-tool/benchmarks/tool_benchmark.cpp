@@ -0,0 +1,407 @@
+// tool_benchmark.cpp - performance of main operations of the tool.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Usage: tool_benchmark [<generator-options>] [-n <traces>] [-r <repeats>]
+ *                       [-t text|csv]
+ *
+ * Generate <traces> synthetic traces(see 'trace_generator.hh' for
+ * generator options) in temporary directory and measure phases of the
+ * tool working with them:
+ *
+ * - 'read' - loading of all traces;
+ * - 'write' - storing of all traces;
+ * - 'add' - 'add' operation applied to all traces, as 'operation' does;
+ * - 'group' - grouping of files in every trace;
+ * - 'stat' - loading, grouping and collecting statistic for every trace,
+ *   as 'stat' does;
+ * - 'optimize' - searching of optimal test set among the traces, as
+ *   'optimize-tests' does.
+ *
+ * For every phase best time among repeats, throughput and peak resident
+ * set size are reported. Throughput is computed using size of the lcov
+ * traces processed by the phase. Peak RSS includes traces which are
+ * kept between phases(e.g., loaded ones), so it is comparable between
+ * runs with the same parameters only.
+ */
+
+#include "trace_generator.hh"
+
+#include "compact_trace.hh"
+#include "builtin_operations.hh"
+#include "do_trace_operation.hh"
+#include "test_set_optimizer.hh"
+
+#include "benchmark.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <unistd.h> /* getopt, unlink, rmdir */
+#include <stdlib.h> /* atoi, getenv, mkdtemp */
+#include <stdio.h> /* printf */
+#include <string.h> /* strcmp */
+
+using namespace std;
+
+/* Phase of the benchmark, which may be repeated. */
+class Phase
+{
+public:
+    virtual ~Phase() {}
+
+    /* Prepare data for the run. Not measured. */
+    virtual void setup(void) {}
+    virtual void run(void) = 0;
+};
+
+struct PhaseResult
+{
+    double time;
+    /* Size of the lcov traces processed. */
+    long long bytes;
+    /* In KB, -1 if unknown. */
+    long peakRss;
+};
+
+static PhaseResult measure(Phase& phase, int repeats, long long bytes)
+{
+    PhaseResult result;
+    result.time = -1;
+    result.bytes = bytes;
+    result.peakRss = -1;
+
+    bool rssReset = true;
+    for(int i = 0; i < repeats; i++)
+    {
+        phase.setup();
+
+        rssReset = benchmarkResetPeakRss() && rssReset;
+
+        BenchmarkTimer timer;
+        phase.run();
+        double t = timer.elapsed();
+        if((result.time < 0) || (t < result.time)) result.time = t;
+
+        long rss = benchmarkPeakRss();
+        if(rss > result.peakRss) result.peakRss = rss;
+    }
+
+    if(!rssReset)
+    {
+        static bool warned = false;
+        if(!warned)
+        {
+            cerr << "Warning: Peak RSS cannot be reset, it is reported "
+                "since start of the benchmark." << endl;
+            warned = true;
+        }
+    }
+
+    return result;
+}
+
+static long long totalSize(const vector<string>& files)
+{
+    long long size = 0;
+    for(int i = 0; i < (int)files.size(); i++)
+    {
+        long long fileSize = benchmarkFileSize(files[i].c_str());
+        if(fileSize == -1) throw runtime_error("Cannot get size of the trace");
+        size += fileSize;
+    }
+    return size;
+}
+
+class ReadPhase: public Phase
+{
+public:
+    ReadPhase(const vector<string>& files, vector<CompactTrace>& traces):
+        files(files), traces(traces) {}
+
+    void setup(void) {vector<CompactTrace>().swap(traces);}
+
+    void run(void)
+    {
+        traces.resize(files.size());
+        for(int i = 0; i < (int)files.size(); i++)
+            traces[i].read(files[i].c_str());
+    }
+private:
+    const vector<string>& files;
+    vector<CompactTrace>& traces;
+};
+
+class WritePhase: public Phase
+{
+public:
+    WritePhase(const vector<CompactTrace>& traces, const vector<string>& files):
+        traces(traces), files(files) {}
+
+    void run(void)
+    {
+        for(int i = 0; i < (int)traces.size(); i++)
+        {
+            ofstream os(files[i].c_str());
+            traces[i].write(os);
+            os.close();
+            if(!os) throw runtime_error("Cannot write trace");
+        }
+    }
+private:
+    const vector<CompactTrace>& traces;
+    const vector<string>& files;
+};
+
+class AddPhase: public Phase
+{
+public:
+    AddPhase(const vector<CompactTrace>& traces, CompactTrace& result):
+        traces(traces), result(result) {}
+
+    void setup(void) {CompactTrace().swap(result);}
+    void run(void) {doTraceOperation(op, traces, result);}
+private:
+    const vector<CompactTrace>& traces;
+    CompactTrace& result;
+    TraceOperationAdd op;
+};
+
+/* Groups files in every loaded trace, as commands do after loading. */
+class GroupPhase: public Phase
+{
+public:
+    GroupPhase(const vector<CompactTrace>& traces): traces(traces) {}
+
+    void setup(void)
+    {
+        vector<CompactTrace>().swap(grouped);
+        grouped = traces;
+    }
+
+    void run(void)
+    {
+        for(int i = 0; i < (int)grouped.size(); i++)
+            grouped[i].groupFiles();
+    }
+private:
+    const vector<CompactTrace>& traces;
+    vector<CompactTrace> grouped;
+};
+
+class StatPhase: public Phase
+{
+public:
+    StatPhase(const vector<string>& files): files(files) {}
+
+    void run(void)
+    {
+        for(int i = 0; i < (int)files.size(); i++)
+        {
+            CompactTrace trace;
+            trace.read(files[i].c_str());
+            trace.groupFiles();
+            totals.add(trace.totals());
+        }
+    }
+private:
+    const vector<string>& files;
+    CoverageTotals totals;
+};
+
+class OptimizePhase: public Phase
+{
+public:
+    OptimizePhase(const vector<string>& files)
+    {
+        for(int i = 0; i < (int)files.size(); i++)
+            tests.push_back(TestCoverageDesc(files[i], 1));
+    }
+
+    void run(void)
+    {
+        TestSetOptimizer optimizer(tests);
+        optimizer.optimize(false);
+    }
+private:
+    vector<TestCoverageDesc> tests;
+};
+
+static void printResult(const char* name, const PhaseResult& result, bool csv)
+{
+    double throughput = result.bytes / result.time / 1e6;
+    if(csv)
+    {
+        printf("%s,%.6f,%.3f,%ld\n", name, result.time, throughput,
+            result.peakRss);
+    }
+    else
+    {
+        printf("%-10s%10.3f ms%10.1f MB/s", name, result.time * 1e3,
+            throughput);
+        if(result.peakRss != -1)
+            printf("%10.1f MB peak RSS", result.peakRss / 1024.0);
+        printf("\n");
+    }
+}
+
+/* Temporary directory with generated traces, removed on destruction. */
+class TraceDirectory
+{
+public:
+    TraceDirectory()
+    {
+        const char* tmpdir = getenv("TMPDIR");
+        if(!tmpdir) tmpdir = "/tmp";
+
+        dir = string(tmpdir) + "/tool_benchmark.XXXXXX";
+        if(!mkdtemp(&dir[0]))
+            throw runtime_error("Cannot create temporary directory");
+    }
+
+    ~TraceDirectory()
+    {
+        for(int i = 0; i < (int)files.size(); i++)
+            unlink(files[i].c_str());
+        rmdir(dir.c_str());
+    }
+
+    /* Return name of new file in the directory. */
+    const string& addFile(const char* prefix, int index)
+    {
+        ostringstream filename;
+        filename << dir << "/" << prefix << index << ".info";
+        files.push_back(filename.str());
+        return files.back();
+    }
+private:
+    string dir;
+    vector<string> files;
+};
+
+int main(int argc, char** argv)
+{
+    TraceGeneratorParams params;
+    int n = 8;
+    int repeats = 3;
+    bool csv = false;
+
+    string options = string("n:r:t:") + TraceGeneratorParams::options;
+
+    bool error = false;
+    for(int opt = getopt(argc, argv, options.c_str());
+        opt != -1;
+        opt = getopt(argc, argv, options.c_str()))
+    {
+        switch(opt)
+        {
+        case 'n':
+            n = atoi(optarg);
+            if(n <= 0) error = true;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            if(repeats <= 0) error = true;
+            break;
+        case 't':
+            if(strcmp(optarg, "csv") == 0) csv = true;
+            else if(strcmp(optarg, "text") != 0) error = true;
+            break;
+        case '?':
+            error = true;
+            break;
+        default:
+            if(params.setOption(opt, optarg)) error = true;
+        }
+    }
+
+    if(error || (optind != argc))
+    {
+        cerr << "Usage: " << argv[0] << " " << TraceGeneratorParams::usage
+            << " [-n <traces>] [-r <repeats>] [-t text|csv]" << endl;
+        return 1;
+    }
+
+    try
+    {
+        TraceGenerator generator(params);
+        TraceDirectory dir;
+
+        vector<string> files(n);
+        vector<string> outFiles(n);
+        for(int i = 0; i < n; i++)
+        {
+            files[i] = dir.addFile("trace", i);
+            outFiles[i] = dir.addFile("out", i);
+
+            ofstream os(files[i].c_str());
+            generator.generate(os, i);
+            os.close();
+            if(!os) throw runtime_error("Cannot write generated trace");
+        }
+
+        long long size = totalSize(files);
+        if(csv) printf("phase,seconds,mb_per_s,peak_rss_kb\n");
+        else printf("Traces: %d x %.1f MB, %d files each\n", n,
+            size / (double)n / 1e6, generator.filesNumber());
+
+        vector<CompactTrace> traces;
+
+        ReadPhase readPhase(files, traces);
+        printResult("read", measure(readPhase, repeats, size), csv);
+
+        WritePhase writePhase(traces, outFiles);
+        PhaseResult writeResult = measure(writePhase, repeats, 0);
+        writeResult.bytes = totalSize(outFiles);
+        printResult("write", writeResult, csv);
+
+        CompactTrace sum;
+        AddPhase addPhase(traces, sum);
+        printResult("add", measure(addPhase, repeats, size), csv);
+        CompactTrace().swap(sum);
+
+        {
+            GroupPhase groupPhase(traces);
+            printResult("group", measure(groupPhase, repeats, size), csv);
+        }
+
+        /* Other phases load traces themselves. */
+        vector<CompactTrace>().swap(traces);
+
+        StatPhase statPhase(files);
+        printResult("stat", measure(statPhase, repeats, size), csv);
+
+        OptimizePhase optimizePhase(files);
+        printResult("optimize", measure(optimizePhase, repeats, size), csv);
+    }
+    catch(exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
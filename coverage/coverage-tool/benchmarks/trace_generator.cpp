@@ -0,0 +1,163 @@
+// trace_generator.cpp - generator of synthetic lcov traces.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "trace_generator.hh"
+
+#include <sstream>
+#include <stdexcept>
+#include <algorithm> /* swap */
+
+#include <stdlib.h> /* atoi, rand_r */
+
+using namespace std;
+
+const char TraceGeneratorParams::options[] = "s:H:i:l:b:B:f:p:S:";
+
+const char TraceGeneratorParams::usage[] =
+    "[-s <sources>] [-H <headers>] [-i <includes>] [-l <lines>] "
+    "[-b <branch-step>] [-B <branches>] [-f <function-step>] "
+    "[-p <hit-percent>] [-S <seed>]";
+
+int TraceGeneratorParams::setOption(int opt, const char* value)
+{
+    int v = atoi(value);
+    switch(opt)
+    {
+    case 's': sources = v; break;
+    case 'H': headers = v; break;
+    case 'i': includes = v; break;
+    case 'l': lines = v; break;
+    case 'b': branchStep = v; break;
+    case 'B': branches = v; break;
+    case 'f': functionStep = v; break;
+    case 'p': hitPercent = v; break;
+    case 'S': seed = v; break;
+    default:
+        return 1;
+    }
+
+    switch(opt)
+    {
+    case 's': case 'l': case 'f':
+        if(v <= 0) return -1;
+        break;
+    case 'p':
+        if((v < 0) || (v > 100)) return -1;
+        break;
+    default:
+        if(v < 0) return -1;
+    }
+
+    return 0;
+}
+
+TraceGenerator::TraceGenerator(const TraceGeneratorParams& params):
+    params(params), groupHeaders(params.sources)
+{
+    if(params.includes > params.headers)
+        throw logic_error("Number of includes should not exceed number of headers.");
+
+    vector<int> order(params.headers);
+    for(int i = 0; i < params.headers; i++) order[i] = i;
+
+    unsigned seed = params.seed;
+    for(int i = 0; i < params.sources; i++)
+    {
+        /* Headers in group should be different. */
+        vector<int>& headers = groupHeaders[i];
+        headers.resize(params.includes);
+        for(int j = 0; j < params.includes; j++)
+        {
+            swap(order[j], order[j + rand_r(&seed) % (params.headers - j)]);
+            headers[j] = order[j];
+        }
+    }
+}
+
+int TraceGenerator::filesNumber(void) const
+{
+    return params.sources * (params.includes + 1);
+}
+
+/* Counter which is hit with given probability. */
+static int randomCounter(unsigned& seed, int hitPercent)
+{
+    if((int)(rand_r(&seed) % 100) >= hitPercent) return 0;
+    return rand_r(&seed) % 5 + 1;
+}
+
+void TraceGenerator::generateFile(ostream& os, const string& filename,
+    unsigned& seed) const
+{
+    os << "SF:" << filename << "\n";
+
+    for(int line = 1; line <= params.lines; line += params.functionStep)
+        os << "FN:" << line << ",func_" << line << "\n";
+    for(int line = 1; line <= params.lines; line += params.functionStep)
+    {
+        os << "FNDA:" << randomCounter(seed, params.hitPercent)
+            << ",func_" << line << "\n";
+    }
+
+    if(params.branchStep && params.branches)
+    {
+        for(int line = 1; line <= params.lines; line += params.branchStep)
+        {
+            /* Branches of not executed line are marked as '-'. */
+            bool executed = randomCounter(seed, params.hitPercent) != 0;
+            for(int branch = 0; branch < params.branches; branch++)
+            {
+                os << "BRDA:" << line << ",0," << branch << ",";
+                if(executed) os << randomCounter(seed, 50);
+                else os << "-";
+                os << "\n";
+            }
+        }
+    }
+
+    for(int line = 1; line <= params.lines; line++)
+        os << "DA:" << line << "," << randomCounter(seed, params.hitPercent) << "\n";
+
+    os << "end_of_record\n";
+}
+
+void TraceGenerator::generate(ostream& os, int index) const
+{
+    unsigned seed = params.seed * 1000003u + index;
+
+    for(int i = 0; i < params.sources; i++)
+    {
+        os << "TN:\n";
+
+        ostringstream source;
+        source << "/src/drivers/module" << i << ".c";
+        generateFile(os, source.str(), seed);
+
+        const vector<int>& headers = groupHeaders[i];
+        for(int j = 0; j < (int)headers.size(); j++)
+        {
+            ostringstream header;
+            header << "/src/include/header" << headers[j] << ".h";
+            generateFile(os, header.str(), seed);
+        }
+    }
+}
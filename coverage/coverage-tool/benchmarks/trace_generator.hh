@@ -0,0 +1,76 @@
+/*
+ * Generator of synthetic lcov traces.
+ *
+ * Every trace consists of <sources> groups, one per source file. As lcov
+ * does for kernel modules, every group contains also <includes> headers
+ * chosen from <headers> common ones, so headers are duplicated among
+ * groups.
+ *
+ * Structure of the traces(files, lines, functions and branches) depends
+ * only on the parameters, counters depend also on the index of the
+ * trace. So traces with different indices look like coverage of the
+ * same sources by different tests.
+ */
+
+#ifndef TRACE_GENERATOR_HH
+#define TRACE_GENERATOR_HH
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct TraceGeneratorParams
+{
+    int sources;
+    int headers;
+    int includes;
+    /* Lines in every file. */
+    int lines;
+    /* Every <branchStep> line has <branches> branches. 0 - no branches. */
+    int branchStep;
+    int branches;
+    /* Function starts every <functionStep> lines. */
+    int functionStep;
+    /* Percent of counters which are hit. */
+    int hitPercent;
+    unsigned seed;
+
+    TraceGeneratorParams(): sources(100), headers(50), includes(10),
+        lines(200), branchStep(4), branches(2), functionStep(20),
+        hitPercent(30), seed(1) {}
+
+    /* Options accepted by 'setOption', in getopt() format. */
+    static const char options[];
+    /* Description of the options for usage string. */
+    static const char usage[];
+
+    /*
+     * Set parameter corresponded to the option.
+     *
+     * Return 0 on success, 1 if option is not a generator one, -1 if
+     * value is incorrect.
+     */
+    int setOption(int opt, const char* value);
+};
+
+class TraceGenerator
+{
+public:
+    /* Throw exception if parameters are inconsistent. */
+    TraceGenerator(const TraceGeneratorParams& params);
+
+    /* Output trace with given index in lcov format. */
+    void generate(std::ostream& os, int index) const;
+
+    /* Files in every trace, including duplicated ones. */
+    int filesNumber(void) const;
+private:
+    TraceGeneratorParams params;
+    /* Headers for every group. */
+    std::vector<std::vector<int> > groupHeaders;
+
+    void generateFile(std::ostream& os, const std::string& filename,
+        unsigned& seed) const;
+};
+
+#endif /* TRACE_GENERATOR_HH */
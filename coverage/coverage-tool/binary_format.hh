@@ -0,0 +1,179 @@
+/*
+ * Common parts of binary files produced by the tool(traces, indices).
+ *
+ * Every such file consists of the fixed header followed by the payload.
+ * Header contains signature of the file kind, version of the format,
+ * byte order mark, size of the payload and its checksum.
+ */
+
+#ifndef BINARY_FORMAT_HH
+#define BINARY_FORMAT_HH
+
+#include <string>
+#include <vector>
+
+#include <cstring>
+#include <stdint.h>
+
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+static const uint32_t binaryByteOrder = 0x01020304;
+
+/* 64-bit FNV-1a hash, but over 8-byte words instead of single bytes. */
+inline uint64_t binaryChecksum(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const uint64_t prime = 1099511628211ULL;
+
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for(; i < size; i++)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+
+    return hash;
+}
+
+/* Whether data starts with given signature. */
+inline bool binaryHasMagic(const char* start, const char* end,
+    const char magic[8])
+{
+    return ((size_t)(end - start) >= 8) && (memcmp(start, magic, 8) == 0);
+}
+
+/*
+ * Check header of the binary file in [start, end).
+ *
+ * On success return NULL and set 'payload' to the start of the payload.
+ * Otherwise return description of the problem. 'payload' is set also
+ * when the header is valid but the payload is not(truncated or checksum
+ * mismatch), i.e. when the file is of the expected kind but corrupted.
+ */
+inline const char* binaryCheckHeader(const char* start, const char* end,
+    const char magic[8], uint32_t version, const char*& payload)
+{
+    BinaryHeader header;
+    if(!binaryHasMagic(start, end, magic))
+        return "wrong signature";
+    if((size_t)(end - start) < sizeof(header))
+    {
+        payload = end;
+        return "truncated";
+    }
+    memcpy(&header, start, sizeof(header));
+
+    if(header.byteOrder != binaryByteOrder)
+        return "created on the machine with different byte order";
+    if(header.version != version)
+        return "unsupported version of the format";
+
+    payload = start + sizeof(header);
+    if(header.payloadSize != (uint64_t)(end - payload))
+        return "truncated";
+    if(header.checksum != binaryChecksum(payload, end - payload))
+        return "checksum mismatch";
+
+    return NULL;
+}
+
+/* Return header for given payload. */
+inline BinaryHeader binaryMakeHeader(const char magic[8], uint32_t version,
+    const std::string& payload)
+{
+    BinaryHeader header;
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.byteOrder = binaryByteOrder;
+    header.payloadSize = payload.size();
+    header.checksum = binaryChecksum(payload.data(), payload.size());
+    return header;
+}
+
+/* Append value or array of values to the payload, as they are in memory. */
+template<class T>
+inline void binaryPutValue(std::string& buffer, const T& value)
+{
+    buffer.append((const char*)&value, sizeof(value));
+}
+
+template<class T>
+inline void binaryPutArray(std::string& buffer, const std::vector<T>& values)
+{
+    if(!values.empty())
+        buffer.append((const char*)&values[0], values.size() * sizeof(T));
+}
+
+inline void binaryPutString(std::string& buffer, const std::string& str)
+{
+    binaryPutValue(buffer, (uint32_t)str.size());
+    buffer.append(str);
+}
+
+/* Sequential reading of the payload with bound checking. */
+class BinaryReader
+{
+public:
+    BinaryReader(const char* p, const char* end): p(p), end(end) {}
+
+    bool atEnd(void) const {return p == end;}
+
+    /* Whether at least 'size' bytes remain unread. */
+    bool has(size_t size) const {return (size_t)(end - p) >= size;}
+
+    template<class T>
+    bool get(T& value)
+    {
+        if((size_t)(end - p) < sizeof(T)) return false;
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    /* Read number of elements in the following arrays. */
+    bool getSize(uint32_t& n, size_t elemSize)
+    {
+        return get(n) && ((size_t)(end - p) / elemSize >= n);
+    }
+
+    /*
+     * Read array of elements stored exactly as in memory.
+     *
+     * Caller should check size of the array with 'getSize' or 'has'
+     * before.
+     * 'fill' is needed only for types without default constructor.
+     */
+    template<class T>
+    void getArray(std::vector<T>& values, uint32_t n, const T& fill = T())
+    {
+        values.resize(n, fill);
+        if(n) memcpy(&values[0], p, n * sizeof(T));
+        p += n * sizeof(T);
+    }
+
+    bool getString(std::string& str)
+    {
+        uint32_t len;
+        if(!getSize(len, 1)) return false;
+        str.assign(p, len);
+        p += len;
+        return true;
+    }
+private:
+    const char* p;
+    const char* end;
+};
+
+#endif /* BINARY_FORMAT_HH */
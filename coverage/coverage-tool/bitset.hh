@@ -0,0 +1,163 @@
+/*
+ * Dynamically sized set of bits with fast set-wise operations.
+ *
+ * Unlike vector<bool>, operations over whole sets(union, difference,
+ * counting) are performed word by word.
+ */
+
+#ifndef BITSET_HH
+#define BITSET_HH
+
+#include <vector>
+#include <algorithm> /* swap */
+#include <stdint.h>
+
+class Bitset
+{
+public:
+    Bitset(int nBits = 0): nBits(nBits), words(wordsFor(nBits), 0) {}
+
+    int size(void) const {return nBits;}
+
+    /* Change size of the set. New bits are cleared. */
+    void resize(int n)
+    {
+        if(n < nBits)
+        {
+            words.resize(wordsFor(n));
+            nBits = n;
+            clearTail();
+        }
+        else
+        {
+            words.resize(wordsFor(n), 0);
+            nBits = n;
+        }
+    }
+
+    bool test(int i) const {return (words[i / wordBits] >> (i % wordBits)) & 1;}
+    void set(int i) {words[i / wordBits] |= (uint64_t)1 << (i % wordBits);}
+    void reset(int i) {words[i / wordBits] &= ~((uint64_t)1 << (i % wordBits));}
+
+    /* Set all bits. */
+    void setAll(void)
+    {
+        for(int i = 0; i < (int)words.size(); i++) words[i] = ~(uint64_t)0;
+        clearTail();
+    }
+
+    /* Number of set bits. */
+    int count(void) const
+    {
+        int result = 0;
+        for(int i = 0; i < (int)words.size(); i++)
+            result += __builtin_popcountll(words[i]);
+        return result;
+    }
+
+    bool none(void) const
+    {
+        for(int i = 0; i < (int)words.size(); i++)
+            if(words[i]) return false;
+        return true;
+    }
+
+    /* Index of the first set bit not less than 'i', or -1. */
+    int findNext(int i) const
+    {
+        if(i >= nBits) return -1;
+
+        int w = i / wordBits;
+        uint64_t word = words[w] & (~(uint64_t)0 << (i % wordBits));
+        while(!word)
+        {
+            if(++w == (int)words.size()) return -1;
+            word = words[w];
+        }
+        return w * wordBits + __builtin_ctzll(word);
+    }
+
+    int findFirst(void) const {return findNext(0);}
+
+    /* Set operations. Both operands should have same size. */
+    void unite(const Bitset& other)
+    {
+        for(int i = 0; i < (int)words.size(); i++) words[i] |= other.words[i];
+    }
+
+    void intersect(const Bitset& other)
+    {
+        for(int i = 0; i < (int)words.size(); i++) words[i] &= other.words[i];
+    }
+
+    void subtract(const Bitset& other)
+    {
+        for(int i = 0; i < (int)words.size(); i++) words[i] &= ~other.words[i];
+    }
+
+    /* Number of bits set in both sets. */
+    int countCommon(const Bitset& other) const
+    {
+        int result = 0;
+        for(int i = 0; i < (int)words.size(); i++)
+            result += __builtin_popcountll(words[i] & other.words[i]);
+        return result;
+    }
+
+    bool intersects(const Bitset& other) const
+    {
+        for(int i = 0; i < (int)words.size(); i++)
+            if(words[i] & other.words[i]) return true;
+        return false;
+    }
+
+    bool isSubsetOf(const Bitset& other) const
+    {
+        for(int i = 0; i < (int)words.size(); i++)
+            if(words[i] & ~other.words[i]) return false;
+        return true;
+    }
+
+    bool operator==(const Bitset& other) const
+    {
+        return (nBits == other.nBits) && (words == other.words);
+    }
+    bool operator!=(const Bitset& other) const {return !(*this == other);}
+
+    /* Hash value of the set, for use in unordered containers. */
+    size_t hash(void) const
+    {
+        uint64_t result = 14695981039346656037ULL;
+        for(int i = 0; i < (int)words.size(); i++)
+            result = (result ^ words[i]) * 1099511628211ULL;
+        return (size_t)(result ^ (result >> 32));
+    }
+
+    /* Functor for unordered containers. */
+    struct Hash
+    {
+        size_t operator()(const Bitset& bitset) const {return bitset.hash();}
+    };
+
+    void swap(Bitset& other)
+    {
+        std::swap(nBits, other.nBits);
+        words.swap(other.words);
+    }
+private:
+    static const int wordBits = 64;
+
+    static int wordsFor(int n) {return (n + wordBits - 1) / wordBits;}
+
+    /* Clear unused bits in the last word. */
+    void clearTail(void)
+    {
+        if(nBits % wordBits)
+            words.back() &= ((uint64_t)1 << (nBits % wordBits)) - 1;
+    }
+
+    int nBits;
+    std::vector<uint64_t> words;
+};
+
+#endif /* BITSET_HH */
@@ -0,0 +1,90 @@
+// builtin_operations.cpp - predefined trace operations.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Loops below are written without data-dependent branches, so compiler
+ * may vectorize them. Conditions are computed as bit masks using only
+ * unsigned shift, because signed 64-bit comparisons and shifts are not
+ * available for vectors on every target(e.g., on plain x86-64).
+ */
+
+#include "builtin_operations.hh"
+
+typedef TraceOperation::counter_t counter_t;
+typedef unsigned long ucounter_t;
+
+/* All ones if counter is non-negative, 0 otherwise. */
+static inline counter_t nonNegativeMask(counter_t c)
+{
+    return (counter_t)(((ucounter_t)c >> (sizeof(c) * 8 - 1)) - 1);
+}
+
+/*
+ * Result never aliases operands, '__restrict' allows compiler do not
+ * check that at runtime.
+ */
+void TraceOperationAdd::counterOperation(const counter_t* const* operands,
+    int n, int count, counter_t* __restrict result)
+{
+    const counter_t* first = operands[0];
+    for(int k = 0; k < count; k++) result[k] = first[k];
+
+    for(int i = 1; i < n; i++)
+    {
+        const counter_t* column = operands[i];
+        for(int k = 0; k < count; k++)
+        {
+            counter_t op = column[k], sum = result[k];
+            /* Absent counter in the sum is 0 if operand is present. */
+            counter_t opMask = nonNegativeMask(op);
+            counter_t sumPositive = sum & nonNegativeMask(sum);
+            result[k] = ((sumPositive + op) & opMask) | (sum & ~opMask);
+        }
+    }
+}
+
+void TraceOperationDiff::counterOperation(const counter_t* const* operands,
+    int /*n*/, int count, counter_t* __restrict result)
+{
+    const counter_t* op1 = operands[0];
+    const counter_t* op2 = operands[1];
+    for(int k = 0; k < count; k++)
+    {
+        counter_t diff = op1[k] - op2[k];
+        diff &= nonNegativeMask(diff);
+        /* Only positive counters are decreased. */
+        counter_t mask = nonNegativeMask(op1[k] - 1);
+        result[k] = (diff & mask) | (op1[k] & ~mask);
+    }
+}
+
+void TraceOperationNewCoverage::counterOperation(const counter_t* const* operands,
+    int /*n*/, int count, counter_t* __restrict result)
+{
+    const counter_t* op1 = operands[0];
+    const counter_t* op2 = operands[1];
+    for(int k = 0; k < count; k++)
+    {
+        /* Counters covered by the second trace become 0. */
+        result[k] = op1[k] & ~nonNegativeMask(op2[k] - 1);
+    }
+}
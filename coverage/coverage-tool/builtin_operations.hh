@@ -0,0 +1,47 @@
+/*
+ * Predefined trace operations: 'add', 'diff' and 'new-coverage'.
+ *
+ * Implemented with batch interface, so every operation is a simple
+ * loop over columns of counters.
+ */
+
+#ifndef BUILTIN_OPERATIONS_HH
+#define BUILTIN_OPERATIONS_HH
+
+#include "trace_operation_include/trace_operation.hh"
+
+/*
+ * Sum of the counters. Absent counters are ignored, '-' branches are
+ * treated as 0 if any trace has real counter for the branch.
+ */
+class TraceOperationAdd: public TraceOperationBatchUnified
+{
+public:
+    void counterOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+};
+
+/*
+ * Counter from the first trace minus one from the second trace, but not
+ * less than 0. Counters which are not positive in the first trace
+ * remain as is.
+ */
+class TraceOperationDiff: public TraceOperationBatchUnified
+{
+public:
+    void counterOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+};
+
+/*
+ * Counter from the first trace, but 0 if counter in the second trace is
+ * positive.
+ */
+class TraceOperationNewCoverage: public TraceOperationBatchUnified
+{
+public:
+    void counterOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+};
+
+#endif /* BUILTIN_OPERATIONS_HH */
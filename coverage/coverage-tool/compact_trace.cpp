@@ -0,0 +1,1252 @@
+// compact_trace.cpp - implementation of 'CompactTrace' class methods.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+
+#include "compact_trace.hh"
+#include "trace_parser.hh"
+#include "trace_mmap_parser.hh"
+#include "file_mapping.hh"
+#include "compressed_stream.hh"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cassert>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <stdint.h>
+
+using namespace std;
+typedef Trace::counter_t counter_t;
+typedef Trace::BranchID BranchID;
+
+/*
+ * Report about error in trace and throw exception.
+ *
+ * 'msg' is used only for insert into stream.
+ * (That is, it may contain '<<' operators).
+ */
+#define trace_error(msg) \
+cerr << traceLine << ": " << msg << endl; \
+throw runtime_error("Incorrect trace file");
+
+/* Whether filename correspond to source file(ends with ".c"). */
+static bool isSource(const std::string& filename)
+{
+    size_t len = filename.length();
+    return (len > 2) && (filename[len - 2] == '.') && (filename[len - 1] == 'c');
+}
+
+/********************* StringTable methods ****************************/
+StringTable::StringTable(const StringTable& table)
+{
+    *this = table;
+}
+
+StringTable& StringTable::operator=(const StringTable& table)
+{
+    if(this == &table) return *this;
+
+    clear();
+    reserve(table.size());
+    for(int i = 0; i < table.size(); i++)
+        intern(table[i]);
+
+    return *this;
+}
+
+int StringTable::intern(const std::string& str)
+{
+    pair<unordered_map<string, int>::iterator, bool> iterNew =
+        ids.insert(make_pair(str, (int)strings.size()));
+    if(iterNew.second)
+    {
+        /* Keys of unordered_map are not moved when map grows. */
+        strings.push_back(&iterNew.first->first);
+    }
+    return iterNew.first->second;
+}
+
+void StringTable::reserve(int n)
+{
+    ids.reserve(n);
+    strings.reserve(n);
+}
+
+void StringTable::clear(void)
+{
+    strings.clear();
+    ids.clear();
+}
+
+void StringTable::swap(StringTable& table)
+{
+    strings.swap(table.strings);
+    ids.swap(table.ids);
+}
+
+/********************* Swap methods ***********************************/
+void CompactTrace::FileData::swap(FileData& file)
+{
+    std::swap(name, file.name);
+    lines.swap(file.lines);
+    lineCounters.swap(file.lineCounters);
+    branches.swap(file.branches);
+    branchCounters.swap(file.branchCounters);
+    functions.swap(file.functions);
+    functionLines.swap(file.functionLines);
+    functionCounters.swap(file.functionCounters);
+}
+
+void CompactTrace::FileGroup::swap(FileGroup& group)
+{
+    std::swap(testName, group.testName);
+    std::swap(filename, group.filename);
+    files.swap(group.files);
+}
+
+void CompactTrace::swap(CompactTrace& trace)
+{
+    strings.swap(trace.strings);
+    fileGroups.swap(trace.fileGroups);
+}
+
+void CompactTrace::clear(void)
+{
+    strings.clear();
+    fileGroups.clear();
+}
+
+void CompactTrace::appendGroups(CompactTrace& trace)
+{
+    /* Identificators of the strings of 'trace' in this trace. */
+    vector<int> ids(trace.strings.size());
+    for(int i = 0; i < (int)ids.size(); i++)
+        ids[i] = strings.intern(trace.strings[i]);
+
+    fileGroups.reserve(fileGroups.size() + trace.fileGroups.size());
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+    {
+        FileGroup& group = trace.fileGroups[i];
+        group.testName = ids[group.testName];
+        group.filename = ids[group.filename];
+
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            FileData& file = group.files[j];
+            file.name = ids[file.name];
+            for(int k = 0; k < (int)file.functions.size(); k++)
+                file.functions[k] = ids[file.functions[k]];
+        }
+
+        fileGroups.push_back(FileGroup());
+        fileGroups.back().swap(group);
+    }
+
+    trace.clear();
+}
+
+/*********************** Statistic ************************************/
+static int countPositive(const vector<counter_t>& counters)
+{
+    int result = 0;
+    for(int i = 0; i < (int)counters.size(); i++)
+    {
+        if(counters[i] > 0) result++;
+    }
+    return result;
+}
+
+int CompactTrace::FileData::linesTotalHit(void) const
+{
+    return countPositive(lineCounters);
+}
+
+int CompactTrace::FileData::branchesTotalHit(void) const
+{
+    return countPositive(branchCounters);
+}
+
+int CompactTrace::FileData::functionsTotalHit(void) const
+{
+    return countPositive(functionCounters);
+}
+
+void CompactTrace::FileData::addTotals(CoverageTotals& totals) const
+{
+    totals.lines += linesTotal();
+    totals.linesHit += linesTotalHit();
+    totals.functions += functionsTotal();
+    totals.functionsHit += functionsTotalHit();
+    totals.branches += branchesTotal();
+    totals.branchesHit += branchesTotalHit();
+}
+
+/* Sum per-file statistic, given by method 'stat', over all files. */
+static int sumFilesStat(const vector<CompactTrace::FileGroup>& groups,
+    int (CompactTrace::FileData::*stat)(void) const)
+{
+    int result = 0;
+    for(int i = 0; i < (int)groups.size(); i++)
+    {
+        const vector<CompactTrace::FileData>& files = groups[i].files;
+        for(int j = 0; j < (int)files.size(); j++)
+            result += (files[j].*stat)();
+    }
+    return result;
+}
+
+int CompactTrace::linesTotal(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::linesTotal);
+}
+
+int CompactTrace::linesTotalHit(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::linesTotalHit);
+}
+
+int CompactTrace::branchesTotal(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::branchesTotal);
+}
+
+int CompactTrace::branchesTotalHit(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::branchesTotalHit);
+}
+
+int CompactTrace::functionsTotal(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::functionsTotal);
+}
+
+int CompactTrace::functionsTotalHit(void) const
+{
+    return sumFilesStat(fileGroups, &FileData::functionsTotalHit);
+}
+
+CoverageTotals CompactTrace::totals(void) const
+{
+    CoverageTotals result;
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const vector<FileData>& files = fileGroups[i].files;
+        for(int j = 0; j < (int)files.size(); j++)
+            files[j].addTotals(result);
+    }
+    return result;
+}
+
+/*************************** Sorting helpers **************************/
+/* Reorder elements of the array, so new i-th element is old perm[i]-th. */
+template<class T>
+static void applyPermutation(vector<T>& values, const vector<int>& perm)
+{
+    vector<T> result;
+    result.reserve(values.size());
+    for(int i = 0; i < (int)perm.size(); i++)
+        result.push_back(values[perm[i]]);
+
+    values.swap(result);
+}
+
+/* Compare indecies in array according to values in it. */
+template<class T>
+struct IndexLess
+{
+    IndexLess(const vector<T>& values): values(values) {}
+    bool operator()(int i, int j) const {return values[i] < values[j];}
+
+    const vector<T>& values;
+};
+
+/* Compare indecies in array of strings identificators by strings. */
+struct IndexNameLess
+{
+    IndexNameLess(const vector<int>& ids, const StringTable& strings):
+        ids(ids), strings(strings) {}
+    bool operator()(int i, int j) const
+    {
+        return strings[ids[i]] < strings[ids[j]];
+    }
+
+    const vector<int>& ids;
+    const StringTable& strings;
+};
+
+/*
+ * Return permutation which makes 'keys' sorted according to 'less'.
+ *
+ * If array is already sorted(usual for lcov output), return false and
+ * leave 'perm' untouched.
+ */
+template<class Less>
+static bool sortPermutation(int n, Less less, vector<int>& perm)
+{
+    int i;
+    for(i = 1; i < n; i++)
+    {
+        if(less(i, i - 1)) break;
+    }
+    if(i >= n) return false;
+
+    perm.resize(n);
+    for(i = 0; i < n; i++) perm[i] = i;
+
+    stable_sort(perm.begin(), perm.end(), less);
+    return true;
+}
+
+/************************ Combining files *****************************/
+/*
+ * Combine branch counters.
+ * Take into account that '-1' corresponds to '-' in trace file
+ * and is "arranged before" '0'.
+ */
+static void combineBranchCounter(counter_t& counter, counter_t counterAnother)
+{
+    if(counter == -1)
+    {
+        if(counterAnother != -1) counter = counterAnother;
+    }
+    if(counterAnother > 0)
+    {
+        counter += counterAnother;
+    }
+}
+
+/* Update(if needed) function start line 'line' using 'lineAnother'. */
+static void updateFuncLine(int &line, int lineAnother)
+{
+    if(line == -1)
+    {
+        if(lineAnother >= 0) line = lineAnother;
+    }
+    else if(lineAnother != -1)
+    {
+        if(line != lineAnother)
+        {
+            static bool isFirst = true;
+            if(isFirst)
+            {
+                cerr << "Function has different lines in different "
+                    "coverage groups. This warning is reported once." << endl;
+                isFirst = false;
+            }
+        }
+    }
+}
+
+/*
+ * Combine counters of the file 'src' into the file 'dest'.
+ *
+ * Both files should use same string table.
+ *
+ * Duplicates of the same header usually have same lines, branches and
+ * functions. In that case counters are combined in place, without
+ * merging arrays.
+ */
+static void combineLines(CompactTrace::FileData& dest,
+    const CompactTrace::FileData& src)
+{
+    if(dest.lines == src.lines)
+    {
+        int n = dest.lines.size();
+        for(int i = 0; i < n; i++)
+            dest.lineCounters[i] += src.lineCounters[i];
+        return;
+    }
+
+    vector<int> lines;
+    vector<CompactTrace::counter_t> lineCounters;
+    lines.reserve(dest.lines.size() + src.lines.size());
+    lineCounters.reserve(dest.lines.size() + src.lines.size());
+
+    int i = 0, j = 0;
+    int n = dest.lines.size(), m = src.lines.size();
+    while((i < n) || (j < m))
+    {
+        if((j == m) || ((i < n) && (dest.lines[i] < src.lines[j])))
+        {
+            lines.push_back(dest.lines[i]);
+            lineCounters.push_back(dest.lineCounters[i]);
+            i++;
+        }
+        else if((i == n) || (src.lines[j] < dest.lines[i]))
+        {
+            lines.push_back(src.lines[j]);
+            lineCounters.push_back(src.lineCounters[j]);
+            j++;
+        }
+        else
+        {
+            lines.push_back(dest.lines[i]);
+            lineCounters.push_back(dest.lineCounters[i] + src.lineCounters[j]);
+            i++; j++;
+        }
+    }
+
+    dest.lines.swap(lines);
+    dest.lineCounters.swap(lineCounters);
+}
+
+static bool sameBranches(const vector<CompactTrace::BranchID>& branches1,
+    const vector<CompactTrace::BranchID>& branches2)
+{
+    if(branches1.size() != branches2.size()) return false;
+    for(int i = 0; i < (int)branches1.size(); i++)
+    {
+        const CompactTrace::BranchID& b1 = branches1[i];
+        const CompactTrace::BranchID& b2 = branches2[i];
+        if((b1.line != b2.line) || (b1.blockNumber != b2.blockNumber)
+            || (b1.branchNumber != b2.branchNumber))
+            return false;
+    }
+    return true;
+}
+
+static void combineBranches(CompactTrace::FileData& dest,
+    const CompactTrace::FileData& src)
+{
+    if(sameBranches(dest.branches, src.branches))
+    {
+        int n = dest.branches.size();
+        for(int i = 0; i < n; i++)
+            combineBranchCounter(dest.branchCounters[i], src.branchCounters[i]);
+        return;
+    }
+
+    vector<CompactTrace::BranchID> branches;
+    vector<CompactTrace::counter_t> branchCounters;
+    branches.reserve(dest.branches.size() + src.branches.size());
+    branchCounters.reserve(dest.branches.size() + src.branches.size());
+
+    int i = 0, j = 0;
+    int n = dest.branches.size(), m = src.branches.size();
+    while((i < n) || (j < m))
+    {
+        if((j == m) || ((i < n) && (dest.branches[i] < src.branches[j])))
+        {
+            branches.push_back(dest.branches[i]);
+            branchCounters.push_back(dest.branchCounters[i]);
+            i++;
+        }
+        else if((i == n) || (src.branches[j] < dest.branches[i]))
+        {
+            branches.push_back(src.branches[j]);
+            branchCounters.push_back(src.branchCounters[j]);
+            j++;
+        }
+        else
+        {
+            CompactTrace::counter_t counter = dest.branchCounters[i];
+            combineBranchCounter(counter, src.branchCounters[j]);
+            branches.push_back(dest.branches[i]);
+            branchCounters.push_back(counter);
+            i++; j++;
+        }
+    }
+
+    dest.branches.swap(branches);
+    dest.branchCounters.swap(branchCounters);
+}
+
+static void combineFunctions(CompactTrace::FileData& dest,
+    const CompactTrace::FileData& src, const StringTable& strings)
+{
+    /* Names are interned, so same identificators mean same functions. */
+    if(dest.functions == src.functions)
+    {
+        int n = dest.functions.size();
+        for(int i = 0; i < n; i++)
+        {
+            updateFuncLine(dest.functionLines[i], src.functionLines[i]);
+            dest.functionCounters[i] += src.functionCounters[i];
+        }
+        return;
+    }
+
+    vector<int> functions;
+    vector<int> functionLines;
+    vector<CompactTrace::counter_t> functionCounters;
+    functions.reserve(dest.functions.size() + src.functions.size());
+    functionLines.reserve(dest.functions.size() + src.functions.size());
+    functionCounters.reserve(dest.functions.size() + src.functions.size());
+
+    int i = 0, j = 0;
+    int n = dest.functions.size(), m = src.functions.size();
+    while((i < n) || (j < m))
+    {
+        int cmp;
+        if(j == m) cmp = -1;
+        else if(i == n) cmp = 1;
+        else if(dest.functions[i] == src.functions[j]) cmp = 0;
+        else cmp = strings[dest.functions[i]].compare(strings[src.functions[j]]);
+
+        if(cmp < 0)
+        {
+            functions.push_back(dest.functions[i]);
+            functionLines.push_back(dest.functionLines[i]);
+            functionCounters.push_back(dest.functionCounters[i]);
+            i++;
+        }
+        else if(cmp > 0)
+        {
+            functions.push_back(src.functions[j]);
+            functionLines.push_back(src.functionLines[j]);
+            functionCounters.push_back(src.functionCounters[j]);
+            j++;
+        }
+        else
+        {
+            int line = dest.functionLines[i];
+            updateFuncLine(line, src.functionLines[j]);
+            functions.push_back(dest.functions[i]);
+            functionLines.push_back(line);
+            functionCounters.push_back(dest.functionCounters[i] + src.functionCounters[j]);
+            i++; j++;
+        }
+    }
+
+    dest.functions.swap(functions);
+    dest.functionLines.swap(functionLines);
+    dest.functionCounters.swap(functionCounters);
+}
+
+static void combineFile(CompactTrace::FileData& dest,
+    const CompactTrace::FileData& src, const StringTable& strings)
+{
+    combineLines(dest, src);
+    combineBranches(dest, src);
+    combineFunctions(dest, src, strings);
+}
+
+/*************************** Group files ******************************/
+/* Reference to the group in the trace, used for sort groups. */
+struct FileRef
+{
+    const string* filename;
+    const string* testName;
+
+    int groupIndex;
+
+    bool operator<(const FileRef& ref) const
+    {
+        int cmp = filename->compare(*ref.filename);
+        if(cmp) return cmp < 0;
+        return testName->compare(*ref.testName) < 0;
+    }
+};
+
+/*
+ * Files are joined by identificators of their names and test names, so
+ * neither strings are compared nor files are sorted. Only resulted
+ * groups are sorted.
+ */
+
+/* Files which should be combined into one group. */
+struct JoinedGroup
+{
+    int testName;
+    int filename;
+
+    /* Range of files in the members array. */
+    int start;
+    int count;
+};
+
+/* Order of joined groups, same as for 'Trace::FileGroupID'. */
+struct JoinedGroupLess
+{
+    JoinedGroupLess(const StringTable& strings): strings(strings) {}
+
+    bool operator()(const JoinedGroup& group1, const JoinedGroup& group2) const
+    {
+        if(group1.filename != group2.filename)
+        {
+            int cmp = strings[group1.filename].compare(strings[group2.filename]);
+            if(cmp) return cmp < 0;
+        }
+        return strings[group1.testName] < strings[group2.testName];
+    }
+private:
+    const StringTable& strings;
+};
+
+void CompactTrace::groupFiles(void)
+{
+    int nFiles = 0;
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+        nFiles += fileGroups[i].files.size();
+
+    /* Joined group for every file, files are numbered consequently. */
+    vector<int> fileJoined(nFiles);
+    vector<JoinedGroup> joined;
+    unordered_map<uint64_t, int> joinedIndex;
+    joinedIndex.reserve(nFiles);
+
+    int fileIndex = 0;
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const FileGroup& group = fileGroups[i];
+        for(int j = 0; j < (int)group.files.size(); j++, fileIndex++)
+        {
+            int filename = group.files[j].name;
+            uint64_t key = ((uint64_t)(uint32_t)filename << 32)
+                | (uint32_t)group.testName;
+
+            pair<unordered_map<uint64_t, int>::iterator, bool> inserted =
+                joinedIndex.insert(make_pair(key, (int)joined.size()));
+            if(inserted.second)
+            {
+                JoinedGroup newGroup;
+                newGroup.testName = group.testName;
+                newGroup.filename = filename;
+                newGroup.start = 0;
+                newGroup.count = 0;
+                joined.push_back(newGroup);
+            }
+
+            fileJoined[fileIndex] = inserted.first->second;
+            joined[inserted.first->second].count++;
+        }
+    }
+
+    int start = 0;
+    for(int k = 0; k < (int)joined.size(); k++)
+    {
+        joined[k].start = start;
+        start += joined[k].count;
+        joined[k].count = 0;
+    }
+
+    /*
+     * Members of every joined group. Main files of the groups are
+     * combined first, other files are combined in the order of groups.
+     */
+    vector<FileData*> members(nFiles);
+    for(int pass = 0; pass < 2; pass++)
+    {
+        fileIndex = 0;
+        for(int i = 0; i < (int)fileGroups.size(); i++)
+        {
+            FileGroup& group = fileGroups[i];
+            for(int j = 0; j < (int)group.files.size(); j++, fileIndex++)
+            {
+                bool isGroupFile = group.files[j].name == group.filename;
+                if(isGroupFile != (pass == 0)) continue;
+
+                JoinedGroup& joinedGroup = joined[fileJoined[fileIndex]];
+                members[joinedGroup.start + joinedGroup.count++] = &group.files[j];
+            }
+        }
+    }
+
+    std::sort(joined.begin(), joined.end(), JoinedGroupLess(strings));
+
+    vector<FileGroup> newGroups(joined.size());
+    for(int k = 0; k < (int)joined.size(); k++)
+    {
+        const JoinedGroup& joinedGroup = joined[k];
+        FileGroup& newGroup = newGroups[k];
+        newGroup.testName = joinedGroup.testName;
+        newGroup.filename = joinedGroup.filename;
+        newGroup.files.resize(1);
+
+        FileData& file = newGroup.files[0];
+        file.swap(*members[joinedGroup.start]);
+        for(int m = 1; m < joinedGroup.count; m++)
+            combineFile(file, *members[joinedGroup.start + m], strings);
+    }
+
+    fileGroups.swap(newGroups);
+}
+
+/************************** Sources prefix ****************************/
+string CompactTrace::commonSourcePrefix(void) const
+{
+    string prefix;
+    /* Prefix is set when first source file found. */
+    bool isPrefixSet = false;
+
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const vector<FileData>& files = fileGroups[i].files;
+        for(int j = 0; j < (int)files.size(); j++)
+        {
+            const string& source = strings[files[j].name];
+            if(isPrefixSet)
+            {
+                int n = (int)std::min(prefix.size(), source.size());
+                for(int k = 0; k < n; k++)
+                {
+                    if(prefix[k] != source[k])
+                    {
+                        prefix.resize(k);
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                prefix = source;
+                isPrefixSet = true;
+            }
+        }
+    }
+
+    return prefix;
+}
+
+void CompactTrace::filterSources(const string& prefix)
+{
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        vector<FileData>& files = fileGroups[i].files;
+        int nKept = 0;
+        for(int j = 0; j < (int)files.size(); j++)
+        {
+            if(strings[files[j].name].compare(0, prefix.size(), prefix)) continue;
+            if(nKept != j) files[nKept].swap(files[j]);
+            nKept++;
+        }
+        files.resize(nKept);
+    }
+}
+
+/********************** Builder of the trace **************************/
+class CompactTrace::TraceBuilder: private TraceEventProcessor
+{
+public:
+    TraceBuilder(): trace(NULL), currentFile(-1) {}
+
+    void build(CompactTrace* trace, istream& is, TraceParser& parser,
+        const char* filename)
+    {
+        this->trace = trace;
+
+        groupsSeen.clear();
+
+        parser.parse(is, *this, filename);
+
+        finishTrace();
+    }
+
+    /* Return false if the parser fails. */
+    bool build(CompactTrace* trace, TraceMmapParser& parser,
+        const char* start, const char* end)
+    {
+        this->trace = trace;
+
+        groupsSeen.clear();
+
+        if(!parser.parse(start, end, *this)) return false;
+
+        finishTrace();
+        return true;
+    }
+
+    /* TN: <testName> */
+    void onTestStart(const std::string& testName, int /*traceLine*/)
+    {
+        currentGroup = FileGroup(trace->strings.intern(testName));
+        currentFile = -1;
+        filesSeen.clear();
+    }
+    void onTestEnd(int traceLine)
+    {
+        finishFile(traceLine);
+
+        if(currentGroup.filename == -1)
+        {
+            cerr << "WARNING: Ignore test '" << trace->strings[currentGroup.testName]
+                << "'without files." << endl;
+            return;
+        }
+
+        long long groupKey = ((long long)currentGroup.filename << 32)
+            | (unsigned)currentGroup.testName;
+        if(!groupsSeen.insert(groupKey).second)
+        {
+            trace_error("Information for files group " << groupName()
+                << " is written twice.");
+        }
+
+        /* Files in group should be sorted by names. */
+        vector<int> names(currentGroup.files.size());
+        for(int i = 0; i < (int)names.size(); i++)
+            names[i] = currentGroup.files[i].name;
+
+        if(sortPermutation(names.size(), IndexNameLess(names, trace->strings), perm))
+            applyPermutation(currentGroup.files, perm);
+
+        trace->fileGroups.push_back(FileGroup());
+        trace->fileGroups.back().swap(currentGroup);
+    }
+
+    /* SF: <sourcePath> */
+    void onSourceStart(const std::string& sourcePath, int traceLine)
+    {
+        finishFile(traceLine);
+
+        int name = trace->strings.intern(sourcePath);
+        if(!filesSeen.insert(name).second)
+        {
+            trace_error("Attempt to add information about file '"
+                << sourcePath << "' to group"
+                << groupName() << " which already has it.");
+        }
+
+        currentGroup.files.push_back(FileData(name));
+        currentFile = currentGroup.files.size() - 1;
+        funcIndex.clear();
+
+        if(currentGroup.filename == -1)
+        {
+            /* First file in the group - its name may be name of group */
+            currentGroup.filename = name;
+        }
+        else if(isSource(sourcePath))
+        {
+            /* Non-first file in the group, but corresponds to source file. */
+            if(isSource(trace->strings[currentGroup.filename]))
+            {
+                trace_error("Two source files in group " << groupName()
+                    << ".");
+            }
+            currentGroup.filename = name;
+        }
+    }
+
+    /* end_of_record */
+    void onSourceEnd(int traceLine)
+    {
+        finishFile(traceLine);
+    }
+
+    /* FN: <funcLine>, <funcName> */
+    void onFunction(const std::string& funcName, int funcLine, int traceLine)
+    {
+        FileData& file = getCurrentFile();
+        int name = trace->strings.intern(funcName);
+
+        if(!funcIndex.insert(make_pair(name, (int)file.functions.size())).second)
+        {
+            trace_error("Attempt to add function '" + funcName
+                + "' for file which already has it.");
+        }
+        file.functions.push_back(name);
+        file.functionLines.push_back(funcLine);
+        file.functionCounters.push_back(0);
+    }
+
+    /* FNDA: <counter>, <funcName> */
+    void onFunctionCounter(const std::string& funcName,
+        counter_t counter, int /*traceLine*/)
+    {
+        FileData& file = getCurrentFile();
+        int name = trace->strings.intern(funcName);
+
+        pair<unordered_map<int, int>::iterator, bool> iterNew =
+            funcIndex.insert(make_pair(name, (int)file.functions.size()));
+        if(iterNew.second)
+        {
+            /*
+             * Strange, but possible - see definition of 'lineStart'
+             * in 'Trace::FuncInfo' structure.
+             */
+            file.functions.push_back(name);
+            file.functionLines.push_back(-1);
+            file.functionCounters.push_back(counter);
+        }
+        else
+        {
+            file.functionCounters[iterNew.first->second] = counter;
+        }
+    }
+
+    /*
+     * BRDA: <branchLine>, <blockNumber>, <branchNumber>, <counter>
+     */
+    void onBranchCoverage(int branchLine,
+        int blockNumber, int branchNumber, counter_t counter, int traceLine)
+    {
+        if(branchLine > 1000000)
+            cerr << traceLine << ": Branch with line number " << branchLine << " is found." << endl;
+
+        FileData& file = getCurrentFile();
+        file.branches.push_back(BranchID(branchLine, blockNumber, branchNumber));
+        file.branchCounters.push_back(counter);
+    }
+    /*
+     * BRDA: <branchLine>, <blockNumber>, <branchNumber>, -
+     */
+    void onBranchNotCovered(int branchLine,
+        int blockNumber, int branchNumber, int /*traceLine*/)
+    {
+        FileData& file = getCurrentFile();
+        file.branches.push_back(BranchID(branchLine, blockNumber, branchNumber));
+        file.branchCounters.push_back(-1);
+    }
+
+    /* DA: <line>, <counter> */
+    void onLineCounter(int line, counter_t counter, int /*traceLine*/)
+    {
+        FileData& file = getCurrentFile();
+        file.lines.push_back(line);
+        file.lineCounters.push_back(counter);
+    }
+
+private:
+    /* Set when need to build trace. */
+    CompactTrace* trace;
+
+    /* Group under construction. */
+    FileGroup currentGroup;
+    /* Index of the file under construction in the group, or -1. */
+    int currentFile;
+
+    /* Function name -> index in arrays of the current file. */
+    unordered_map<int, int> funcIndex;
+    /* Files already added to the current group. */
+    unordered_set<int> filesSeen;
+    /* Keys of groups already added to the trace. */
+    unordered_set<long long> groupsSeen;
+
+    /* Temporary permutation, allocated once. */
+    vector<int> perm;
+
+    FileData& getCurrentFile(void)
+    {
+        assert(currentFile != -1);
+        return currentGroup.files[currentFile];
+    }
+
+    /* Pretty printer of the current group for error-reporting. */
+    string groupName(void) const
+    {
+        string result = "{";
+        if(!trace->strings[currentGroup.testName].empty())
+            result += trace->strings[currentGroup.testName] + ",";
+        if(currentGroup.filename != -1)
+            result += trace->strings[currentGroup.filename];
+        return result + "}";
+    }
+
+    /*
+     * Sort arrays in the current file and check that they have no
+     * duplicates.
+     */
+    void finishFile(int traceLine)
+    {
+        if(currentFile == -1) return;
+
+        FileData& file = getCurrentFile();
+        currentFile = -1;
+
+        if(sortPermutation(file.lines.size(), IndexLess<int>(file.lines), perm))
+        {
+            applyPermutation(file.lines, perm);
+            applyPermutation(file.lineCounters, perm);
+        }
+        for(int i = 1; i < (int)file.lines.size(); i++)
+        {
+            if(file.lines[i] == file.lines[i - 1])
+            {
+                trace_error("Attempt to add counter for line " << file.lines[i] <<
+                    " to file which already has it.");
+            }
+        }
+
+        if(sortPermutation(file.branches.size(), IndexLess<BranchID>(file.branches), perm))
+        {
+            applyPermutation(file.branches, perm);
+            applyPermutation(file.branchCounters, perm);
+        }
+        for(int i = 1; i < (int)file.branches.size(); i++)
+        {
+            if(!(file.branches[i - 1] < file.branches[i]))
+            {
+                trace_error("Attempt to add counter for branch "
+                    "to file which already has it.");
+            }
+        }
+
+        if(sortPermutation(file.functions.size(),
+            IndexNameLess(file.functions, trace->strings), perm))
+        {
+            applyPermutation(file.functions, perm);
+            applyPermutation(file.functionLines, perm);
+            applyPermutation(file.functionCounters, perm);
+        }
+    }
+
+    /* Sort groups in the trace. */
+    void finishTrace(void)
+    {
+        vector<FileGroup>& groups = trace->fileGroups;
+
+        vector<FileRef> refs(groups.size());
+        for(int i = 0; i < (int)groups.size(); i++)
+        {
+            refs[i].filename = &trace->strings[groups[i].filename];
+            refs[i].testName = &trace->strings[groups[i].testName];
+            refs[i].groupIndex = i;
+        }
+
+        if(sortPermutation(refs.size(), IndexLess<FileRef>(refs), perm))
+            applyPermutation(groups, perm);
+    }
+};
+
+void CompactTrace::read(std::istream& is, TraceParser& parser, const char* filename)
+{
+    if(isBinary(is))
+    {
+        readBinary(is, filename);
+        return;
+    }
+
+    TraceBuilder builder;
+
+    builder.build(this, is, parser, filename);
+}
+
+void CompactTrace::read(std::istream& is, const char* filename)
+{
+    TraceParser parser;
+    read(is, parser, filename);
+}
+
+void CompactTrace::read(const char* filename, TraceParser& parser)
+{
+    /* Binary trace is read directly from the mapped file. */
+    FileMapping mapping;
+    if(mapping.map(filename) && isBinary(mapping.begin(), mapping.end()))
+    {
+        readBinary(mapping.begin(), mapping.end(), filename);
+        return;
+    }
+
+    /* Compressed trace is decompressed while it is parsed. */
+    CompressedIfstream is(filename);
+    if(!is)
+    {
+        cerr << "Failed to open file '" << filename << "' for read trace." << endl;
+        throw runtime_error("Cannot open file");
+    }
+
+    try
+    {
+        read(is, parser, filename);
+    }
+    catch(...)
+    {
+        /* Corrupted compressed data is more likely cause of the error. */
+        is.close();
+        throw;
+    }
+    is.close();
+}
+
+void CompactTrace::read(const char* filename)
+{
+    TraceParser parser;
+    read(filename, parser);
+}
+
+void CompactTrace::readMapped(const char* filename)
+{
+    FileMapping mapping;
+    /* Let usual parser to report about inaccessible file. */
+    if(!mapping.map(filename))
+    {
+        read(filename);
+        return;
+    }
+
+    if(isBinary(mapping.begin(), mapping.end()))
+    {
+        readBinary(mapping.begin(), mapping.end(), filename);
+        return;
+    }
+
+    if(compressionBySignature(mapping.begin(), mapping.end()) != compressionNone)
+    {
+        read(filename);
+        return;
+    }
+
+    TraceMmapParser parser;
+    TraceBuilder builder;
+
+    if(builder.build(this, parser, mapping.begin(), mapping.end())) return;
+
+    /* Drop partially loaded trace and parse again. */
+    clear();
+    read(filename);
+}
+
+/****************************** Write *********************************/
+/*
+ * Write file information into stream.
+ *
+ * Format is the same as for 'Trace'.
+ */
+static void writeFileDataToStream(const CompactTrace::FileData& file,
+    const StringTable& strings, ostream& os)
+{
+    int n = file.functions.size();
+    /* Print functions lines */
+    for(int i = 0; i < n; i++)
+    {
+        /*
+         * See description of 'lineStart' field in 'Trace::FuncInfo'
+         * structure for special processing of its -1 value.
+         */
+        if(file.functionLines[i] != -1)
+        {
+            os << "FN:" << file.functionLines[i]
+                << ',' << strings[file.functions[i]] << '\n';
+        }
+    }
+    /* Print functions counters */
+    for(int i = 0; i < n; i++)
+    {
+        os << "FNDA:" << file.functionCounters[i] << ','
+            << strings[file.functions[i]] << '\n';
+    }
+    /* Print functions statistic */
+    os << "FNF:" << file.functionsTotal() << '\n';
+    os << "FNH:" << file.functionsTotalHit() << '\n';
+
+    /* Print branches counters */
+    n = file.branches.size();
+    for(int i = 0; i < n; i++)
+    {
+        const BranchID& branch = file.branches[i];
+        os << "BRDA:" << branch.line << ',' << branch.blockNumber << ','
+            << branch.branchNumber << ',';
+
+        counter_t counter = file.branchCounters[i];
+        if(counter != -1)
+            os << counter;
+        else
+            os << '-';
+        os << '\n';
+    }
+    /* Print branches statistic */
+    os << "BRF:" << file.branchesTotal() << '\n';
+    os << "BRH:" << file.branchesTotalHit() << '\n';
+
+    /* Print lines counters */
+    n = file.lines.size();
+    for(int i = 0; i < n; i++)
+    {
+        os << "DA:" << file.lines[i] << ',' << file.lineCounters[i] << '\n';
+    }
+    /* Print lines statistic */
+    os << "LF:" << file.linesTotal() << '\n';
+    os << "LH:" << file.linesTotalHit() << '\n';
+}
+
+void CompactTrace::write(std::ostream& os) const
+{
+    bool isFirst = true;
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const FileGroup& group = fileGroups[i];
+        if(group.files.empty()) continue;
+
+        if(!isFirst) os << '\n';
+        isFirst = false;
+
+        os << "TN:" << strings[group.testName] << '\n';
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            if(j > 0) os << '\n'; /* newline after previous record */
+
+            os << "SF:" << strings[group.files[j].name] << '\n';
+            writeFileDataToStream(group.files[j], strings, os);
+            os << "end_of_record";
+        }
+    }
+
+    if(isFirst)
+    {
+        /* Empty trace. Same as for 'Trace'. */
+        os << "TN:";
+    }
+    os.flush();
+}
+
+/************************** Conversion ********************************/
+void CompactTrace::exportTo(Trace& trace) const
+{
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const FileGroup& group = fileGroups[i];
+
+        Trace::FileGroupID groupID;
+        groupID.testName = strings[group.testName];
+        groupID.filename = strings[group.filename];
+
+        Trace::FileGroupInfo* groupInfo = new Trace::FileGroupInfo();
+        pair<map<Trace::FileGroupID, Trace::FileGroupInfo*>::iterator, bool>
+            iterNew = trace.fileGroups.insert(make_pair(groupID, groupInfo));
+        if(!iterNew.second)
+        {
+            delete groupInfo;
+            throw logic_error("Trace for export into should be empty");
+        }
+
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            const FileData& file = group.files[j];
+            Trace::FileInfo& fileInfo = groupInfo->files[strings[file.name]];
+
+            /* Arrays are sorted, so elements are always appended to maps. */
+            for(int k = 0; k < (int)file.lines.size(); k++)
+            {
+                fileInfo.lines.insert(fileInfo.lines.end(),
+                    make_pair(file.lines[k], file.lineCounters[k]));
+            }
+            for(int k = 0; k < (int)file.branches.size(); k++)
+            {
+                fileInfo.branches.insert(fileInfo.branches.end(),
+                    make_pair(file.branches[k], file.branchCounters[k]));
+            }
+            for(int k = 0; k < (int)file.functions.size(); k++)
+            {
+                Trace::FuncInfo funcInfo(file.functionLines[k]);
+                funcInfo.counter = file.functionCounters[k];
+                fileInfo.functions.insert(fileInfo.functions.end(),
+                    make_pair(strings[file.functions[k]], funcInfo));
+            }
+        }
+    }
+}
@@ -0,0 +1,245 @@
+/*
+ * Compact(columnar) representation of trace files generated by lcov.
+ *
+ * Contains same information as 'Trace', but file and function names
+ * are interned into the string table and per-file counters are stored
+ * in flat sorted arrays instead of maps. Such representation requires
+ * several times less memory and is much faster for iterate over.
+ */
+
+#ifndef COMPACT_TRACE_HH_INCLUDED
+#define COMPACT_TRACE_HH_INCLUDED
+
+#include "trace.hh"
+
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/*
+ * Table of interned strings.
+ *
+ * Each string is stored only once and is identified by its index.
+ */
+class StringTable
+{
+public:
+    StringTable() {}
+
+    StringTable(const StringTable& table);
+    StringTable& operator=(const StringTable& table);
+
+    /* Return identificator of the string, adding it to the table if needed. */
+    int intern(const std::string& str);
+
+    const std::string& operator[](int id) const {return *strings[id];}
+
+    int size(void) const {return (int)strings.size();}
+
+    /* Prepare table for store 'n' strings. */
+    void reserve(int n);
+
+    void clear(void);
+
+    void swap(StringTable& table);
+private:
+    /* Strings in order of their identificators. Point to keys in 'ids'. */
+    std::vector<const std::string*> strings;
+    std::unordered_map<std::string, int> ids;
+};
+
+/* Coverage statistic of the trace or of some part of it. */
+struct CoverageTotals
+{
+    int lines;
+    int linesHit;
+    int functions;
+    int functionsHit;
+    int branches;
+    int branchesHit;
+
+    CoverageTotals(): lines(0), linesHit(0), functions(0), functionsHit(0),
+        branches(0), branchesHit(0) {}
+
+    void add(const CoverageTotals& totals)
+    {
+        lines += totals.lines;
+        linesHit += totals.linesHit;
+        functions += totals.functions;
+        functionsHit += totals.functionsHit;
+        branches += totals.branches;
+        branchesHit += totals.branchesHit;
+    }
+};
+
+struct CompactTrace
+{
+    typedef Trace::counter_t counter_t;
+    typedef Trace::BranchID BranchID;
+
+    CompactTrace() {}
+
+    /*
+     * Load trace from the stream.
+     *
+     * If non-empty, 'filename' is used for error reporting.
+     */
+    void read(std::istream& is, const char* filename = "");
+    /* Same but use already existed parser instead of create new one. */
+    void read(std::istream& is, TraceParser& parser, const char* filename = "");
+    /* Load trace from file. */
+    void read(const char* filename);
+    void read(const char* filename, TraceParser& parser);
+    /*
+     * Load trace from file using 'TraceMmapParser'.
+     *
+     * If that parser fails, trace is reloaded using usual parser,
+     * which reports errors.
+     */
+    void readMapped(const char* filename);
+
+    /* Store trace to the stream. Output is the same as for 'Trace'. */
+    void write(std::ostream& os) const;
+
+    /*
+     * Binary format of the trace.
+     *
+     * Trace is stored with its string table and flat arrays almost as
+     * they are kept in memory, so loading requires neither parsing nor
+     * sorting. All 'read' methods above detect binary traces by their
+     * signature and load them, so such traces may be used everywhere
+     * instead of lcov ones.
+     *
+     * Format is versioned and checksummed. It depends on the byte order
+     * of the machine, so it is intended for cache traces rather than
+     * for exchange them.
+     */
+    static bool isBinary(const char* start, const char* end);
+    /* Check first character of the stream without extracting it. */
+    static bool isBinary(std::istream& is);
+
+    void readBinary(const char* start, const char* end, const char* filename = "");
+    void readBinary(std::istream& is, const char* filename = "");
+
+    void writeBinary(std::ostream& os) const;
+
+    /* Fill empty 'trace' with information from this trace. */
+    void exportTo(Trace& trace) const;
+
+    struct FileData;
+    struct FileGroup;
+
+    /* All strings(test names, file names, function names) of the trace. */
+    StringTable strings;
+
+    /*
+     * Groups of files, sorted in the same order as 'Trace::fileGroups'
+     * (by filename and then by test name).
+     *
+     * See description of 'Trace::FileGroupID' for meaning of groups.
+     */
+    std::vector<FileGroup> fileGroups;
+
+    /* Same as corresponded methods of 'Trace'. */
+    void groupFiles(void);
+
+    int linesTotal(void) const;
+    int linesTotalHit(void) const;
+
+    int branchesTotal(void) const;
+    int branchesTotalHit(void) const;
+
+    int functionsTotal(void) const;
+    int functionsTotalHit(void) const;
+
+    /* All statistic above, collected in one pass over the trace. */
+    CoverageTotals totals(void) const;
+
+    std::string commonSourcePrefix(void) const;
+
+    void filterSources(const std::string& prefix);
+
+    /*
+     * Move all groups from 'trace' to the end of this trace.
+     *
+     * Caller should ensure that groups remain sorted, that is all groups
+     * in 'trace' should follow ones in this trace. 'trace' becomes empty.
+     */
+    void appendGroups(CompactTrace& trace);
+
+    void swap(CompactTrace& trace);
+    void clear(void);
+private:
+    class TraceBuilder;
+};
+
+/*
+ * Information about one file(source or header) in trace.
+ *
+ * Arrays with same prefix are parallel ones, that is i-th element
+ * of one array corresponds to i-th element of another.
+ */
+struct CompactTrace::FileData
+{
+    /* Identificator of file name. */
+    int name;
+
+    /* Line numbers in ascending order and corresponded counters. */
+    std::vector<int> lines;
+    std::vector<counter_t> lineCounters;
+
+    /*
+     * Branches in ascending order and corresponded counters.
+     *
+     * Counter -1 corresponds to '-' in BRDA directive in trace file.
+     */
+    std::vector<BranchID> branches;
+    std::vector<counter_t> branchCounters;
+
+    /*
+     * Identificators of function names(sorted by names, not by ids),
+     * start lines and counters.
+     *
+     * See 'Trace::FuncInfo' for meaning of -1 start line.
+     */
+    std::vector<int> functions;
+    std::vector<int> functionLines;
+    std::vector<counter_t> functionCounters;
+
+    FileData(int name = -1): name(name) {}
+
+    void swap(FileData& file);
+
+    /* Useful functions for calculate per-file statistic */
+    int linesTotal(void) const {return (int)lines.size();}
+    int linesTotalHit(void) const;
+
+    int branchesTotal(void) const {return (int)branches.size();}
+    int branchesTotalHit(void) const;
+
+    int functionsTotal(void) const {return (int)functions.size();}
+    int functionsTotalHit(void) const;
+
+    /* Add statistic of the file to 'totals'. */
+    void addTotals(CoverageTotals& totals) const;
+};
+
+/* Information about group of files. */
+struct CompactTrace::FileGroup
+{
+    /* Identificators of test name and name of group's file. */
+    int testName;
+    int filename;
+
+    /* Files in group, sorted by names. */
+    std::vector<FileData> files;
+
+    FileGroup(int testName = -1, int filename = -1):
+        testName(testName), filename(filename) {}
+
+    void swap(FileGroup& group);
+};
+
+#endif /* COMPACT_TRACE_HH_INCLUDED */
@@ -0,0 +1,280 @@
+// compact_trace_binary.cpp - binary format of 'CompactTrace'.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Layout of the binary trace(all numbers are in the machine byte order):
+ *
+ * header:
+ *      char[8]     magic
+ *      uint32      version
+ *      uint32      byte order mark
+ *      uint64      size of the payload
+ *      uint64      checksum of the payload
+ * payload:
+ *      uint32      number of strings
+ *      for every string:
+ *          uint32  length
+ *          char[]  characters
+ *      uint32      number of groups
+ *      for every group:
+ *          int32   test name
+ *          int32   group's filename
+ *          uint32  number of files
+ *          for every file:
+ *              int32   name
+ *              uint32  number of lines
+ *              int32[] lines
+ *              int64[] line counters
+ *              uint32  number of branches
+ *              int32[3][] branches(line, block number, branch number)
+ *              int64[] branch counters
+ *              uint32  number of functions
+ *              int32[] functions names
+ *              int32[] functions lines
+ *              int64[] functions counters
+ *
+ * Names are indices in the string table. Everything is stored in the
+ * same order as in 'CompactTrace', so no sorting is needed on load.
+ */
+
+#include "compact_trace.hh"
+#include "binary_format.hh"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+typedef CompactTrace::counter_t counter_t;
+typedef CompactTrace::BranchID BranchID;
+
+static const char binaryMagic[8] = {'\x89', 'K', 'C', 'O', 'V', '\r', '\n', '\x1a'};
+static const uint32_t binaryVersion = 1;
+
+/*
+ * Report about error in binary trace and throw exception.
+ *
+ * 'msg' is used only for insert into stream.
+ */
+#define binary_error(msg) do { \
+    if(*filename) cerr << filename << ": "; \
+    cerr << msg << endl; \
+    throw runtime_error("Invalid binary trace"); \
+} while(0)
+
+bool CompactTrace::isBinary(const char* start, const char* end)
+{
+    return binaryHasMagic(start, end, binaryMagic);
+}
+
+bool CompactTrace::isBinary(std::istream& is)
+{
+    /* No text trace may start with such character. */
+    return is.peek() == (unsigned char)binaryMagic[0];
+}
+
+/********************************* Read *******************************/
+/* Read array of indices in the string table. */
+static bool getIds(BinaryReader& reader, vector<int>& ids, uint32_t n,
+    int nStrings)
+{
+    reader.getArray(ids, n);
+    for(uint32_t i = 0; i < n; i++)
+        if((unsigned)ids[i] >= (unsigned)nStrings) return false;
+    return true;
+}
+
+static void getCounters(BinaryReader& reader, vector<counter_t>& counters,
+    uint32_t n)
+{
+    if(sizeof(counter_t) == sizeof(int64_t))
+    {
+        reader.getArray(counters, n);
+        return;
+    }
+
+    counters.resize(n);
+    for(uint32_t i = 0; i < n; i++)
+    {
+        int64_t counter;
+        reader.get(counter);
+        counters[i] = counter;
+    }
+}
+
+/* Number of bytes for one element of each per-file array. */
+static const size_t lineSize = sizeof(int32_t) + sizeof(int64_t);
+static const size_t branchSize = 3 * sizeof(int32_t) + sizeof(int64_t);
+static const size_t functionSize = 2 * sizeof(int32_t) + sizeof(int64_t);
+
+void CompactTrace::readBinary(const char* start, const char* end, const char* filename)
+{
+    static_assert(sizeof(BranchID) == 3 * sizeof(int32_t),
+        "BranchID should be stored as is");
+    static_assert(sizeof(int) == sizeof(int32_t),
+        "Names and lines should be stored as is");
+
+    const char* payload = NULL;
+    const char* error = binaryCheckHeader(start, end, binaryMagic,
+        binaryVersion, payload);
+    if(error && payload)
+        binary_error("Binary trace is corrupted: " << error << '.');
+    else if(error)
+        binary_error("Not a valid binary trace: " << error << '.');
+
+    BinaryReader reader(payload, end);
+
+    uint32_t nStrings;
+    if(!reader.getSize(nStrings, sizeof(uint32_t)))
+        binary_error("Binary trace is corrupted: string table.");
+
+    strings.reserve(nStrings);
+    string str;
+    for(uint32_t i = 0; i < nStrings; i++)
+    {
+        if(!reader.getString(str) || (strings.intern(str) != (int)i))
+            binary_error("Binary trace is corrupted: string table.");
+    }
+
+    uint32_t nGroups;
+    if(!reader.getSize(nGroups, 3 * sizeof(uint32_t)))
+        binary_error("Binary trace is corrupted: groups.");
+
+    fileGroups.resize(nGroups);
+    for(uint32_t i = 0; i < nGroups; i++)
+    {
+        FileGroup& group = fileGroups[i];
+        uint32_t nFiles;
+        if(!reader.get(group.testName) || !reader.get(group.filename)
+            || ((unsigned)group.testName >= nStrings)
+            || ((unsigned)group.filename >= nStrings)
+            || !reader.getSize(nFiles, 4 * sizeof(uint32_t)))
+        {
+            binary_error("Binary trace is corrupted: group " << i << '.');
+        }
+
+        group.files.resize(nFiles);
+        for(uint32_t j = 0; j < nFiles; j++)
+        {
+            FileData& file = group.files[j];
+            uint32_t n;
+
+            if(!reader.get(file.name) || ((unsigned)file.name >= nStrings))
+                binary_error("Binary trace is corrupted: group " << i << '.');
+
+            if(!reader.getSize(n, lineSize))
+                binary_error("Binary trace is corrupted: lines of '"
+                    << strings[file.name] << "'.");
+            reader.getArray(file.lines, n);
+            getCounters(reader, file.lineCounters, n);
+
+            if(!reader.getSize(n, branchSize))
+                binary_error("Binary trace is corrupted: branches of '"
+                    << strings[file.name] << "'.");
+            reader.getArray(file.branches, n, BranchID(0, 0, 0));
+            getCounters(reader, file.branchCounters, n);
+
+            if(!reader.getSize(n, functionSize)
+                || !getIds(reader, file.functions, n, nStrings))
+                binary_error("Binary trace is corrupted: functions of '"
+                    << strings[file.name] << "'.");
+            reader.getArray(file.functionLines, n);
+            getCounters(reader, file.functionCounters, n);
+        }
+    }
+
+    if(!reader.atEnd())
+        binary_error("Binary trace is corrupted: garbage at the end.");
+}
+
+void CompactTrace::readBinary(std::istream& is, const char* filename)
+{
+    string data;
+    char buffer[1 << 16];
+    while(is.read(buffer, sizeof(buffer)) || is.gcount())
+        data.append(buffer, is.gcount());
+
+    if(is.bad())
+        binary_error("Failed to read binary trace.");
+
+    readBinary(data.data(), data.data() + data.size(), filename);
+}
+
+/******************************** Write *******************************/
+static void putCounters(string& buffer, const vector<counter_t>& counters)
+{
+    if(sizeof(counter_t) == sizeof(int64_t))
+    {
+        binaryPutArray(buffer, counters);
+        return;
+    }
+
+    for(int i = 0; i < (int)counters.size(); i++)
+        binaryPutValue(buffer, (int64_t)counters[i]);
+}
+
+void CompactTrace::writeBinary(std::ostream& os) const
+{
+    string payload;
+
+    binaryPutValue(payload, (uint32_t)strings.size());
+    for(int i = 0; i < strings.size(); i++)
+        binaryPutString(payload, strings[i]);
+
+    binaryPutValue(payload, (uint32_t)fileGroups.size());
+    for(int i = 0; i < (int)fileGroups.size(); i++)
+    {
+        const FileGroup& group = fileGroups[i];
+        binaryPutValue(payload, (int32_t)group.testName);
+        binaryPutValue(payload, (int32_t)group.filename);
+        binaryPutValue(payload, (uint32_t)group.files.size());
+
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            const FileData& file = group.files[j];
+            binaryPutValue(payload, (int32_t)file.name);
+
+            binaryPutValue(payload, (uint32_t)file.lines.size());
+            binaryPutArray(payload, file.lines);
+            putCounters(payload, file.lineCounters);
+
+            binaryPutValue(payload, (uint32_t)file.branches.size());
+            binaryPutArray(payload, file.branches);
+            putCounters(payload, file.branchCounters);
+
+            binaryPutValue(payload, (uint32_t)file.functions.size());
+            binaryPutArray(payload, file.functions);
+            binaryPutArray(payload, file.functionLines);
+            putCounters(payload, file.functionCounters);
+        }
+    }
+
+    BinaryHeader header = binaryMakeHeader(binaryMagic, binaryVersion, payload);
+
+    os.write((const char*)&header, sizeof(header));
+    os.write(payload.data(), payload.size());
+    os.flush();
+}
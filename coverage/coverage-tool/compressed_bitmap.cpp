@@ -0,0 +1,291 @@
+// compressed_bitmap.cpp - compressed set of 32-bit integers.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Binary layout of the set(see 'binary_format.hh'):
+ *
+ *      uint32      number of chunks
+ *      for every chunk:
+ *          uint16      key(upper 16 bits of values)
+ *          uint16      1 for bitmap chunk, 0 for array one
+ *          uint32      number of values in chunk
+ *          uint16[]    values(array chunk)
+ *       or uint64[1024] bits(bitmap chunk)
+ */
+
+#include "compressed_bitmap.hh"
+#include "binary_format.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+/******************************** Chunk *******************************/
+bool CompressedBitmap::Chunk::add(uint16_t low)
+{
+    if(isBitmap())
+    {
+        uint64_t& word = bitmap[low / 64];
+        uint64_t mask = (uint64_t)1 << (low % 64);
+        if(word & mask) return false;
+        word |= mask;
+        count++;
+        return true;
+    }
+
+    vector<uint16_t>::iterator iter = lower_bound(array.begin(), array.end(), low);
+    if((iter != array.end()) && (*iter == low)) return false;
+    array.insert(iter, low);
+
+    if((int)array.size() > arrayMax) toBitmap();
+    return true;
+}
+
+bool CompressedBitmap::Chunk::remove(uint16_t low)
+{
+    if(isBitmap())
+    {
+        uint64_t& word = bitmap[low / 64];
+        uint64_t mask = (uint64_t)1 << (low % 64);
+        if(!(word & mask)) return false;
+        word &= ~mask;
+        count--;
+
+        if(count <= arrayMax) toArray();
+        return true;
+    }
+
+    vector<uint16_t>::iterator iter = lower_bound(array.begin(), array.end(), low);
+    if((iter == array.end()) || (*iter != low)) return false;
+    array.erase(iter);
+    return true;
+}
+
+bool CompressedBitmap::Chunk::contains(uint16_t low) const
+{
+    if(isBitmap())
+        return (bitmap[low / 64] >> (low % 64)) & 1;
+
+    return binary_search(array.begin(), array.end(), low);
+}
+
+void CompressedBitmap::Chunk::unite(const Chunk& other)
+{
+    if(!isBitmap() && !other.isBitmap())
+    {
+        vector<uint16_t> result;
+        result.reserve(array.size() + other.array.size());
+        set_union(array.begin(), array.end(),
+            other.array.begin(), other.array.end(), back_inserter(result));
+        array.swap(result);
+
+        if((int)array.size() > arrayMax) toBitmap();
+        return;
+    }
+
+    if(!isBitmap()) toBitmap();
+
+    if(other.isBitmap())
+    {
+        count = 0;
+        for(int i = 0; i < bitmapWords; i++)
+        {
+            bitmap[i] |= other.bitmap[i];
+            count += __builtin_popcountll(bitmap[i]);
+        }
+    }
+    else
+    {
+        for(int i = 0; i < (int)other.array.size(); i++) add(other.array[i]);
+    }
+}
+
+void CompressedBitmap::Chunk::toBitmap(void)
+{
+    bitmap.assign(bitmapWords, 0);
+    for(int i = 0; i < (int)array.size(); i++)
+        bitmap[array[i] / 64] |= (uint64_t)1 << (array[i] % 64);
+    count = array.size();
+    vector<uint16_t>().swap(array);
+}
+
+void CompressedBitmap::Chunk::toArray(void)
+{
+    array.reserve(count);
+    for(int i = 0; i < bitmapWords; i++)
+    {
+        for(uint64_t word = bitmap[i]; word; word &= word - 1)
+            array.push_back(i * 64 + __builtin_ctzll(word));
+    }
+    vector<uint64_t>().swap(bitmap);
+    count = 0;
+}
+
+/****************************** Set itself ****************************/
+int CompressedBitmap::findChunk(uint16_t key) const
+{
+    int left = 0, right = chunks.size();
+    while(left < right)
+    {
+        int middle = (left + right) / 2;
+        if(chunks[middle].key < key) left = middle + 1;
+        else right = middle;
+    }
+    return left;
+}
+
+void CompressedBitmap::add(uint32_t value)
+{
+    uint16_t key = value >> 16;
+    int index = findChunk(key);
+    if((index == (int)chunks.size()) || (chunks[index].key != key))
+        chunks.insert(chunks.begin() + index, Chunk(key));
+
+    chunks[index].add(value & 0xffff);
+}
+
+void CompressedBitmap::remove(uint32_t value)
+{
+    uint16_t key = value >> 16;
+    int index = findChunk(key);
+    if((index == (int)chunks.size()) || (chunks[index].key != key)) return;
+
+    chunks[index].remove(value & 0xffff);
+    if(chunks[index].cardinality() == 0)
+        chunks.erase(chunks.begin() + index);
+}
+
+bool CompressedBitmap::contains(uint32_t value) const
+{
+    uint16_t key = value >> 16;
+    int index = findChunk(key);
+    if((index == (int)chunks.size()) || (chunks[index].key != key)) return false;
+
+    return chunks[index].contains(value & 0xffff);
+}
+
+int CompressedBitmap::cardinality(void) const
+{
+    int result = 0;
+    for(int i = 0; i < (int)chunks.size(); i++)
+        result += chunks[i].cardinality();
+    return result;
+}
+
+void CompressedBitmap::unite(const CompressedBitmap& other)
+{
+    for(int i = 0; i < (int)other.chunks.size(); i++)
+    {
+        const Chunk& chunk = other.chunks[i];
+        int index = findChunk(chunk.key);
+        if((index == (int)chunks.size()) || (chunks[index].key != chunk.key))
+            chunks.insert(chunks.begin() + index, chunk);
+        else
+            chunks[index].unite(chunk);
+    }
+}
+
+void CompressedBitmap::getValues(std::vector<uint32_t>& values) const
+{
+    for(int i = 0; i < (int)chunks.size(); i++)
+    {
+        const Chunk& chunk = chunks[i];
+        uint32_t high = (uint32_t)chunk.key << 16;
+        if(chunk.isBitmap())
+        {
+            for(int j = 0; j < bitmapWords; j++)
+            {
+                for(uint64_t word = chunk.bitmap[j]; word; word &= word - 1)
+                    values.push_back(high | (j * 64 + __builtin_ctzll(word)));
+            }
+        }
+        else
+        {
+            for(int j = 0; j < (int)chunk.array.size(); j++)
+                values.push_back(high | chunk.array[j]);
+        }
+    }
+}
+
+/****************************** Binary I/O ****************************/
+void CompressedBitmap::write(std::string& buffer) const
+{
+    binaryPutValue(buffer, (uint32_t)chunks.size());
+    for(int i = 0; i < (int)chunks.size(); i++)
+    {
+        const Chunk& chunk = chunks[i];
+        binaryPutValue(buffer, chunk.key);
+        binaryPutValue(buffer, (uint16_t)chunk.isBitmap());
+        binaryPutValue(buffer, (uint32_t)chunk.cardinality());
+        if(chunk.isBitmap())
+            binaryPutArray(buffer, chunk.bitmap);
+        else
+            binaryPutArray(buffer, chunk.array);
+    }
+}
+
+bool CompressedBitmap::read(BinaryReader& reader)
+{
+    chunks.clear();
+
+    uint32_t nChunks;
+    if(!reader.getSize(nChunks, 2 * sizeof(uint16_t) + sizeof(uint32_t)))
+        return false;
+
+    chunks.reserve(nChunks);
+    for(uint32_t i = 0; i < nChunks; i++)
+    {
+        uint16_t key, kind;
+        uint32_t n;
+        if(!reader.get(key) || !reader.get(kind) || !reader.get(n))
+            return false;
+        /* Keys should be strictly ascending and chunks non-empty. */
+        if((!chunks.empty() && (chunks.back().key >= key)) || (n == 0))
+            return false;
+
+        chunks.push_back(Chunk(key));
+        Chunk& chunk = chunks.back();
+        if(kind)
+        {
+            if(((int)n <= arrayMax) || (n > (1 << 16))
+                || !reader.has(bitmapWords * sizeof(uint64_t)))
+                return false;
+            reader.getArray(chunk.bitmap, bitmapWords);
+
+            int count = 0;
+            for(int j = 0; j < bitmapWords; j++)
+                count += __builtin_popcountll(chunk.bitmap[j]);
+            if(count != (int)n) return false;
+            chunk.count = count;
+        }
+        else
+        {
+            if(((int)n > arrayMax) || !reader.has(n * sizeof(uint16_t)))
+                return false;
+            reader.getArray(chunk.array, n);
+
+            for(uint32_t j = 1; j < n; j++)
+                if(chunk.array[j - 1] >= chunk.array[j]) return false;
+        }
+    }
+    return true;
+}
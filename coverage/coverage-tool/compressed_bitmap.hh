@@ -0,0 +1,85 @@
+/*
+ * Compressed set of 32-bit integers.
+ *
+ * Values are split into chunks by their upper 16 bits. Every non-empty
+ * chunk is stored in one of two ways, depended on its cardinality:
+ *
+ * - sorted array of lower 16 bits, for sparse chunks;
+ * - plain bitmap of 2^16 bits, for dense ones.
+ *
+ * So set of few values takes few bytes, and set of many values takes
+ * at most one bit per possible value. Used for postings lists of the
+ * coverage index, where values are test identificators.
+ */
+
+#ifndef COMPRESSED_BITMAP_HH
+#define COMPRESSED_BITMAP_HH
+
+#include <vector>
+#include <string>
+
+#include <stdint.h>
+
+class BinaryReader;
+
+class CompressedBitmap
+{
+public:
+    void add(uint32_t value);
+    void remove(uint32_t value);
+    bool contains(uint32_t value) const;
+
+    bool empty(void) const {return chunks.empty();}
+    /* Number of values in the set. */
+    int cardinality(void) const;
+
+    /* Add all values from 'other' set. */
+    void unite(const CompressedBitmap& other);
+
+    /* Append all values of the set to 'values' in ascending order. */
+    void getValues(std::vector<uint32_t>& values) const;
+
+    void clear(void) {chunks.clear();}
+
+    /* Append set to the payload of the binary file. */
+    void write(std::string& buffer) const;
+    /* Read set from binary file. Return false if data are malformed. */
+    bool read(BinaryReader& reader);
+private:
+    /* Maximum number of values in array chunk. */
+    static const int arrayMax = 4096;
+    static const int bitmapWords = (1 << 16) / 64;
+
+    struct Chunk
+    {
+        uint16_t key;
+        /*
+         * Either 'array' or 'bitmap' is used. In the latter case,
+         * 'count' is number of bits set.
+         */
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bitmap;
+        int count;
+
+        Chunk(uint16_t key): key(key), count(0) {}
+
+        bool isBitmap(void) const {return !bitmap.empty();}
+        int cardinality(void) const {return isBitmap() ? count : array.size();}
+
+        bool add(uint16_t low);
+        bool remove(uint16_t low);
+        bool contains(uint16_t low) const;
+        void unite(const Chunk& other);
+
+        void toBitmap(void);
+        void toArray(void);
+    };
+
+    /* Chunks sorted by key. */
+    std::vector<Chunk> chunks;
+
+    /* Return index of the chunk with given key or position for insert it. */
+    int findChunk(uint16_t key) const;
+};
+
+#endif /* COMPRESSED_BITMAP_HH */
@@ -0,0 +1,693 @@
+// compressed_stream.cpp - streams over files compressed with gzip or zstd.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "compressed_stream.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+/* Size of blocks passed from decompressing thread to the consumer. */
+static const int blockSize = 1 << 20;
+/* Number of such blocks. */
+static const int blocksNumber = 4;
+/* Size of buffers for raw(compressed) data. */
+static const int rawBufferSize = 1 << 18;
+
+/*************************** Compression kind *************************/
+Compression compressionBySignature(const char* start, const char* end)
+{
+    int size = end - start;
+    if((size >= 2) && ((unsigned char)start[0] == 0x1f)
+        && ((unsigned char)start[1] == 0x8b))
+        return compressionGzip;
+    if((size >= 4) && ((unsigned char)start[0] == 0x28)
+        && ((unsigned char)start[1] == 0xb5)
+        && ((unsigned char)start[2] == 0x2f)
+        && ((unsigned char)start[3] == 0xfd))
+        return compressionZstd;
+    return compressionNone;
+}
+
+static bool hasExtension(const char* filename, const char* extension)
+{
+    size_t len = strlen(filename), extLen = strlen(extension);
+    return (len > extLen) && (strcmp(filename + len - extLen, extension) == 0);
+}
+
+Compression compressionByName(const char* filename)
+{
+    if(hasExtension(filename, ".gz")) return compressionGzip;
+    if(hasExtension(filename, ".zst")) return compressionZstd;
+    return compressionNone;
+}
+
+bool compressionSupported(Compression compression)
+{
+    switch(compression)
+    {
+    case compressionNone:
+        return true;
+    case compressionGzip:
+#ifdef HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case compressionZstd:
+#ifdef HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+const char* compressionName(Compression compression)
+{
+    switch(compression)
+    {
+    case compressionGzip: return "gzip";
+    case compressionZstd: return "zstd";
+    default: return "none";
+    }
+}
+
+/************************* Decompressing buffer ***********************/
+DecompressingBuffer::DecompressingBuffer(): fd(-1),
+    compression(compressionNone), headPos(0), current(NULL), done(false),
+    cancelled(false), threadStarted(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+DecompressingBuffer::~DecompressingBuffer()
+{
+    close();
+
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+}
+
+bool DecompressingBuffer::open(const char* filename)
+{
+    fd = ::open(filename, O_RDONLY);
+    if(fd == -1) return false;
+
+    /* Read enough for detect compression. */
+    head.resize(4);
+    int size = 0;
+    while(size < (int)head.size())
+    {
+        ssize_t n = read(fd, &head[size], head.size() - size);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        if(n == 0) break;
+        size += n;
+    }
+    head.resize(size);
+    headPos = 0;
+
+    compression = compressionBySignature(head.data(), head.data() + size);
+
+    current = new vector<char>();
+    if(compression == compressionNone) return true;
+
+    if(!compressionSupported(compression))
+    {
+        error = string("File is compressed with ") + compressionName(compression)
+            + ", but support for it is not built in";
+        done = true;
+        return true;
+    }
+
+    for(int i = 0; i < blocksNumber; i++)
+        freeBlocks.push_back(new vector<char>());
+
+    if(pthread_create(&thread, NULL, threadFunc, this))
+    {
+        error = "Failed to create thread for decompression";
+        done = true;
+        return true;
+    }
+    threadStarted = true;
+
+    return true;
+}
+
+const char* DecompressingBuffer::close(void)
+{
+    if(threadStarted)
+    {
+        pthread_mutex_lock(&mutex);
+        cancelled = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+
+        pthread_join(thread, NULL);
+        threadStarted = false;
+    }
+
+    if(fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    delete current;
+    current = NULL;
+    for(int i = 0; i < (int)readyBlocks.size(); i++) delete readyBlocks[i];
+    readyBlocks.clear();
+    for(int i = 0; i < (int)freeBlocks.size(); i++) delete freeBlocks[i];
+    freeBlocks.clear();
+
+    setg(NULL, NULL, NULL);
+
+    return error.empty() ? NULL : error.c_str();
+}
+
+int DecompressingBuffer::readRaw(char* buffer, int size)
+{
+    if(headPos < (int)head.size())
+    {
+        int n = min(size, (int)head.size() - headPos);
+        memcpy(buffer, &head[headPos], n);
+        headPos += n;
+        return n;
+    }
+
+    while(true)
+    {
+        ssize_t n = read(fd, buffer, size);
+        if(n >= 0) return n;
+        if(errno != EINTR) return -1;
+    }
+}
+
+DecompressingBuffer::int_type DecompressingBuffer::underflow()
+{
+    if(gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if(!current) return traits_type::eof();
+
+    if(compression == compressionNone)
+    {
+        current->resize(blockSize);
+        int n = readRaw(&(*current)[0], blockSize);
+        if(n <= 0)
+        {
+            if(n < 0) error = "Failed to read file";
+            return traits_type::eof();
+        }
+        setg(&(*current)[0], &(*current)[0], &(*current)[0] + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pthread_mutex_lock(&mutex);
+    /* Return consumed block to the decompressing thread. */
+    if(!current->empty())
+    {
+        freeBlocks.push_back(current);
+        current = NULL;
+        pthread_cond_broadcast(&cond);
+    }
+    while(readyBlocks.empty() && !done)
+        pthread_cond_wait(&cond, &mutex);
+
+    if(!readyBlocks.empty())
+    {
+        if(current) delete current;
+        current = readyBlocks.front();
+        readyBlocks.pop_front();
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if(!current || current->empty())
+    {
+        /* Keep empty block, so next call doesn't wait. */
+        if(!current) current = new vector<char>();
+        setg(NULL, NULL, NULL);
+        return traits_type::eof();
+    }
+
+    setg(&(*current)[0], &(*current)[0], &(*current)[0] + current->size());
+    return traits_type::to_int_type(*gptr());
+}
+
+vector<char>* DecompressingBuffer::putBlock(vector<char>* block)
+{
+    pthread_mutex_lock(&mutex);
+    if(block)
+    {
+        readyBlocks.push_back(block);
+        pthread_cond_broadcast(&cond);
+    }
+
+    while(freeBlocks.empty() && !cancelled)
+        pthread_cond_wait(&cond, &mutex);
+
+    vector<char>* result = NULL;
+    if(!cancelled)
+    {
+        result = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if(result) result->resize(blockSize);
+    return result;
+}
+
+void DecompressingBuffer::setDone(const char* errorMessage)
+{
+    pthread_mutex_lock(&mutex);
+    if(errorMessage) error = errorMessage;
+    done = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+}
+
+void* DecompressingBuffer::threadFunc(void* arg)
+{
+    DecompressingBuffer* buffer = (DecompressingBuffer*)arg;
+
+    if(buffer->compression == compressionGzip)
+        buffer->decompressGzip();
+    else
+        buffer->decompressZstd();
+
+    return NULL;
+}
+
+#ifdef HAVE_ZLIB
+void DecompressingBuffer::decompressGzip(void)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    /* Accept gzip header. */
+    if(inflateInit2(&zs, 15 + 32) != Z_OK)
+    {
+        setDone("Failed to initialize zlib");
+        return;
+    }
+
+    vector<char> in(rawBufferSize);
+    vector<char>* block = putBlock(NULL);
+    const char* errorMessage = NULL;
+    /* Whether the last gzip member is finished. */
+    bool streamEnd = false;
+    bool inputEnd = false;
+
+    if(block)
+    {
+        zs.next_out = (Bytef*)&(*block)[0];
+        zs.avail_out = blockSize;
+    }
+
+    while(block)
+    {
+        if((zs.avail_in == 0) && !inputEnd)
+        {
+            int n = readRaw(&in[0], rawBufferSize);
+            if(n < 0)
+            {
+                errorMessage = "Failed to read file";
+                break;
+            }
+            if(n == 0) inputEnd = true;
+            zs.next_in = (Bytef*)&in[0];
+            zs.avail_in = n;
+        }
+
+        if((zs.avail_in == 0) && inputEnd)
+        {
+            if(!streamEnd) errorMessage = "Unexpected end of compressed data";
+            break;
+        }
+
+        /* Concatenated gzip members form one stream. */
+        if(streamEnd)
+        {
+            inflateReset(&zs);
+            streamEnd = false;
+        }
+
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END)
+        {
+            streamEnd = true;
+        }
+        else if((ret != Z_OK) && (ret != Z_BUF_ERROR))
+        {
+            errorMessage = zs.msg ? zs.msg : "Corrupted compressed data";
+            break;
+        }
+
+        if(zs.avail_out == 0)
+        {
+            block = putBlock(block);
+            if(!block) break;
+            zs.next_out = (Bytef*)&(*block)[0];
+            zs.avail_out = blockSize;
+        }
+    }
+
+    if(block)
+    {
+        block->resize(blockSize - zs.avail_out);
+        if(!block->empty()) block = putBlock(block);
+        if(block)
+        {
+            pthread_mutex_lock(&mutex);
+            freeBlocks.push_back(block);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+
+    inflateEnd(&zs);
+    setDone(errorMessage);
+}
+#else
+void DecompressingBuffer::decompressGzip(void) {}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+void DecompressingBuffer::decompressZstd(void)
+{
+    ZSTD_DStream* ds = ZSTD_createDStream();
+    if(!ds)
+    {
+        setDone("Failed to initialize zstd");
+        return;
+    }
+    ZSTD_initDStream(ds);
+
+    vector<char> inBuffer(rawBufferSize);
+    ZSTD_inBuffer in = {&inBuffer[0], 0, 0};
+    ZSTD_outBuffer out = {NULL, 0, 0};
+
+    vector<char>* block = putBlock(NULL);
+    if(block) out.dst = &(*block)[0], out.size = blockSize;
+
+    const char* errorMessage = NULL;
+    /* Whether last frame is finished. */
+    bool frameEnd = true;
+    bool inputEnd = false;
+
+    while(block)
+    {
+        if((in.pos == in.size) && !inputEnd)
+        {
+            int n = readRaw(&inBuffer[0], rawBufferSize);
+            if(n < 0)
+            {
+                errorMessage = "Failed to read file";
+                break;
+            }
+            if(n == 0) inputEnd = true;
+            in.size = n;
+            in.pos = 0;
+        }
+
+        if((in.pos == in.size) && inputEnd)
+        {
+            if(!frameEnd) errorMessage = "Unexpected end of compressed data";
+            break;
+        }
+
+        size_t ret = ZSTD_decompressStream(ds, &out, &in);
+        if(ZSTD_isError(ret))
+        {
+            errorMessage = ZSTD_getErrorName(ret);
+            break;
+        }
+        frameEnd = ret == 0;
+
+        if(out.pos == out.size)
+        {
+            block = putBlock(block);
+            if(!block) break;
+            out.dst = &(*block)[0];
+            out.size = blockSize;
+            out.pos = 0;
+        }
+    }
+
+    if(block)
+    {
+        block->resize(out.pos);
+        if(!block->empty()) block = putBlock(block);
+        if(block)
+        {
+            pthread_mutex_lock(&mutex);
+            freeBlocks.push_back(block);
+            pthread_mutex_unlock(&mutex);
+        }
+    }
+
+    ZSTD_freeDStream(ds);
+    setDone(errorMessage);
+}
+#else
+void DecompressingBuffer::decompressZstd(void) {}
+#endif /* HAVE_ZSTD */
+
+/************************** Compressed input **************************/
+CompressedIfstream::CompressedIfstream(const char* filename):
+    std::istream(NULL), filename(filename)
+{
+    rdbuf(&buffer);
+    if(!buffer.open(filename)) setstate(failbit);
+}
+
+void CompressedIfstream::close(void)
+{
+    const char* error = buffer.close();
+    if(error)
+    {
+        cerr << filename << ": " << error << "." << endl;
+        throw runtime_error("Failed to decompress file");
+    }
+}
+
+/************************** Compressing buffer ************************/
+CompressingBuffer::CompressingBuffer(): fd(-1), compression(compressionNone),
+    stream(NULL), failed(false)
+{
+}
+
+CompressingBuffer::~CompressingBuffer()
+{
+    close();
+}
+
+bool CompressingBuffer::open(const char* filename, Compression compression)
+{
+    if(!compressionSupported(compression)) return false;
+
+    fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd == -1) return false;
+
+    this->compression = compression;
+    failed = false;
+
+#ifdef HAVE_ZLIB
+    if(compression == compressionGzip)
+    {
+        z_stream* zs = new z_stream;
+        memset(zs, 0, sizeof(*zs));
+        /* Write gzip header. */
+        if(deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            delete zs;
+            failed = true;
+        }
+        else stream = zs;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if(compression == compressionZstd)
+    {
+        ZSTD_CStream* cs = ZSTD_createCStream();
+        if(!cs || ZSTD_isError(ZSTD_initCStream(cs, 3)))
+        {
+            if(cs) ZSTD_freeCStream(cs);
+            failed = true;
+        }
+        else stream = cs;
+    }
+#endif
+
+    inBuffer.resize(blockSize);
+    outBuffer.resize(rawBufferSize);
+    setp(&inBuffer[0], &inBuffer[0] + inBuffer.size());
+
+    return !failed;
+}
+
+bool CompressingBuffer::writeRaw(const char* data, int size)
+{
+    while(size > 0)
+    {
+        ssize_t n = write(fd, data, size);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool CompressingBuffer::compress(const char* data, int size, bool finish)
+{
+    if(compression == compressionNone) return writeRaw(data, size);
+
+#ifdef HAVE_ZLIB
+    if(compression == compressionGzip)
+    {
+        z_stream* zs = (z_stream*)stream;
+        zs->next_in = (Bytef*)data;
+        zs->avail_in = size;
+        while(true)
+        {
+            zs->next_out = (Bytef*)&outBuffer[0];
+            zs->avail_out = outBuffer.size();
+            int ret = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+                return false;
+            if(!writeRaw(&outBuffer[0], outBuffer.size() - zs->avail_out))
+                return false;
+            if(finish ? (ret == Z_STREAM_END) : (zs->avail_in == 0))
+                return true;
+        }
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if(compression == compressionZstd)
+    {
+        ZSTD_CStream* cs = (ZSTD_CStream*)stream;
+        ZSTD_inBuffer in = {data, (size_t)size, 0};
+        while(true)
+        {
+            ZSTD_outBuffer out = {&outBuffer[0], outBuffer.size(), 0};
+            size_t ret = ZSTD_compressStream2(cs, &out, &in,
+                finish ? ZSTD_e_end : ZSTD_e_continue);
+            if(ZSTD_isError(ret)) return false;
+            if(!writeRaw(&outBuffer[0], out.pos)) return false;
+            if(finish ? (ret == 0) : (in.pos == in.size)) return true;
+        }
+    }
+#endif
+    return false;
+}
+
+CompressingBuffer::int_type CompressingBuffer::overflow(int_type c)
+{
+    if(fd == -1) return traits_type::eof();
+
+    if(sync() == -1) return traits_type::eof();
+    if(!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int CompressingBuffer::sync()
+{
+    if(fd == -1) return -1;
+
+    int size = pptr() - pbase();
+    if(!failed && (size > 0) && !compress(pbase(), size, false))
+        failed = true;
+    setp(&inBuffer[0], &inBuffer[0] + inBuffer.size());
+
+    return failed ? -1 : 0;
+}
+
+bool CompressingBuffer::close(void)
+{
+    if(fd == -1) return true;
+
+    sync();
+    if(!failed && (compression != compressionNone) && !compress(NULL, 0, true))
+        failed = true;
+
+#ifdef HAVE_ZLIB
+    if(stream && (compression == compressionGzip))
+    {
+        deflateEnd((z_stream*)stream);
+        delete (z_stream*)stream;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if(stream && (compression == compressionZstd))
+        ZSTD_freeCStream((ZSTD_CStream*)stream);
+#endif
+    stream = NULL;
+
+    if(::close(fd) == -1) failed = true;
+    fd = -1;
+    setp(NULL, NULL);
+
+    return !failed;
+}
+
+/************************** Compressed output *************************/
+CompressedOfstream::CompressedOfstream(const char* filename):
+    std::ostream(NULL)
+{
+    rdbuf(&buffer);
+    if(!buffer.open(filename, compressionByName(filename))) setstate(failbit);
+}
+
+bool CompressedOfstream::close(void)
+{
+    bool result = buffer.close();
+    if(!result) setstate(failbit);
+    return result;
+}
@@ -0,0 +1,171 @@
+/*
+ * Streams over files compressed with gzip or zstd.
+ *
+ * Input file is decompressed in a separate thread, so reader of the
+ * stream(e.g., trace parser) works in parallel with decompression.
+ * Compression of the input file is detected by its content, so not
+ * compressed files are read as is.
+ *
+ * Support for every compression is built in only if corresponded
+ * library(zlib or libzstd) is found at configuration stage.
+ */
+
+#ifndef COMPRESSED_STREAM_HH
+#define COMPRESSED_STREAM_HH
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <pthread.h>
+
+enum Compression
+{
+    compressionNone,
+    compressionGzip,
+    compressionZstd
+};
+
+/* Detect compression by the first bytes of the file. */
+Compression compressionBySignature(const char* start, const char* end);
+/* Detect compression by extension of the file(".gz" or ".zst"). */
+Compression compressionByName(const char* filename);
+
+/* Whether given compression is supported. */
+bool compressionSupported(Compression compression);
+const char* compressionName(Compression compression);
+
+/* Buffer for read (possibly) compressed file. */
+class DecompressingBuffer: public std::streambuf
+{
+public:
+    DecompressingBuffer();
+    ~DecompressingBuffer();
+
+    /* Return false if file cannot be opened. */
+    bool open(const char* filename);
+
+    /*
+     * Stop decompression and close file.
+     *
+     * Return error message if data was corrupted or truncated, NULL
+     * otherwise.
+     */
+    const char* close(void);
+protected:
+    int_type underflow();
+private:
+    DecompressingBuffer(const DecompressingBuffer&);
+    DecompressingBuffer& operator=(const DecompressingBuffer&);
+
+    int fd;
+    Compression compression;
+    /* Bytes read from the file for detect its compression. */
+    std::vector<char> head;
+    int headPos;
+
+    /* Block currently read by the consumer. */
+    std::vector<char>* current;
+
+    /*
+     * Blocks passed between decompressing thread and consumer.
+     * All fields below are protected by 'mutex'.
+     */
+    std::deque<std::vector<char>*> readyBlocks;
+    std::vector<std::vector<char>*> freeBlocks;
+    /* Decompression is finished(successfully or not). */
+    bool done;
+    /* Consumer doesn't need data anymore. */
+    bool cancelled;
+    std::string error;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool threadStarted;
+
+    /* Read raw data from the file. Return number of bytes read. */
+    int readRaw(char* buffer, int size);
+
+    /*
+     * Pass filled block to the consumer and return next free one, or NULL
+     * if consumer is cancelled.
+     */
+    std::vector<char>* putBlock(std::vector<char>* block);
+    void setDone(const char* errorMessage);
+
+    void decompressGzip(void);
+    void decompressZstd(void);
+
+    static void* threadFunc(void* arg);
+};
+
+/* Input stream for (possibly) compressed file. */
+class CompressedIfstream: public std::istream
+{
+public:
+    CompressedIfstream(const char* filename);
+
+    /*
+     * Stop reading and close the file.
+     *
+     * Throw exception if compressed data was corrupted or truncated.
+     */
+    void close(void);
+private:
+    DecompressingBuffer buffer;
+    std::string filename;
+};
+
+/* Buffer for write file, compressing data if requested. */
+class CompressingBuffer: public std::streambuf
+{
+public:
+    CompressingBuffer();
+    ~CompressingBuffer();
+
+    /* Return false if file cannot be created. */
+    bool open(const char* filename, Compression compression);
+
+    /* Finish compressed data and close file. Return false on error. */
+    bool close(void);
+protected:
+    int_type overflow(int_type c);
+    int sync();
+private:
+    CompressingBuffer(const CompressingBuffer&);
+    CompressingBuffer& operator=(const CompressingBuffer&);
+
+    int fd;
+    Compression compression;
+    /* Compressor state, depends on the compression. */
+    void* stream;
+    bool failed;
+
+    std::vector<char> inBuffer;
+    std::vector<char> outBuffer;
+
+    /* Compress data in the buffer, finishing stream if requested. */
+    bool compress(const char* data, int size, bool finish);
+    bool writeRaw(const char* data, int size);
+};
+
+/*
+ * Output stream for file. Data is compressed according to the extension
+ * of the file.
+ */
+class CompressedOfstream: public std::ostream
+{
+public:
+    CompressedOfstream(const char* filename);
+
+    /* Flush data and close the file. Return false on error. */
+    bool close(void);
+private:
+    CompressingBuffer buffer;
+};
+
+#endif /* COMPRESSED_STREAM_HH */
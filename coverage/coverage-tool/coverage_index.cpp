@@ -0,0 +1,587 @@
+// coverage_index.cpp - persistent index of coverage of the tests set.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+/*
+ * Layout of the index file(header is described in 'binary_format.hh'):
+ *
+ *      uint32      number of test identificators
+ *      for every identificator:
+ *          uint32  length of the trace filename(0 for unused identificator)
+ *          char[]  trace filename
+ *          int64   size of the trace
+ *          int64   modification time of the trace, in nanoseconds
+ *          int32   position in the tests list
+ *      uint32      number of source files
+ *      for every source file:
+ *          uint32  length
+ *          char[]  filename
+ *      uint32      number of function names
+ *      for every function name:
+ *          uint32  length
+ *          char[]  name
+ *      uint32      number of covered lines
+ *      for every line:
+ *          int32   source file
+ *          int32   line
+ *          bitmap  tests covering line(see 'compressed_bitmap.cpp')
+ *      uint32      number of covered functions
+ *      for every function:
+ *          int32   source file
+ *          int32   function name
+ *          bitmap  tests covering function
+ *
+ * Lines and functions are sorted, so same index is always stored in the
+ * same way.
+ */
+
+#include "coverage_index.hh"
+#include "binary_format.hh"
+#include "file_mapping.hh"
+#include "parallel.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cstdio> /* rename */
+#include <sys/stat.h>
+#include <unistd.h> /* getpid */
+
+using namespace std;
+
+static const char indexMagic[8] = {'\x89', 'K', 'I', 'D', 'X', '\r', '\n', '\x1a'};
+static const uint32_t indexVersion = 1;
+
+/* Number of traces loaded at once when index is updated. */
+static const int loadBatch = 64;
+
+/******************************* Update *******************************/
+/* Covered items of one trace. */
+struct TraceItems
+{
+    /* Covered lines and functions for every source file in the trace. */
+    vector<string> files;
+    vector<vector<int> > lines;
+    vector<vector<string> > functions;
+
+    void load(const string& traceFile, bool mappedRead);
+    void clear(void);
+};
+
+void TraceItems::load(const string& traceFile, bool mappedRead)
+{
+    CompactTrace trace;
+    if(mappedRead)
+        trace.readMapped(traceFile.c_str());
+    else
+        trace.read(traceFile.c_str());
+
+    /*
+     * Grouping is not needed: same file in several groups produces
+     * same items twice, which is harmless.
+     */
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+    {
+        const CompactTrace::FileGroup& group = trace.fileGroups[i];
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            const CompactTrace::FileData& file = group.files[j];
+
+            vector<int> fileLines;
+            for(int k = 0; k < (int)file.lines.size(); k++)
+            {
+                if(file.lineCounters[k] > 0) fileLines.push_back(file.lines[k]);
+            }
+
+            vector<string> fileFunctions;
+            for(int k = 0; k < (int)file.functions.size(); k++)
+            {
+                if(file.functionCounters[k] > 0)
+                    fileFunctions.push_back(trace.strings[file.functions[k]]);
+            }
+
+            if(fileLines.empty() && fileFunctions.empty()) continue;
+
+            files.push_back(trace.strings[file.name]);
+            lines.push_back(vector<int>());
+            lines.back().swap(fileLines);
+            functions.push_back(vector<string>());
+            functions.back().swap(fileFunctions);
+        }
+    }
+}
+
+void TraceItems::clear(void)
+{
+    vector<string>().swap(files);
+    vector<vector<int> >().swap(lines);
+    vector<vector<string> >().swap(functions);
+}
+
+class CoverageIndex::TraceLoader: public ParallelTask
+{
+public:
+    TraceLoader(const vector<Test>& tests, const int* ids,
+        vector<TraceItems>& items, bool mappedRead):
+        tests(tests), ids(ids), items(items), mappedRead(mappedRead) {}
+
+    void run(int i, int /*thread*/)
+    {
+        items[i].load(tests[ids[i]].traceFile, mappedRead);
+    }
+private:
+    const vector<Test>& tests;
+    const int* ids;
+    vector<TraceItems>& items;
+    bool mappedRead;
+};
+
+void CoverageIndex::addItem(unordered_map<uint64_t, int>& items,
+    uint64_t key, int test)
+{
+    pair<unordered_map<uint64_t, int>::iterator, bool> result =
+        items.insert(make_pair(key, (int)postings.size()));
+    if(result.second) postings.push_back(CompressedBitmap());
+
+    postings[result.first->second].add(test);
+}
+
+/* Remove items which are not covered by any test. */
+static void dropEmptyItems(unordered_map<uint64_t, int>& items,
+    vector<CompressedBitmap>& postings)
+{
+    for(unordered_map<uint64_t, int>::iterator iter = items.begin();
+        iter != items.end();)
+    {
+        if(postings[iter->second].empty()) iter = items.erase(iter);
+        else ++iter;
+    }
+}
+
+int CoverageIndex::update(const std::vector<std::string>& traceFiles,
+    bool mappedRead, int nThreads)
+{
+    unordered_map<string, int> testIds;
+    for(int i = 0; i < (int)tests.size(); i++)
+    {
+        if(!tests[i].traceFile.empty()) testIds[tests[i].traceFile] = i;
+    }
+
+    /* Tests which remain in the index. */
+    vector<char> listed(tests.size(), 0);
+    /* Tests which should be removed from the tests sets of items. */
+    vector<int> removed;
+    /* Tests which should be loaded. */
+    vector<int> changed;
+    /* New traces with their fingerprints and positions in the list. */
+    vector<Test> added;
+
+    for(int i = 0; i < (int)traceFiles.size(); i++)
+    {
+        const string& traceFile = traceFiles[i];
+        struct stat st;
+        if(stat(traceFile.c_str(), &st) == -1)
+        {
+            cerr << traceFile << ": Failed to access trace." << endl;
+            throw runtime_error("Failed to access trace");
+        }
+
+        Test test;
+        test.traceFile = traceFile;
+        test.size = st.st_size;
+        test.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        test.order = i;
+
+        unordered_map<string, int>::const_iterator iter = testIds.find(traceFile);
+        if(iter == testIds.end())
+        {
+            added.push_back(test);
+            /* Ignore duplicates in the list. */
+            testIds[traceFile] = -1;
+            continue;
+        }
+        int id = iter->second;
+        if((id == -1) || listed[id]) continue;
+
+        listed[id] = 1;
+        if((tests[id].size != test.size) || (tests[id].mtime != test.mtime))
+        {
+            removed.push_back(id);
+            changed.push_back(id);
+        }
+        tests[id] = test;
+    }
+
+    for(int i = 0; i < (int)tests.size(); i++)
+    {
+        if(!tests[i].traceFile.empty() && !listed[i])
+        {
+            removed.push_back(i);
+            tests[i].traceFile.clear();
+            nTests--;
+        }
+    }
+
+    if(!removed.empty())
+    {
+        for(int i = 0; i < (int)postings.size(); i++)
+        {
+            if(postings[i].empty()) continue;
+            for(int j = 0; j < (int)removed.size(); j++)
+                postings[i].remove(removed[j]);
+        }
+        dropEmptyItems(lineItems, postings);
+        dropEmptyItems(functionItems, postings);
+    }
+
+    /* New tests reuse identificators of removed ones. */
+    int freeId = 0;
+    for(int i = 0; i < (int)added.size(); i++)
+    {
+        while((freeId < (int)tests.size()) && !tests[freeId].traceFile.empty())
+            freeId++;
+        if(freeId == (int)tests.size()) tests.push_back(Test());
+
+        tests[freeId] = added[i];
+        changed.push_back(freeId);
+        nTests++;
+    }
+
+    /* Load traces by batches, so only few of them are kept in memory. */
+    vector<TraceItems> items;
+    for(int start = 0; start < (int)changed.size(); start += loadBatch)
+    {
+        int n = min(loadBatch, (int)changed.size() - start);
+        items.resize(n);
+
+        TraceLoader loader(tests, &changed[start], items, mappedRead);
+        runParallel(loader, n, nThreads);
+
+        for(int i = 0; i < n; i++)
+        {
+            int test = changed[start + i];
+            TraceItems& traceItems = items[i];
+            for(int j = 0; j < (int)traceItems.files.size(); j++)
+            {
+                int file = files.intern(traceItems.files[j]);
+
+                const vector<int>& fileLines = traceItems.lines[j];
+                for(int k = 0; k < (int)fileLines.size(); k++)
+                    addItem(lineItems, itemKey(file, fileLines[k]), test);
+
+                const vector<string>& fileFunctions = traceItems.functions[j];
+                for(int k = 0; k < (int)fileFunctions.size(); k++)
+                {
+                    int name = functionNames.intern(fileFunctions[k]);
+                    addItem(functionItems, itemKey(file, name), test);
+                }
+            }
+            traceItems.clear();
+        }
+    }
+
+    return changed.size();
+}
+
+/******************************** Query *******************************/
+void CoverageIndex::matchFiles(const std::string& filename,
+    std::vector<int>& ids) const
+{
+    for(int i = 0; i < files.size(); i++)
+    {
+        const string& name = files[i];
+        if(name == filename)
+        {
+            ids.push_back(i);
+        }
+        else if((name.size() > filename.size())
+            && (name.compare(name.size() - filename.size(), filename.size(),
+                filename) == 0)
+            && (name[name.size() - filename.size() - 1] == '/'))
+        {
+            ids.push_back(i);
+        }
+    }
+    if(ids.empty()) return;
+
+    vector<char> used(files.size(), 0);
+    for(unordered_map<uint64_t, int>::const_iterator iter = lineItems.begin();
+        iter != lineItems.end(); ++iter)
+    {
+        used[iter->first >> 32] = 1;
+    }
+    for(unordered_map<uint64_t, int>::const_iterator iter = functionItems.begin();
+        iter != functionItems.end(); ++iter)
+    {
+        used[iter->first >> 32] = 1;
+    }
+
+    int n = 0;
+    for(int i = 0; i < (int)ids.size(); i++)
+    {
+        if(used[ids[i]]) ids[n++] = ids[i];
+    }
+    ids.resize(n);
+}
+
+bool CoverageIndex::queryLine(const std::string& filename, int line,
+    CompressedBitmap& result) const
+{
+    vector<int> ids;
+    matchFiles(filename, ids);
+
+    for(int i = 0; i < (int)ids.size(); i++)
+    {
+        unordered_map<uint64_t, int>::const_iterator iter =
+            lineItems.find(itemKey(ids[i], line));
+        if(iter != lineItems.end()) result.unite(postings[iter->second]);
+    }
+
+    return !ids.empty();
+}
+
+bool CoverageIndex::queryFunction(const std::string& filename,
+    const std::string& function, CompressedBitmap& result) const
+{
+    vector<int> ids;
+    matchFiles(filename, ids);
+
+    /* Function names are not interned for lookup, so search them. */
+    int name = -1;
+    for(int i = 0; i < functionNames.size(); i++)
+    {
+        if(functionNames[i] == function)
+        {
+            name = i;
+            break;
+        }
+    }
+    if(name == -1) return !ids.empty();
+
+    for(int i = 0; i < (int)ids.size(); i++)
+    {
+        unordered_map<uint64_t, int>::const_iterator iter =
+            functionItems.find(itemKey(ids[i], name));
+        if(iter != functionItems.end()) result.unite(postings[iter->second]);
+    }
+
+    return !ids.empty();
+}
+
+bool CoverageIndex::queryFile(const std::string& filename,
+    CompressedBitmap& result) const
+{
+    vector<int> ids;
+    matchFiles(filename, ids);
+    if(ids.empty()) return false;
+
+    vector<char> matched(files.size(), 0);
+    for(int i = 0; i < (int)ids.size(); i++) matched[ids[i]] = 1;
+
+    /* Every test covering some function covers some line too. */
+    for(unordered_map<uint64_t, int>::const_iterator iter = lineItems.begin();
+        iter != lineItems.end(); ++iter)
+    {
+        if(matched[iter->first >> 32]) result.unite(postings[iter->second]);
+    }
+
+    return true;
+}
+
+void CoverageIndex::getTraceFiles(const CompressedBitmap& ids,
+    std::vector<std::string>& traceFiles) const
+{
+    vector<uint32_t> values;
+    ids.getValues(values);
+
+    vector<pair<int, int> > ordered;
+    for(int i = 0; i < (int)values.size(); i++)
+    {
+        if((values[i] < tests.size()) && !tests[values[i]].traceFile.empty())
+            ordered.push_back(make_pair(tests[values[i]].order, (int)values[i]));
+    }
+    sort(ordered.begin(), ordered.end());
+
+    for(int i = 0; i < (int)ordered.size(); i++)
+        traceFiles.push_back(tests[ordered[i].second].traceFile);
+}
+
+/****************************** Binary I/O ****************************/
+/*
+ * Report about error in index and throw exception.
+ *
+ * 'msg' is used only for insert into stream.
+ */
+#define index_error(msg) do { \
+    cerr << filename << ": " << msg << endl; \
+    throw runtime_error("Invalid coverage index"); \
+} while(0)
+
+/* Items of one kind in order of their keys. */
+static void sortedItems(const unordered_map<uint64_t, int>& items,
+    vector<pair<uint64_t, int> >& result)
+{
+    result.assign(items.begin(), items.end());
+    sort(result.begin(), result.end());
+}
+
+static void putStrings(string& buffer, const StringTable& strings)
+{
+    binaryPutValue(buffer, (uint32_t)strings.size());
+    for(int i = 0; i < strings.size(); i++)
+        binaryPutString(buffer, strings[i]);
+}
+
+static bool getStrings(BinaryReader& reader, StringTable& strings)
+{
+    uint32_t n;
+    if(!reader.getSize(n, sizeof(uint32_t))) return false;
+
+    strings.reserve(n);
+    string str;
+    for(uint32_t i = 0; i < n; i++)
+    {
+        if(!reader.getString(str) || (strings.intern(str) != (int)i))
+            return false;
+    }
+    return true;
+}
+
+void CoverageIndex::write(const char* filename) const
+{
+    string payload;
+
+    binaryPutValue(payload, (uint32_t)tests.size());
+    for(int i = 0; i < (int)tests.size(); i++)
+    {
+        const Test& test = tests[i];
+        binaryPutString(payload, test.traceFile);
+        binaryPutValue(payload, test.size);
+        binaryPutValue(payload, test.mtime);
+        binaryPutValue(payload, (int32_t)test.order);
+    }
+
+    putStrings(payload, files);
+    putStrings(payload, functionNames);
+
+    const unordered_map<uint64_t, int>* itemsOfKind[2] = {&lineItems, &functionItems};
+    for(int kind = 0; kind < 2; kind++)
+    {
+        vector<pair<uint64_t, int> > items;
+        sortedItems(*itemsOfKind[kind], items);
+
+        binaryPutValue(payload, (uint32_t)items.size());
+        for(int i = 0; i < (int)items.size(); i++)
+        {
+            binaryPutValue(payload, (int32_t)(items[i].first >> 32));
+            binaryPutValue(payload, (int32_t)(items[i].first & 0xffffffff));
+            postings[items[i].second].write(payload);
+        }
+    }
+
+    BinaryHeader header = binaryMakeHeader(indexMagic, indexVersion, payload);
+
+    ostringstream tmpFilename;
+    tmpFilename << filename << ".tmp" << getpid();
+
+    ofstream os(tmpFilename.str().c_str(), ios_base::out | ios_base::binary);
+    os.write((const char*)&header, sizeof(header));
+    os.write(payload.data(), payload.size());
+    os.close();
+
+    if(!os || (rename(tmpFilename.str().c_str(), filename) == -1))
+    {
+        remove(tmpFilename.str().c_str());
+        cerr << filename << ": Failed to write coverage index." << endl;
+        throw runtime_error("Failed to write coverage index");
+    }
+}
+
+void CoverageIndex::read(const char* filename)
+{
+    FileMapping mapping;
+    if(!mapping.map(filename))
+        index_error("Failed to open coverage index.");
+
+    const char* start = mapping.begin();
+    const char* end = mapping.end();
+
+    const char* payload;
+    const char* error = binaryCheckHeader(start, end, indexMagic,
+        indexVersion, payload);
+    if(error)
+        index_error("Not a valid coverage index: " << error << '.');
+
+    BinaryReader reader(payload, end);
+
+    uint32_t nIds;
+    if(!reader.getSize(nIds, sizeof(uint32_t) + 2 * sizeof(int64_t) + sizeof(int32_t)))
+        index_error("Coverage index is corrupted: tests.");
+
+    tests.resize(nIds);
+    nTests = 0;
+    for(uint32_t i = 0; i < nIds; i++)
+    {
+        Test& test = tests[i];
+        int32_t order;
+        if(!reader.getString(test.traceFile) || !reader.get(test.size)
+            || !reader.get(test.mtime) || !reader.get(order))
+            index_error("Coverage index is corrupted: tests.");
+        test.order = order;
+        if(!test.traceFile.empty()) nTests++;
+    }
+
+    if(!getStrings(reader, files) || !getStrings(reader, functionNames))
+        index_error("Coverage index is corrupted: string tables.");
+
+    unordered_map<uint64_t, int>* itemsOfKind[2] = {&lineItems, &functionItems};
+    /* Upper bounds for line numbers and function names. */
+    int nNames[2] = {0x7fffffff, functionNames.size()};
+    for(int kind = 0; kind < 2; kind++)
+    {
+        unordered_map<uint64_t, int>& items = *itemsOfKind[kind];
+        uint32_t n;
+        if(!reader.getSize(n, 3 * sizeof(int32_t)))
+            index_error("Coverage index is corrupted: items.");
+
+        items.reserve(n);
+        for(uint32_t i = 0; i < n; i++)
+        {
+            int32_t file, value;
+            if(!reader.get(file) || !reader.get(value)
+                || (file < 0) || (file >= files.size())
+                || (value < 0) || (value >= nNames[kind]))
+                index_error("Coverage index is corrupted: items.");
+
+            postings.push_back(CompressedBitmap());
+            if(!postings.back().read(reader))
+                index_error("Coverage index is corrupted: tests of the item.");
+
+            items[itemKey(file, value)] = postings.size() - 1;
+        }
+    }
+
+    if(!reader.atEnd())
+        index_error("Coverage index is corrupted: garbage at the end.");
+}
@@ -0,0 +1,123 @@
+/*
+ * Persistent index of coverage of the tests set.
+ *
+ * For every covered line and function the index keeps set of tests
+ * covering it. So question "which tests cover this line?" is answered
+ * without loading traces.
+ *
+ * Index remembers size and modification time of every trace. When index
+ * is updated for new list of tests, only traces which are new or changed
+ * since previous update are loaded.
+ */
+
+#ifndef COVERAGE_INDEX_HH
+#define COVERAGE_INDEX_HH
+
+#include "compact_trace.hh"
+#include "compressed_bitmap.hh"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include <stdint.h>
+
+class CoverageIndex
+{
+public:
+    CoverageIndex(): nTests(0) {}
+
+    /* Load index from file. Throw exception on error. */
+    void read(const char* filename);
+    /*
+     * Store index into file. File is replaced atomically, so concurrent
+     * readers see either old or new index.
+     */
+    void write(const char* filename) const;
+
+    /*
+     * Make index correspond to given list of traces.
+     *
+     * Traces which are new or changed since previous update are loaded,
+     * tests for traces not in the list are removed. Traces are loaded
+     * in 'nThreads' threads; if 'mappedRead' is true, 'TraceMmapParser'
+     * is used.
+     *
+     * Return number of traces loaded.
+     */
+    int update(const std::vector<std::string>& traceFiles, bool mappedRead,
+        int nThreads);
+
+    /*
+     * Add to 'result' identificators of tests covering given line or
+     * function in given source file, or anything in this file.
+     *
+     * Source file is matched either exactly or as a suffix of the stored
+     * filename after '/'. So "lib/list.c" matches "/src/lib/list.c".
+     *
+     * Return false if no source file matches.
+     */
+    bool queryLine(const std::string& filename, int line,
+        CompressedBitmap& result) const;
+    bool queryFunction(const std::string& filename,
+        const std::string& function, CompressedBitmap& result) const;
+    bool queryFile(const std::string& filename, CompressedBitmap& result) const;
+
+    /* Return traces for tests in 'ids' in order of the tests list. */
+    void getTraceFiles(const CompressedBitmap& ids,
+        std::vector<std::string>& traceFiles) const;
+
+    /* Statistic. */
+    int testsNumber(void) const {return nTests;}
+    int filesNumber(void) const {return files.size();}
+    int linesNumber(void) const {return lineItems.size();}
+    int functionsNumber(void) const {return functionItems.size();}
+private:
+    /* Test in the index. Identificator of the test is its index. */
+    struct Test
+    {
+        /* Empty for unused identificator. */
+        std::string traceFile;
+        /* Fingerprint of the trace file. */
+        int64_t size;
+        int64_t mtime;
+        /* Position in the tests list of last update. */
+        int order;
+    };
+
+    std::vector<Test> tests;
+    int nTests;
+
+    /* Names of the source files and of the functions. */
+    StringTable files;
+    StringTable functionNames;
+
+    /*
+     * Covered items(pairs of file and line or file and function name)
+     * and indices of their tests sets in 'postings'.
+     */
+    std::unordered_map<uint64_t, int> lineItems;
+    std::unordered_map<uint64_t, int> functionItems;
+    std::vector<CompressedBitmap> postings;
+
+    static uint64_t itemKey(int file, int value)
+    {
+        return ((uint64_t)(uint32_t)file << 32) | (uint32_t)value;
+    }
+
+    /* Add test to the tests set of the item. */
+    void addItem(std::unordered_map<uint64_t, int>& items, uint64_t key,
+        int test);
+
+    /*
+     * Identificators of files matched with given filename.
+     *
+     * Files which items have been dropped by update() remain in the
+     * table, but are not matched.
+     */
+    void matchFiles(const std::string& filename, std::vector<int>& ids) const;
+
+    class TraceLoader;
+};
+
+#endif /* COVERAGE_INDEX_HH */
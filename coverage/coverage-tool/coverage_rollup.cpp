@@ -0,0 +1,228 @@
+// coverage_rollup.cpp - hierarchical coverage statistic of the trace.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "coverage_rollup.hh"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+class CoverageRollup::Builder
+{
+public:
+    Builder(CoverageRollup& rollup): nodes(rollup.nodes) {}
+
+    void build(const CompactTrace& trace);
+private:
+    vector<Node>& nodes;
+
+    /* Directories, files and functions by their keys. */
+    unordered_map<string, int> directories;
+    unordered_map<string, int> files;
+    unordered_map<string, int> functions;
+
+    /* Current file and path from the root to it. */
+    int currentFile;
+    vector<int> currentPath;
+
+    /* Return node for given key, adding it to 'parent' if needed. */
+    int getNode(unordered_map<string, int>& nodesMap, const string& key,
+        int parent, NodeKind kind, const string& name, int line = -1);
+
+    /* Find file node and fill 'currentPath' for it. */
+    void enterFile(const string& filename);
+
+    void addFile(const CompactTrace& trace, const CompactTrace::FileData& file);
+
+    /* Add statistic to the current file and all its directories. */
+    void addTotals(const CoverageTotals& totals);
+};
+
+int CoverageRollup::Builder::getNode(unordered_map<string, int>& nodesMap,
+    const string& key, int parent, NodeKind kind, const string& name, int line)
+{
+    pair<unordered_map<string, int>::iterator, bool> inserted =
+        nodesMap.insert(make_pair(key, (int)nodes.size()));
+    if(!inserted.second) return inserted.first->second;
+
+    nodes.push_back(Node(kind, name, line));
+    nodes[parent].children.push_back(inserted.first->second);
+    return inserted.first->second;
+}
+
+void CoverageRollup::Builder::enterFile(const string& filename)
+{
+    const string& rootName = nodes[0].name;
+
+    currentPath.clear();
+    currentPath.push_back(0);
+
+    /* Every directory below the root is a node. */
+    int parent = 0;
+    for(size_t pos = filename.find('/', rootName.size() + 1);
+        pos != string::npos;
+        pos = filename.find('/', pos + 1))
+    {
+        string dirname = filename.substr(0, pos);
+        parent = getNode(directories, dirname, parent, directoryNode, dirname);
+        currentPath.push_back(parent);
+    }
+
+    currentFile = getNode(files, filename, parent, fileNode, filename);
+    currentPath.push_back(currentFile);
+}
+
+void CoverageRollup::Builder::addTotals(const CoverageTotals& totals)
+{
+    for(int i = 0; i < (int)currentPath.size(); i++)
+        nodes[currentPath[i]].totals.add(totals);
+}
+
+/* Order functions with known start lines by these lines. */
+struct FunctionLineLess
+{
+    FunctionLineLess(const vector<int>& lines): lines(lines) {}
+
+    bool operator()(int i, int j) const
+    {
+        return lines[i] < lines[j];
+    }
+private:
+    const vector<int>& lines;
+};
+
+void CoverageRollup::Builder::addFile(const CompactTrace& trace,
+    const CompactTrace::FileData& file)
+{
+    const string& filename = trace.strings[file.name];
+    enterFile(filename);
+
+    CoverageTotals fileTotals;
+    file.addTotals(fileTotals);
+    addTotals(fileTotals);
+
+    /* Function nodes and their order by start lines. */
+    int n = file.functions.size();
+    vector<int> functionNodes(n);
+    vector<int> order;
+    order.reserve(n);
+    for(int i = 0; i < n; i++)
+    {
+        int line = file.functionLines[i];
+        const string& name = trace.strings[file.functions[i]];
+        string key = filename;
+        key += '\0';
+        key += name;
+        functionNodes[i] = getNode(functions, key, currentFile, functionNode,
+            name, line);
+
+        CoverageTotals& totals = nodes[functionNodes[i]].totals;
+        totals.functions++;
+        if(file.functionCounters[i] > 0) totals.functionsHit++;
+
+        if(line >= 0) order.push_back(i);
+    }
+    stable_sort(order.begin(), order.end(), FunctionLineLess(file.functionLines));
+
+    /*
+     * Lines and branches are sorted, so owning function is found by
+     * moving along 'order'.
+     */
+    int current = -1;
+    for(int i = 0; i < (int)file.lines.size(); i++)
+    {
+        int line = file.lines[i];
+        while((current + 1 < (int)order.size())
+            && (file.functionLines[order[current + 1]] <= line))
+            current++;
+        if(current < 0) continue;
+
+        CoverageTotals& totals = nodes[functionNodes[order[current]]].totals;
+        totals.lines++;
+        if(file.lineCounters[i] > 0) totals.linesHit++;
+    }
+
+    current = -1;
+    for(int i = 0; i < (int)file.branches.size(); i++)
+    {
+        int line = file.branches[i].line;
+        while((current + 1 < (int)order.size())
+            && (file.functionLines[order[current + 1]] <= line))
+            current++;
+        if(current < 0) continue;
+
+        CoverageTotals& totals = nodes[functionNodes[order[current]]].totals;
+        totals.branches++;
+        if(file.branchCounters[i] > 0) totals.branchesHit++;
+    }
+}
+
+void CoverageRollup::Builder::build(const CompactTrace& trace)
+{
+    /* Root is the directory of common prefix of all files. */
+    string prefix = trace.commonSourcePrefix();
+    size_t slash = prefix.rfind('/');
+    prefix.resize(slash == string::npos ? 0 : slash);
+
+    nodes.clear();
+    nodes.push_back(Node(directoryNode, prefix));
+
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+    {
+        const vector<CompactTrace::FileData>& groupFiles = trace.fileGroups[i].files;
+        for(int j = 0; j < (int)groupFiles.size(); j++)
+            addFile(trace, groupFiles[j]);
+    }
+}
+
+void CoverageRollup::build(const CompactTrace& trace)
+{
+    Builder builder(*this);
+    builder.build(trace);
+}
+
+/* Order of children in the sorted rollup. */
+struct NodeLess
+{
+    NodeLess(const vector<CoverageRollup::Node>& nodes): nodes(nodes) {}
+
+    bool operator()(int i, int j) const
+    {
+        int uncovered1 = nodes[i].linesUncovered();
+        int uncovered2 = nodes[j].linesUncovered();
+        if(uncovered1 != uncovered2) return uncovered1 > uncovered2;
+        if(nodes[i].name != nodes[j].name) return nodes[i].name < nodes[j].name;
+        return nodes[i].line < nodes[j].line;
+    }
+private:
+    const vector<CoverageRollup::Node>& nodes;
+};
+
+void CoverageRollup::sort(void)
+{
+    for(int i = 0; i < (int)nodes.size(); i++)
+    {
+        vector<int>& children = nodes[i].children;
+        std::sort(children.begin(), children.end(), NodeLess(nodes));
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Hierarchical coverage statistic of the trace.
+ *
+ * Statistic is collected for every directory, source file and function
+ * in one pass over the trace. Directories form a tree according to the
+ * paths of the source files; files are children of their directories
+ * and functions are children of their files.
+ *
+ * Lines and branches of the file are attributed to the function with
+ * nearest start line before them. Lines before the first function of the
+ * file and functions with unknown start line are accounted only in the
+ * file itself.
+ */
+
+#ifndef COVERAGE_ROLLUP_HH
+#define COVERAGE_ROLLUP_HH
+
+#include "compact_trace.hh"
+
+#include <string>
+#include <vector>
+
+class CoverageRollup
+{
+public:
+    enum NodeKind
+    {
+        directoryNode,
+        fileNode,
+        functionNode
+    };
+
+    struct Node
+    {
+        NodeKind kind;
+        /*
+         * Full path for directories and files, name of the function
+         * for functions.
+         */
+        std::string name;
+        /* Start line of the function, -1 for other nodes. */
+        int line;
+
+        CoverageTotals totals;
+
+        /* Indices of children in 'nodes'. */
+        std::vector<int> children;
+
+        Node(NodeKind kind, const std::string& name, int line = -1):
+            kind(kind), name(name), line(line) {}
+
+        int linesUncovered(void) const {return totals.lines - totals.linesHit;}
+    };
+
+    /*
+     * All nodes. First node is the root: directory which is common for
+     * all source files in the trace.
+     */
+    std::vector<Node> nodes;
+
+    /*
+     * Collect statistic for the trace.
+     *
+     * As for 'CompactTrace::totals()', statistic for files with same
+     * names in different groups is summed, so 'groupFiles()' should
+     * usually be called for the trace before.
+     */
+    void build(const CompactTrace& trace);
+
+    /*
+     * Sort children of every node by number of uncovered lines
+     * (descending), then by name.
+     */
+    void sort(void);
+
+    const Node& root(void) const {return nodes[0];}
+private:
+    class Builder;
+};
+
+#endif /* COVERAGE_ROLLUP_HH */
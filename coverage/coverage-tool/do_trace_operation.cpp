@@ -1,4 +1,7 @@
 #include "do_trace_operation.hh"
+#include "parallel.hh"
+
+#include <algorithm>
 #include <cassert>
 
 using namespace std;
@@ -278,3 +281,567 @@ void doTraceOperation(TraceOperation& op,
     
     p.perform();
 }
+
+/* 
+ * Same as for_each_vector(), but for sorted arrays.
+ * 
+ * sizes[i] is number of elements in i-th array(0 for absent array).
+ * 
+ * Keys are compared using
+ * 
+ * cmp(int i, int pos_i, int j, int pos_j)
+ * 
+ * which compares pos_i-th key in i-th array with pos_j-th key in j-th
+ * array and return negative, zero or positive value, like strcmp().
+ * 
+ * Function is called as
+ * 
+ * f(int first, const vector<int>& positions, const vector<bool>& existence)
+ * 
+ * where existence[i] = false means that i-th array has no element for
+ * current key and positions[i] shouldn't be used. 'first' is the first
+ * array which has element for current key.
+ */
+template<class Compare, class Function>
+void for_each_sorted(const vector<int>& sizes, Compare cmp, Function f)
+{
+    int n = (int)sizes.size();
+    
+    vector<int> positions(n, 0);
+    vector<bool> existence(n);
+    
+    while(1)
+    {
+        /* Look for minimal key and fill existence array. */
+        int first = -1;
+        for(int i = 0; i < n; i++)
+        {
+            if(positions[i] >= sizes[i])
+            {
+                existence[i] = false;
+                continue;
+            }
+            
+            int c = (first == -1) ? -1 : cmp(i, positions[i], first, positions[first]);
+            if(c < 0)
+            {
+                /* New minimal key found. */
+                for(int j = first; j >= 0 && j < i; j++)
+                    existence[j] = false;
+                first = i;
+                existence[i] = true;
+            }
+            else
+            {
+                existence[i] = (c == 0);
+            }
+        }
+        
+        if(first == -1) break;
+        
+        f(first, positions, existence);
+        
+        for(int i = 0; i < n; i++)
+        {
+            if(existence[i]) positions[i]++;
+        }
+    }
+}
+
+/* Compare integer keys. */
+template<class T>
+static inline int compareKeys(const T& a, const T& b)
+{
+    return (a < b) ? -1 : ((b < a) ? 1 : 0);
+}
+
+/* Compare groups of different traces by identificators. */
+class GroupCompare
+{
+public:
+    GroupCompare(const vector<CompactTrace>& traces): traces(traces) {}
+    int operator()(int i, int pos_i, int j, int pos_j) const
+    {
+        const CompactTrace::FileGroup& g_i = traces[i].fileGroups[pos_i];
+        const CompactTrace::FileGroup& g_j = traces[j].fileGroups[pos_j];
+        
+        int c = traces[i].strings[g_i.filename].compare(
+            traces[j].strings[g_j.filename]);
+        if(c) return c;
+        return traces[i].strings[g_i.testName].compare(
+            traces[j].strings[g_j.testName]);
+    }
+private:
+    const vector<CompactTrace>& traces;
+};
+
+/* 
+ * Collect groups with same identificators in all traces.
+ * 
+ * Fill 'groups' with index of corresponded group in each trace(or -1),
+ * n(number of traces) elements per group identificator.
+ */
+class GroupsCollector
+{
+public:
+    GroupsCollector(vector<int>& groups): groups(groups) {}
+    
+    void collect(const vector<CompactTrace>& traces)
+    {
+        int n = traces.size();
+        vector<int> sizes(n);
+        for(int i = 0; i < n; i++)
+            sizes[i] = traces[i].fileGroups.size();
+        
+        groups.clear();
+        for_each_sorted(sizes, GroupCompare(traces), *this);
+    }
+    
+    void operator()(int /*first*/, const vector<int>& positions,
+        const vector<bool>& existence)
+    {
+        for(int i = 0; i < (int)positions.size(); i++)
+            groups.push_back(existence[i] ? positions[i] : -1);
+    }
+private:
+    vector<int>& groups;
+};
+
+void TraceOperationAdapter::apply(
+    counter_t (TraceOperation::*method)(const std::vector<counter_t>&),
+    const counter_t* const* operands, int n, int count, counter_t* result)
+{
+    objectOperands.resize(n);
+    for(int k = 0; k < count; k++)
+    {
+        for(int i = 0; i < n; i++) objectOperands[i] = operands[i][k];
+        result[k] = (op->*method)(objectOperands);
+    }
+}
+
+void TraceOperationAdapter::lineOperation(const counter_t* const* operands,
+    int n, int count, counter_t* result)
+{
+    apply(&TraceOperation::lineOperation, operands, n, count, result);
+}
+
+void TraceOperationAdapter::functionOperation(const counter_t* const* operands,
+    int n, int count, counter_t* result)
+{
+    apply(&TraceOperation::functionOperation, operands, n, count, result);
+}
+
+void TraceOperationAdapter::branchOperation(const counter_t* const* operands,
+    int n, int count, counter_t* result)
+{
+    apply(&TraceOperation::branchOperation, operands, n, count, result);
+}
+
+/* 
+ * Perform operation on groups with same identificator, appending
+ * resulted group to the resulted trace.
+ */
+class DoCompactTraceOperation
+{
+public:
+    DoCompactTraceOperation(TraceOperationBatch& op,
+        const std::vector<CompactTrace>& traceOperands, CompactTrace& result):
+        op(op),
+        
+        traces(traceOperands),
+        result(result),
+        
+        n(traceOperands.size()),
+        
+        groups(n),
+        files(n),
+        columns(n),
+        columnPointers(n)
+    {
+    }
+    
+    /* 
+     * Process one group. 'groupIndices' has n elements, see
+     * GroupsCollector.
+     */
+    void perform(const int* groupIndices)
+    {
+        int first = -1;
+        for(int i = 0; i < n; i++)
+        {
+            groups[i] = (groupIndices[i] != -1) ?
+                &traces[i].fileGroups[groupIndices[i]] : NULL;
+            if((first == -1) && groups[i]) first = i;
+        }
+        assert(first != -1);
+        
+        const CompactTrace& trace = traces[first];
+        const CompactTrace::FileGroup& group = *groups[first];
+        
+        /* Currently new group is created in any case. */
+        result.fileGroups.push_back(CompactTrace::FileGroup(
+            result.strings.intern(trace.strings[group.testName]),
+            result.strings.intern(trace.strings[group.filename])));
+        currentFileGroup = &result.fileGroups.back();
+        
+        vector<int> sizes(n);
+        for(int i = 0; i < n; i++)
+        {
+            sizes[i] = groups[i] ? groups[i]->files.size() : 0;
+        }
+        
+        for_each_sorted(sizes, FileCompare(*this), Visitor<&DoCompactTraceOperation::onFile>(*this));
+    }
+
+private:
+    typedef TraceOperationBatch::counter_t counter_t;
+    
+    /* Call given method of the object for every key. */
+    template<void (DoCompactTraceOperation::*method)(int,
+        const vector<int>&, const vector<bool>&)>
+    struct Visitor
+    {
+        Visitor(DoCompactTraceOperation& p): p(p) {}
+        void operator()(int first, const vector<int>& positions,
+            const vector<bool>& existence)
+        {
+            (p.*method)(first, positions, existence);
+        }
+        DoCompactTraceOperation& p;
+    };
+    
+    struct FileCompare
+    {
+        FileCompare(const DoCompactTraceOperation& p): p(p) {}
+        int operator()(int i, int pos_i, int j, int pos_j) const
+        {
+            return p.traces[i].strings[p.groups[i]->files[pos_i].name].compare(
+                p.traces[j].strings[p.groups[j]->files[pos_j].name]);
+        }
+        const DoCompactTraceOperation& p;
+    };
+
+    struct FunctionCompare
+    {
+        FunctionCompare(const DoCompactTraceOperation& p): p(p) {}
+        int operator()(int i, int pos_i, int j, int pos_j) const
+        {
+            return p.traces[i].strings[p.files[i]->functions[pos_i]].compare(
+                p.traces[j].strings[p.files[j]->functions[pos_j]]);
+        }
+        const DoCompactTraceOperation& p;
+    };
+
+    struct LineCompare
+    {
+        LineCompare(const DoCompactTraceOperation& p): p(p) {}
+        int operator()(int i, int pos_i, int j, int pos_j) const
+        {
+            return compareKeys(p.files[i]->lines[pos_i], p.files[j]->lines[pos_j]);
+        }
+        const DoCompactTraceOperation& p;
+    };
+
+    struct BranchCompare
+    {
+        BranchCompare(const DoCompactTraceOperation& p): p(p) {}
+        int operator()(int i, int pos_i, int j, int pos_j) const
+        {
+            return compareKeys(p.files[i]->branches[pos_i], p.files[j]->branches[pos_j]);
+        }
+        const DoCompactTraceOperation& p;
+    };
+    
+    void onFile(int first, const vector<int>& positions,
+        const vector<bool>& existence)
+    {
+        const CompactTrace::FileData& file = groups[first]->files[positions[first]];
+        
+        /* Currently new file is created in any case. */
+        currentFileGroup->files.push_back(CompactTrace::FileData(
+            result.strings.intern(traces[first].strings[file.name])));
+        currentFile = &currentFileGroup->files.back();
+        
+        vector<int> functionsSizes(n), linesSizes(n), branchesSizes(n);
+        for(int i = 0; i < n; i++)
+        {
+            files[i] = existence[i] ? &groups[i]->files[positions[i]] : NULL;
+            functionsSizes[i] = existence[i] ? files[i]->functions.size() : 0;
+            linesSizes[i] = existence[i] ? files[i]->lines.size() : 0;
+            branchesSizes[i] = existence[i] ? files[i]->branches.size() : 0;
+        }
+        
+        processFunctions(functionsSizes);
+        processLines(linesSizes);
+        processBranches(branchesSizes);
+    }
+    
+    void processFunctions(const vector<int>& sizes)
+    {
+        clearColumns();
+        for_each_sorted(sizes, FunctionCompare(*this),
+            Visitor<&DoCompactTraceOperation::onFunction>(*this));
+        
+        int count = useColumns();
+        callOperation(&TraceOperationBatch::functionOperation, count);
+        for(int k = 0; k < count; k++)
+        {
+            if(results[k] < 0) continue;
+            
+            const CompactTrace::FileData& file = *files[sources[k].first];
+            int pos = sources[k].second;
+            
+            currentFile->functions.push_back(result.strings.intern(
+                traces[sources[k].first].strings[file.functions[pos]]));
+            currentFile->functionLines.push_back(file.functionLines[pos]);
+            currentFile->functionCounters.push_back(results[k]);
+        }
+    }
+    
+    void processLines(const vector<int>& sizes)
+    {
+        clearColumns();
+        lineKeys.clear();
+        /* 
+         * Usually same file contains same lines in all traces. Counters
+         * needn't to be merged in that case.
+         */
+        int count;
+        if(useSameLines())
+        {
+            count = lineKeys.size();
+        }
+        else
+        {
+            for_each_sorted(sizes, LineCompare(*this),
+                Visitor<&DoCompactTraceOperation::onLine>(*this));
+            count = useColumns();
+        }
+        
+        callOperation(&TraceOperationBatch::lineOperation, count);
+        currentFile->lines.reserve(count);
+        currentFile->lineCounters.reserve(count);
+        for(int k = 0; k < count; k++)
+        {
+            if(results[k] < 0) continue;
+            
+            currentFile->lines.push_back(lineKeys[k]);
+            currentFile->lineCounters.push_back(results[k]);
+        }
+    }
+    
+    void processBranches(const vector<int>& sizes)
+    {
+        clearColumns();
+        branchKeys.clear();
+        for_each_sorted(sizes, BranchCompare(*this),
+            Visitor<&DoCompactTraceOperation::onBranch>(*this));
+        
+        int count = useColumns();
+        callOperation(&TraceOperationBatch::branchOperation, count);
+        for(int k = 0; k < count; k++)
+        {
+            if(results[k] == -1) continue;
+            
+            currentFile->branches.push_back(branchKeys[k]);
+            currentFile->branchCounters.push_back(results[k] != -2 ? results[k] : -1);
+        }
+    }
+    
+    void clearColumns(void)
+    {
+        for(int i = 0; i < n; i++) columns[i].clear();
+        sources.clear();
+    }
+    
+    /* 
+     * If all traces have same lines in the current file, use their
+     * counters as columns directly.
+     */
+    bool useSameLines(void)
+    {
+        const CompactTrace::FileData* file0 = files[0];
+        if(!file0) return false;
+        for(int i = 1; i < n; i++)
+        {
+            if(!files[i] || (files[i]->lines != file0->lines)) return false;
+        }
+        
+        for(int i = 0; i < n; i++)
+            columnPointers[i] = files[i]->lineCounters.data();
+        lineKeys.assign(file0->lines.begin(), file0->lines.end());
+        
+        return true;
+    }
+    
+    /* Use collected columns as operands. Return number of objects. */
+    int useColumns(void)
+    {
+        for(int i = 0; i < n; i++) columnPointers[i] = columns[i].data();
+        return columns[0].size();
+    }
+    
+    /* Call batch operation for 'count' objects. */
+    void callOperation(void (TraceOperationBatch::*method)(
+        const counter_t* const*, int, int, counter_t*), int count)
+    {
+        if(count == 0) return;
+        
+        results.resize(count);
+        (op.*method)(columnPointers.data(), n, count, results.data());
+    }
+    
+    /* Append counters of the current object to the columns. */
+    void collect(vector<counter_t> CompactTrace::FileData::* counters,
+        const vector<int>& positions, const vector<bool>& existence)
+    {
+        for(int i = 0; i < n; i++)
+        {
+            columns[i].push_back(existence[i] ?
+                (files[i]->*counters)[positions[i]] : -1);
+        }
+    }
+    
+    void onFunction(int first, const vector<int>& positions,
+        const vector<bool>& existence)
+    {
+        collect(&CompactTrace::FileData::functionCounters,
+            positions, existence);
+        sources.push_back(make_pair(first, positions[first]));
+    }
+    
+    void onLine(int first, const vector<int>& positions,
+        const vector<bool>& existence)
+    {
+        collect(&CompactTrace::FileData::lineCounters,
+            positions, existence);
+        lineKeys.push_back(files[first]->lines[positions[first]]);
+    }
+    
+    void onBranch(int first, const vector<int>& positions,
+        const vector<bool>& existence)
+    {
+        for(int i = 0; i < n; i++)
+        {
+            if(existence[i])
+            {
+                counter_t counter = files[i]->branchCounters[positions[i]];
+                columns[i].push_back(counter != -1 ? counter : -2);
+            }
+            else
+            {
+                columns[i].push_back(-1);
+            }
+        }
+        branchKeys.push_back(files[first]->branches[positions[first]]);
+    }
+
+    TraceOperationBatch& op;
+    const std::vector<CompactTrace>& traces;
+    CompactTrace& result;
+    
+    int n;
+    
+    /* Current group and file in every operand(NULL if absent). */
+    vector<const CompactTrace::FileGroup*> groups;
+    vector<const CompactTrace::FileData*> files;
+    
+    /* 
+     * Counters of objects of one kind in the current file, one column
+     * per operand, and counters produced by the operation.
+     */
+    vector<vector<counter_t> > columns;
+    vector<const counter_t*> columnPointers;
+    vector<counter_t> results;
+    /* For every function: operand where it is found first and position in it. */
+    vector<pair<int, int> > sources;
+    /* Keys of lines and branches. */
+    vector<int> lineKeys;
+    vector<CompactTrace::BranchID> branchKeys;
+    
+    CompactTrace::FileGroup* currentFileGroup;
+    CompactTrace::FileData* currentFile;
+};
+
+void doTraceOperation(TraceOperationBatch& op,
+    const std::vector<CompactTrace>& operands, CompactTrace& result)
+{
+    vector<TraceOperationBatch*> ops(1, &op);
+    doTraceOperation(ops, operands, result);
+}
+
+void doTraceOperation(TraceOperation& op,
+    const std::vector<CompactTrace>& operands, CompactTrace& result)
+{
+    TraceOperationAdapter adapter(&op);
+    doTraceOperation(adapter, operands, result);
+}
+
+/* 
+ * Number of parts per thread, into which groups are divided for
+ * parallel processing. Several parts per thread make load balanced
+ * even when groups differ in size a lot.
+ */
+static const int partsPerThread = 8;
+
+/* Perform operation on the part of groups into the separate trace. */
+class DoCompactTraceOperationPart: public ParallelTask
+{
+public:
+    DoCompactTraceOperationPart(const vector<TraceOperationBatch*>& ops,
+        const vector<CompactTrace>& operands, const vector<int>& groups,
+        vector<CompactTrace>& results):
+        ops(ops), operands(operands), groups(groups), results(results) {}
+    
+    void run(int part, int thread)
+    {
+        int n = operands.size();
+        int nGroups = groups.size() / n;
+        int nParts = results.size();
+        
+        int from = (long long)nGroups * part / nParts;
+        int to = (long long)nGroups * (part + 1) / nParts;
+        
+        DoCompactTraceOperation p(*ops[thread], operands, results[part]);
+        for(int i = from; i < to; i++)
+            p.perform(&groups[i * n]);
+    }
+private:
+    const vector<TraceOperationBatch*>& ops;
+    const vector<CompactTrace>& operands;
+    const vector<int>& groups;
+    vector<CompactTrace>& results;
+};
+
+void doTraceOperation(const std::vector<TraceOperationBatch*>& ops,
+    const std::vector<CompactTrace>& operands, CompactTrace& result)
+{
+    int n = operands.size();
+    int nThreads = ops.size();
+    
+    assert(n > 0);
+    assert(nThreads > 0);
+    
+    vector<int> groups;
+    GroupsCollector collector(groups);
+    collector.collect(operands);
+    
+    int nGroups = groups.size() / n;
+    
+    if(nThreads == 1)
+    {
+        DoCompactTraceOperation p(*ops[0], operands, result);
+        for(int i = 0; i < nGroups; i++)
+            p.perform(&groups[i * n]);
+        return;
+    }
+    
+    int nParts = std::min(nGroups, nThreads * partsPerThread);
+    vector<CompactTrace> results(nParts);
+    
+    DoCompactTraceOperationPart task(ops, operands, groups, results);
+    runParallel(task, nParts, nThreads);
+    
+    for(int i = 0; i < nParts; i++)
+        result.appendGroups(results[i]);
+}
@@ -2,6 +2,7 @@
 #define DO_TRACE_OPERATION_HH
 
 #include "trace.hh"
+#include "compact_trace.hh"
 #include "trace_operation_include/trace_operation.hh"
 
 #include <vector>
@@ -9,4 +10,46 @@
 void doTraceOperation(TraceOperation& op,
     const std::vector<Trace>& operands, Trace& result);
 
+/* 
+ * Batch operation which calls per-object methods of the operation
+ * implemented with old interface.
+ */
+class TraceOperationAdapter: public TraceOperationBatch
+{
+public:
+    TraceOperationAdapter(TraceOperation* op): op(op) {}
+    
+    TraceOperation* getOperation(void) const {return op;}
+    
+    void lineOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+    void functionOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+    void branchOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result);
+private:
+    TraceOperation* op;
+    /* Operands for one object. */
+    std::vector<counter_t> objectOperands;
+    
+    void apply(counter_t (TraceOperation::*method)(const std::vector<counter_t>&),
+        const counter_t* const* operands, int n, int count, counter_t* result);
+};
+
+/* Same but for traces in compact representation. */
+void doTraceOperation(TraceOperationBatch& op,
+    const std::vector<CompactTrace>& operands, CompactTrace& result);
+void doTraceOperation(TraceOperation& op,
+    const std::vector<CompactTrace>& operands, CompactTrace& result);
+
+/* 
+ * Same but operation is performed in several threads, one per
+ * operation object in 'ops'. Every object is used only by one thread.
+ * 
+ * Groups of files are divided between threads, so resulted trace is
+ * the same as for one thread.
+ */
+void doTraceOperation(const std::vector<TraceOperationBatch*>& ops,
+    const std::vector<CompactTrace>& operands, CompactTrace& result);
+
 #endif /* DO_TRACE_OPERATION_HH */
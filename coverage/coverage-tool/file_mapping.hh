@@ -0,0 +1,68 @@
+/*
+ * Read-only mapping of the whole file into memory.
+ */
+
+#ifndef FILE_MAPPING_HH
+#define FILE_MAPPING_HH
+
+#include <cstddef>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Mapping of the whole file into memory. Unmapped in destructor. */
+class FileMapping
+{
+public:
+    FileMapping(): start(NULL), size(0) {}
+    ~FileMapping()
+    {
+        if(start) munmap(start, size);
+    }
+
+    /* Return false if file cannot be mapped. */
+    bool map(const char* filename)
+    {
+        int fd = open(filename, O_RDONLY);
+        if(fd == -1) return false;
+
+        struct stat st;
+        if((fstat(fd, &st) == -1) || !S_ISREG(st.st_mode))
+        {
+            close(fd);
+            return false;
+        }
+
+        size = st.st_size;
+        if(size > 0)
+        {
+            void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(addr == MAP_FAILED)
+            {
+                close(fd);
+                return false;
+            }
+            start = (char*)addr;
+            /* File is read once from the start to the end. */
+            madvise(start, size, MADV_SEQUENTIAL);
+        }
+
+        close(fd);
+        return true;
+    }
+
+    const char* begin(void) const {return start;}
+    const char* end(void) const {return start + size;}
+private:
+    /* Not copiable and assignable */
+    FileMapping(const FileMapping& mapping);
+    FileMapping& operator=(const FileMapping& mapping);
+
+    char* start;
+    size_t size;
+};
+
+#endif /* FILE_MAPPING_HH */
@@ -0,0 +1,142 @@
+// parallel.cpp - execution of the tasks in several threads.
+
+//      
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//      
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//      
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//      
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "parallel.hh"
+
+#include <vector>
+#include <exception>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <unistd.h> /* sysconf */
+
+using namespace std;
+
+/* State shared between all threads executing the task. */
+class ParallelRunner
+{
+public:
+    ParallelRunner(ParallelTask& task, int n): task(task), n(n), next(0)
+    {
+        pthread_mutex_init(&mutex, NULL);
+    }
+    ~ParallelRunner()
+    {
+        pthread_mutex_destroy(&mutex);
+    }
+    
+    /* Process indices until all are processed. */
+    void work(int thread)
+    {
+        int i;
+        while((i = takeNext()) != -1)
+        {
+            try
+            {
+                task.run(i, thread);
+            }
+            catch(...)
+            {
+                pthread_mutex_lock(&mutex);
+                if(!error) error = current_exception();
+                /* Do not start new indices. */
+                next = n;
+                pthread_mutex_unlock(&mutex);
+            }
+        }
+    }
+    
+    struct ThreadArg
+    {
+        ParallelRunner* runner;
+        int thread;
+    };
+    
+    static void* threadFunc(void* arg)
+    {
+        ThreadArg* threadArg = (ThreadArg*)arg;
+        threadArg->runner->work(threadArg->thread);
+        return NULL;
+    }
+    
+    /* First exception thrown by the task, if any. */
+    exception_ptr error;
+private:
+    ParallelTask& task;
+    int n;
+    
+    /* Next index to process. Protected by the mutex. */
+    int next;
+    pthread_mutex_t mutex;
+    
+    /* Return next index to process or -1. */
+    int takeNext(void)
+    {
+        pthread_mutex_lock(&mutex);
+        int i = (next < n) ? next++ : -1;
+        pthread_mutex_unlock(&mutex);
+        
+        return i;
+    }
+};
+
+void runParallel(ParallelTask& task, int n, int nThreads)
+{
+    if(nThreads > n) nThreads = n;
+    if(nThreads <= 1)
+    {
+        for(int i = 0; i < n; i++) task.run(i, 0);
+        return;
+    }
+    
+    ParallelRunner runner(task, n);
+    
+    /* Calling thread has index 0. */
+    vector<pthread_t> threads(nThreads - 1);
+    vector<ParallelRunner::ThreadArg> args(nThreads - 1);
+    int nCreated;
+    
+    for(nCreated = 0; nCreated < nThreads - 1; nCreated++)
+    {
+        args[nCreated].runner = &runner;
+        args[nCreated].thread = nCreated + 1;
+        if(pthread_create(&threads[nCreated], NULL,
+            &ParallelRunner::threadFunc, &args[nCreated]))
+        {
+            /* Continue with already created threads. */
+            break;
+        }
+    }
+    
+    runner.work(0);
+    
+    for(int i = 0; i < nCreated; i++)
+        pthread_join(threads[i], NULL);
+    
+    if(runner.error) rethrow_exception(runner.error);
+}
+
+int processorsNumber(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
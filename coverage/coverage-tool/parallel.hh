@@ -0,0 +1,39 @@
+/*
+ * Simple helpers for execute independent tasks in several threads.
+ */
+
+#ifndef PARALLEL_HH
+#define PARALLEL_HH
+
+/* Task which may be executed in parallel for different indices. */
+class ParallelTask
+{
+public:
+    virtual ~ParallelTask() {}
+    
+    /* 
+     * Process i-th element.
+     * 
+     * 'thread' is an index of the thread in which processing is performed,
+     * from 0 to number of threads - 1. Different calls with same 'thread'
+     * are never executed concurrently.
+     */
+    virtual void run(int i, int thread) = 0;
+};
+
+/*
+ * Execute task.run(i, thread) for every i from 0 to n-1 using at most
+ * 'nThreads' threads. Calling thread is used as one of them.
+ * 
+ * Indices are distributed between threads dynamically, in increasing
+ * order.
+ * 
+ * If some call throws exception, other indices are not started, and
+ * exception is rethrown in the calling thread after all threads finished.
+ */
+void runParallel(ParallelTask& task, int n, int nThreads);
+
+/* Number of processors available for the program. */
+int processorsNumber(void);
+
+#endif /* PARALLEL_HH */
@@ -23,9 +23,16 @@
 
 
 #include "trace.hh"
+#include "compact_trace.hh"
 
 #include "test_set_optimizer.hh"
+#include "coverage_index.hh"
+#include "coverage_rollup.hh"
+#include "source_diff.hh"
 #include "do_trace_operation.hh"
+#include "builtin_operations.hh"
+#include "parallel.hh"
+#include "compressed_stream.hh"
 
 #include <iostream>
 #include <fstream>
@@ -34,6 +41,7 @@
 #include <cstring> /* strcmp */
 
 #include <vector>
+#include <algorithm> /* min */
 #include <memory> /* auto_ptr */
 
 #include <stdexcept> /* runtime_error */
@@ -45,6 +53,9 @@
 
 #include <dlfcn.h> /* dlopen() and others */
 
+#include <dirent.h> /* opendir() and others */
+#include <sys/stat.h> /* stat() */
+
 typedef Trace::counter_t counter_t;
 
 /*
@@ -79,12 +90,23 @@ public:
     virtual int parseParams(int argc, char** argv) = 0;
     virtual int exec() = 0;
     virtual void usage(void) = 0;
+    
+    /* 
+     * Close output file, if it is opened. Return non-zero if data
+     * cannot be written.
+     */
+    int closeOutStream(void);
 
 protected:
     void setOutFile(const char* filename);
     const char* getOutFile(void) const;
     
     ostream& getOutStream(void);
+    
+    /* Use 'TraceMmapParser' for load traces. Set by '-m' option. */
+    bool mappedRead;
+    /* Load trace from file using parser selected for command. */
+    void readTrace(CompactTrace& trace, const char* filename);
 private:
     const char* outFile;
     /* 
@@ -114,27 +136,74 @@ struct OperationProcessor: public CommandProcessor
     public:
         virtual ~TraceOperationFactory() {}
         
-        virtual TraceOperation* getOperation(int n, const map<string, string>& params) = 0;
-        virtual void putOperation(TraceOperation* op) = 0;
+        virtual TraceOperationBatch* getOperation(int n, const map<string, string>& params) = 0;
+        virtual void putOperation(TraceOperationBatch* op) = 0;
+        
+        /* 
+         * Whether different operation objects may be used concurrently
+         * in different threads.
+         */
+        virtual bool isParallelSafe(void) const {return true;}
+        
+        /* 
+         * Whether operation may be applied to the traces by parts:
+         * op(t1, ..., tn) = op(op(t1, ..., tk), t(k+1), ..., tn).
+         */
+        virtual bool isAssociative(void) const {return false;}
     };
 
 private:    
     TraceOperationFactory* opFactory;
-    TraceOperation* operation;
+    /* 
+     * Operation objects, one per thread. First one is created when
+     * parameters are parsed.
+     */
+    vector<TraceOperationBatch*> operations;
+    
+    map<string, string> params;
+    /* Number of threads given by '-j' option, or 0. */
+    int jobs;
+    /* Number of traces loaded at once in streaming mode, or 0. */
+    int fanout;
     
     vector<const char*> traceFiles;
+    /* Storage for names of traces read from the list file. */
+    vector<string> listedFiles;
     
     void reset();
     
+    /* Number of threads for perform operation. */
+    int operationThreads(void) const;
+    /* Create operation objects for 'n' traces, one per thread. */
+    void createOperations(int n, vector<TraceOperationBatch*>& ops);
+    void putOperations(vector<TraceOperationBatch*>& ops);
+    
+    /* Read names of traces from the file, one per line. */
+    int readTracesList(const char* listFile);
+    
+    /* 
+     * Perform operation in streaming mode: traces are loaded by 'fanout'
+     * and are immediately accumulated into resulted trace.
+     */
+    int execStream(void);
+    
     static TraceOperationFactory* getOperationFactory(const char* opName);
 };
 
 /* Program execution for 'stat' command */
 struct StatProcessor: public CommandProcessor
 {
-    const char* traceFile;
+    /* Traces given in command line, in list file or in directories. */
+    vector<string> traceFiles;
     const char* format;
     const char* prefix;
+    /* 
+     * Format of the table("csv" or "json") for output statistic of
+     * several traces, or NULL.
+     */
+    const char* tableFormat;
+    /* Number of threads given by '-j' option, or 0. */
+    int jobs;
     
     StatProcessor(void);
 
@@ -144,6 +213,63 @@ struct StatProcessor: public CommandProcessor
     void usage(void);
 private:
     static const char* defaultFormat;
+    
+    /* Load trace and return its statistic. */
+    CoverageTotals collectTotals(const char* traceFile);
+    
+    /* Output statistic of all traces as a table. */
+    int execTable(void);
+    
+    class TotalsCollector;
+};
+
+/* Program execution for 'rollup' command */
+struct RollupProcessor: public CommandProcessor
+{
+    const char* traceFile;
+    const char* prefix;
+    /* "text", "csv" or "json". */
+    const char* outputFormat;
+    /* Maximum depth of output nodes, or -1. */
+    int maxDepth;
+    /* Whether to output functions. */
+    bool withFunctions;
+    
+    RollupProcessor(void);
+
+    int parseParams(int argc, char** argv);
+    int exec();
+    
+    void usage(void);
+};
+
+/* Base for commands which apply diff of the sources to the trace. */
+struct DiffProcessor: public CommandProcessor
+{
+    const char* diffFile;
+    const char* traceFile;
+    /* Number of components stripped from names in the diff. */
+    int strip;
+    
+    DiffProcessor(void);
+
+    int parseParams(int argc, char** argv);
+};
+
+/* Program execution for 'remap' command */
+struct RemapProcessor: public DiffProcessor
+{
+    int exec();
+    
+    void usage(void);
+};
+
+/* Program execution for 'diff-coverage' command */
+struct DiffCoverageProcessor: public DiffProcessor
+{
+    int exec();
+    
+    void usage(void);
 };
 
 /* Program execution for 'optimize-tests' */
@@ -151,6 +277,13 @@ struct OptimizeTestsProcessor: public CommandProcessor
 {
     const char* testsFile;
     bool verbose;
+    /* Time limit for search optimal set, or 0. */
+    double timeLimit;
+    /* Use exhaustive search instead of branch-and-bound one. */
+    bool exhaustive;
+    /* Preserve also branch and function coverage. */
+    bool preserveBranches;
+    bool preserveFunctions;
     
     OptimizeTestsProcessor(void);
 
@@ -158,9 +291,54 @@ struct OptimizeTestsProcessor: public CommandProcessor
     int exec();
     
     void usage(void);
-private:
-    /* Load tests from file. */
-    void loadTests(vector<TestCoverageDesc>& tests);
+};
+
+/* Program execution for 'convert' */
+struct ConvertProcessor: public CommandProcessor
+{
+    const char* traceFile;
+    /* Whether convert into lcov format instead of binary one. */
+    bool toText;
+    
+    ConvertProcessor(void);
+
+    int parseParams(int argc, char** argv);
+    int exec();
+    
+    void usage(void);
+};
+
+/* Program execution for 'index' */
+struct IndexProcessor: public CommandProcessor
+{
+    const char* indexFile;
+    const char* testsFile;
+    bool verbose;
+    /* Build index from scratch even if it exists. */
+    bool rebuild;
+    /* Number of threads for load traces, or 0 for default. */
+    int jobs;
+    
+    IndexProcessor(void);
+
+    int parseParams(int argc, char** argv);
+    int exec();
+    
+    void usage(void);
+};
+
+/* Program execution for 'query' */
+struct QueryProcessor: public CommandProcessor
+{
+    const char* indexFile;
+    const char* query;
+    
+    QueryProcessor(void);
+
+    int parseParams(int argc, char** argv);
+    int exec();
+    
+    void usage(void);
 };
 
 static CommandProcessor* selectCommand(const char* cmd)
@@ -186,10 +364,34 @@ static CommandProcessor* selectCommand(const char* cmd)
     {
         return new StatProcessor();
     }
+    else if(isCommand("rollup"))
+    {
+        return new RollupProcessor();
+    }
+    else if(isCommand("remap"))
+    {
+        return new RemapProcessor();
+    }
+    else if(isCommand("diff-coverage"))
+    {
+        return new DiffCoverageProcessor();
+    }
     else if(isCommand("optimize-tests"))
     {
         return new OptimizeTestsProcessor();
     }
+    else if(isCommand("convert"))
+    {
+        return new ConvertProcessor();
+    }
+    else if(isCommand("index"))
+    {
+        return new IndexProcessor();
+    }
+    else if(isCommand("query"))
+    {
+        return new QueryProcessor();
+    }
 #undef isCommand
     else return NULL;
 }
@@ -208,7 +410,9 @@ int main(int argc, char** argv)
     if(commandProcessor.get())
     {
         if(commandProcessor->parseParams(argc - 1, argv + 1)) return 1;
-        return commandProcessor->exec();
+        int result = commandProcessor->exec();
+        if(commandProcessor->closeOutStream()) result = 1;
+        return result;
     }
     else if(strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
     {
@@ -234,7 +438,8 @@ int main(int argc, char** argv)
 
 /************************* Helpers ************************************/
 /* Base CommandProcessor class */
-CommandProcessor::CommandProcessor(): outFile(NULL), outStream(NULL) {}
+CommandProcessor::CommandProcessor():
+    mappedRead(false), outFile(NULL), outStream(NULL) {}
 
 void CommandProcessor::resetOutStream(void)
 {
@@ -242,7 +447,7 @@ void CommandProcessor::resetOutStream(void)
     {
         if(outFile)
         {
-            ofstream* realStream = static_cast<ofstream*>(outStream);
+            CompressedOfstream* realStream = static_cast<CompressedOfstream*>(outStream);
             realStream->close();
             delete realStream;
         }
@@ -250,6 +455,23 @@ void CommandProcessor::resetOutStream(void)
     }
 }
 
+int CommandProcessor::closeOutStream(void)
+{
+    if(!outStream || !outFile) return 0;
+    
+    CompressedOfstream* realStream = static_cast<CompressedOfstream*>(outStream);
+    bool result = realStream->close();
+    delete realStream;
+    outStream = NULL;
+    
+    if(!result)
+    {
+        cerr << "Errors occure while write file '" << outFile << "'." << endl;
+        return 1;
+    }
+    return 0;
+}
+
 CommandProcessor::~CommandProcessor()
 {
     resetOutStream();
@@ -266,14 +488,109 @@ const char* CommandProcessor::getOutFile(void) const
     return outFile;
 }
 
+/* Load trace from file using selected parser. */
+static void loadTrace(CompactTrace& trace, const char* filename, bool mappedRead)
+{
+    if(mappedRead)
+        trace.readMapped(filename);
+    else
+        trace.read(filename);
+}
+
+void CommandProcessor::readTrace(CompactTrace& trace, const char* filename)
+{
+    loadTrace(trace, filename, mappedRead);
+}
+
+/* 
+ * Read names of traces from the file, one per line, appending them to
+ * 'names'. Empty lines and lines started with '#' are ignored. '-' means
+ * STDIN.
+ */
+static int readFilesList(const char* listFile, vector<string>& names)
+{
+    FILE* f = strcmp(listFile, "-") ? fopen(listFile, "r") : stdin;
+    if(f == NULL)
+    {
+        cerr << "Error: Failed to open file '" << listFile << "' with list of traces." << endl;
+        return 1;
+    }
+    
+    char* line = NULL;
+    size_t buffer_size;
+    ssize_t len;
+    while((len = getline(&line, &buffer_size, f)) != -1)
+    {
+        /* Drop delimiter if it is. */
+        if((len > 0) && (line[len - 1] == '\n')) line[len - 1] = '\0';
+        /* Ignore empty lines and lines started with '#' */
+        if((line[0] == '\0') || (line[0] == '#')) continue;
+        
+        names.push_back(line);
+    }
+    
+    free(line);
+    if(f != stdin) fclose(f);
+    
+    return 0;
+}
+
+/* 
+ * Load tests from file with lines in format
+ * 
+ *      <weight> <trace-file>
+ * 
+ * Empty lines and lines started with '#' are ignored.
+ */
+static void loadTests(const char* testsFile, vector<TestCoverageDesc>& tests)
+{
+    FILE* f = fopen(testsFile, "r");
+    if(f == NULL)
+    {
+        cerr << "Failed to open file with tests." << endl;
+        throw runtime_error("Failed to open file");
+    }
+    
+    char* line = NULL;
+    size_t buffer_size;
+    ssize_t len;
+    while((len = getline(&line, &buffer_size, f)) != -1)
+    {
+        /* Drop delimiter if it is. */
+        if((len > 0) && (line[len - 1] == '\n')) line[len - 1] = '\0';
+        /* Ignore empty lines and lines started with '#' */
+        if((line[0] == '\0') || (line[0] == '#')) continue;
+        
+        char* filename_start;
+        
+        double weight = strtod(line, &filename_start);
+        
+        while(isspace(*filename_start)) ++filename_start;
+        
+        tests.push_back(TestCoverageDesc(filename_start, weight));
+    }
+    
+    free(line);
+    fclose(f);
+}
+
 ostream& CommandProcessor::getOutStream(void)
 {
     if(!outStream)
     {
         if(outFile)
         {
-            ofstream* realStream = new ofstream(outFile);
-            if(!realStream)
+            if(!compressionSupported(compressionByName(outFile)))
+            {
+                cerr << "Cannot write file '" << outFile << "': support for "
+                    << compressionName(compressionByName(outFile))
+                    << " compression is not built in." << endl;
+                throw runtime_error("Unsupported compression");
+            }
+            
+            /* Output is compressed according to the file extension. */
+            CompressedOfstream* realStream = new CompressedOfstream(outFile);
+            if(!*realStream)
             {
                 cerr << "Failed to open file '" << outFile << "' for write." << endl;
                 delete realStream;
@@ -292,11 +609,7 @@ ostream& CommandProcessor::getOutStream(void)
 /******************* OperationProcessor implementation ****************/
 void OperationProcessor::reset(void)
 {
-    if(operation)
-    {
-        opFactory->putOperation(operation);
-        operation = NULL;
-    }
+    putOperations(operations);
     
     if(opFactory)
     {
@@ -314,13 +627,15 @@ OperationProcessor::~OperationProcessor()
 
 OperationProcessor::OperationProcessor(void):
     opFactory(NULL),
-    operation(NULL)
+    jobs(0),
+    fanout(0)
 {
 }
 
 OperationProcessor::OperationProcessor(const char* opName):
     opFactory(getOperationFactory(opName)),
-    operation(NULL)
+    jobs(0),
+    fanout(0)
 {
 }
 
@@ -386,9 +701,9 @@ int OperationProcessor::parseParams(int argc, char** argv)
         ++argv;
     }
     
-    static const char options[] = "+o:p:";
+    static const char options[] = "+o:p:mj:s:l:";
     
-    map<string,string> params;
+    const char* listFile = NULL;
     
     for(int opt = getopt(argc, argv, options);
         opt != -1;
@@ -405,6 +720,28 @@ int OperationProcessor::parseParams(int argc, char** argv)
         case 'p':
             readParameters(optarg, params);
             break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            if(jobs <= 0)
+            {
+                cerr << "Error: Number of jobs should be positive." << endl;
+                return 1;
+            }
+            break;
+        case 's':
+            fanout = atoi(optarg);
+            if(fanout <= 0)
+            {
+                cerr << "Error: Number of traces loaded at once should be positive." << endl;
+                return 1;
+            }
+            break;
+        case 'l':
+            listFile = optarg;
+            break;
         default:
             return 1;
         }
@@ -417,47 +754,115 @@ int OperationProcessor::parseParams(int argc, char** argv)
     argc -= optind;
     argv += optind;
     
-    if(argc == 0)
+    traceFiles.assign(argv, argv + argc);
+    
+    if(listFile && readTracesList(listFile)) return 1;
+    
+    if(traceFiles.empty())
     {
         cerr << "Error: At least one trace should be given for operation." << endl;
         return 1;
     }
     
-    int n = argc;
-    
-    traceFiles.resize(n);
-
-    for(int i = 0; i < n; i++)
+    if(fanout && !opFactory->isAssociative())
     {
-        traceFiles[i] = argv[i];
+        cerr << "Error: Streaming mode is supported only for associative "
+            "operations, like 'add'." << endl;
+        return 1;
     }
     
+    int n = traceFiles.size();
+    
     try
     {
-        operation = opFactory->getOperation(n, params);
+        TraceOperationBatch* operation = opFactory->getOperation(n, params);
+        if(!operation) return 1;
+        operations.push_back(operation);
     }
     catch(exception& ex)
     {
         cerr << "Error: " << ex.what() << endl;
         return 1;
     }
-    if(!operation) return 1;
     
     return 0;
 }
 
+int OperationProcessor::readTracesList(const char* listFile)
+{
+    if(readFilesList(listFile, listedFiles)) return 1;
+    
+    /* Storage is filled, so pointers to the names are not changed. */
+    for(int i = 0; i < (int)listedFiles.size(); i++)
+        traceFiles.push_back(listedFiles[i].c_str());
+    
+    return 0;
+}
+
+int OperationProcessor::operationThreads(void) const
+{
+    /* 
+     * Operations from user-defined modules are not assumed to be
+     * thread-safe unless number of jobs is given explicitely.
+     */
+    if(jobs) return jobs;
+    return opFactory->isParallelSafe() ? processorsNumber() : 1;
+}
+
+void OperationProcessor::createOperations(int n, vector<TraceOperationBatch*>& ops)
+{
+    int nThreads = operationThreads();
+    while((int)ops.size() < nThreads)
+    {
+        TraceOperationBatch* operation = opFactory->getOperation(n, params);
+        if(!operation) throw runtime_error("Failed to create operation");
+        ops.push_back(operation);
+    }
+}
+
+void OperationProcessor::putOperations(vector<TraceOperationBatch*>& ops)
+{
+    for(int i = 0; i < (int)ops.size(); i++)
+    {
+        opFactory->putOperation(ops[i]);
+    }
+    ops.clear();
+}
+
+/* Load traces in parallel. */
+class TracesLoader: public ParallelTask
+{
+public:
+    TracesLoader(const char* const* traceFiles, CompactTrace* traces,
+        bool mappedRead):
+        traceFiles(traceFiles), traces(traces), mappedRead(mappedRead) {}
+    
+    void run(int i, int /*thread*/)
+    {
+        loadTrace(traces[i], traceFiles[i], mappedRead);
+    }
+private:
+    const char* const* traceFiles;
+    CompactTrace* traces;
+    bool mappedRead;
+};
+
 int OperationProcessor::exec(void)
 {
+    if(fanout) return execStream();
+    
     int n = traceFiles.size();
     
-    vector<Trace> operands(n);
+    vector<CompactTrace> operands(n);
     
-    for(int i = 0; i < n; i++)
-        operands[i].read(traceFiles[i]);
+    TracesLoader loader(&traceFiles[0], &operands[0], mappedRead);
+    runParallel(loader, n, jobs ? jobs : processorsNumber());
+    
+    createOperations(n, operations);
     
-    Trace trace;
+    CompactTrace trace;
     
-    doTraceOperation(*operation, operands, trace);
+    doTraceOperation(operations, operands, trace);
     
     ostream& outStream = getOutStream();
     trace.write(outStream);
@@ -470,6 +875,50 @@ int OperationProcessor::exec(void)
     return 0;
 }
 
+int OperationProcessor::execStream(void)
+{
+    int nTraces = traceFiles.size();
+    
+    /* Operation result for traces processed so far. */
+    CompactTrace accumulator;
+    
+    for(int start = 0; start < nTraces; start += fanout)
+    {
+        int nLoaded = std::min(fanout, nTraces - start);
+        /* Accumulator is the first operand, except for the first time. */
+        int nAcc = start ? 1 : 0;
+        
+        vector<CompactTrace> operands(nAcc + nLoaded);
+        if(nAcc) operands[0].swap(accumulator);
+        
+        TracesLoader loader(&traceFiles[start], &operands[nAcc], mappedRead);
+        runParallel(loader, nLoaded, jobs ? jobs : processorsNumber());
+        
+        vector<TraceOperationBatch*> ops;
+        try
+        {
+            createOperations(operands.size(), ops);
+            doTraceOperation(ops, operands, accumulator);
+        }
+        catch(...)
+        {
+            putOperations(ops);
+            throw;
+        }
+        putOperations(ops);
+    }
+    
+    ostream& outStream = getOutStream();
+    accumulator.write(outStream);
+    if(!outStream)
+    {
+        cerr << "Errors occure while write trace." << endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
 DEFINE_FILE_PRINTER(usage_operation)
 
 void OperationProcessor::usage(void)
@@ -483,43 +932,18 @@ class TraceOperationFactoryInternal:
     public OperationProcessor::TraceOperationFactory
 {
 protected:
-    void putOperation(TraceOperation* op) {delete op;}
+    void putOperation(TraceOperationBatch* op) {delete op;}
 };
 /********************* Difference implementation **********************/
-/* Trace operation*/
-class TraceOperationDiff: public TraceOperationUnified
+/* Trace operation factory. */
+class TraceOperationFactoryDiff: public TraceOperationFactoryInternal
 {
-public:
-    counter_t counterOperation(const vector<counter_t>& operands)
+protected:
+    TraceOperationBatch* getOperation(int n, const map<string,string>&)
     {
-        counter_t op1 = operands[0], op2 = operands[1];
-        if(op1 > 0)
+        if(n != 2)
         {
-            if(op2 >= op1)
-            {
-                return 0;
-            }
-            else
-            {
-                return op1 - op2;
-            }
-        }
-        else
-        {
-            return op1;
-        }
-    }
-};
-
-/* Trace operation factory. */
-class TraceOperationFactoryDiff: public TraceOperationFactoryInternal
-{
-protected:
-    TraceOperation* getOperation(int n, const map<string,string>&)
-    {
-        if(n != 2)
-        {
-            throw logic_error("Diff operation accepts precisely 2 trace arguments");
+            throw logic_error("Diff operation accepts precisely 2 trace arguments");
         }
         
         return new TraceOperationDiff();
@@ -527,59 +951,24 @@ protected:
 };
 
 /************************* Add implementation *************************/
-/* Trace operation*/
-class TraceOperationAdd: public TraceOperationUnified
-{
-public:
-    TraceOperationAdd(int n): n(n) {}
-
-    counter_t counterOperation(const vector<counter_t>& operands)
-    {
-        counter_t result = operands[0];
-        
-        for(int i = 1; i < n; i++)
-        {
-            counter_t op = operands[i];
-            if(op >= 0)
-            {
-                if(result < 0) result = 0;
-                result += op;
-            }
-        }
-        
-        return result;
-    }
-private:
-    int n;
-};
-
 /* Trace operation factory. */
 class TraceOperationFactoryAdd: public TraceOperationFactoryInternal
 {
 protected:
-    TraceOperation* getOperation(int n, const map<string,string>&)
-    {
-        return new TraceOperationAdd(n);
-    }
-};
+    bool isAssociative(void) const {return true;}
 
-/************************ New coverage implementation *****************/
-/* Trace operation*/
-class TraceOperationNewCoverage: public TraceOperationUnified
-{
-public:
-    counter_t counterOperation(const vector<counter_t>& operands)
+    TraceOperationBatch* getOperation(int, const map<string,string>&)
     {
-        if(operands[1] > 0) return 0;
-        else return operands[0];
+        return new TraceOperationAdd();
     }
 };
 
+/************************ New coverage implementation *****************/
 /* Trace operation container. */
 class TraceOperationFactoryrNewCoverage: public TraceOperationFactoryInternal
 {
 protected:
-    TraceOperation* getOperation(int n, const map<string,string>&)
+    TraceOperationBatch* getOperation(int n, const map<string,string>&)
     {
         if(n != 2)
         {
@@ -608,26 +997,50 @@ public:
         dlclose(module);
     }
 
-    TraceOperation* getOperation(int n, const map<string,string>& params)
+    TraceOperationBatch* getOperation(int n, const map<string,string>& params)
     {
-        TraceOperation* (*getOperationF)(int n, const map<string,string>& params) =
-            (typeof(getOperationF))dlsym(module, "getOperation");
-        if(!getOperationF)
+        if(isBatch())
         {
-            const char* err = dlerror();
-            if(err)
-                cerr << err << endl;
-            else
-                cerr << "In module " << filename << "getOperation symbol is NULL" << endl;
+            TraceOperationBatch* (*getOperationF)(int n, const map<string,string>& params) =
+                (typeof(getOperationF))getSymbol("getOperationBatch");
             
-            throw runtime_error("Failed to create use-defined operation");
+            return getOperationF(n, params);
         }
         
-        return getOperationF(n, params);
+        TraceOperation* (*getOperationF)(int n, const map<string,string>& params) =
+            (typeof(getOperationF))getSymbol("getOperation");
+        
+        TraceOperation* op = getOperationF(n, params);
+        if(!op) return NULL;
+        
+        /* Old module, its operation is called for every counter. */
+        return new TraceOperationAdapter(op);
     }
     
-    void putOperation(TraceOperation* op)
+    /* We know nothing about operations defined by user. */
+    bool isParallelSafe(void) const {return false;}
+    
+    void putOperation(TraceOperationBatch* op)
     {
+        if(isBatch())
+        {
+            void (*putOperationF)(TraceOperationBatch*) =
+                (typeof(putOperationF))dlsym(module, "putOperationBatch");
+            if(!putOperationF)
+            {
+                const char* err = dlerror();
+                if(err)
+                    cerr << err << endl;
+            }
+            else
+            {
+                putOperationF(op);
+            }
+            return;
+        }
+        
+        TraceOperationAdapter* adapter = static_cast<TraceOperationAdapter*>(op);
+        
         void (*putOperationF)(TraceOperation*) =
             (typeof(putOperationF))dlsym(module, "putOperation");
         if(!putOperationF)
@@ -638,14 +1051,38 @@ public:
         }
         else
         {
-            putOperationF(op);
+            putOperationF(adapter->getOperation());
         }
+        delete adapter;
     }
 
 private:
     void* module;
     /* For error-reporting only */
     const char* filename;
+    
+    /* Whether module implements batch interface of the operation. */
+    bool isBatch(void) const
+    {
+        return dlsym(module, "getOperationBatch") != NULL;
+    }
+    
+    /* Return symbol which should be defined by the module. */
+    void* getSymbol(const char* name)
+    {
+        void* symbol = dlsym(module, name);
+        if(!symbol)
+        {
+            const char* err = dlerror();
+            if(err)
+                cerr << err << endl;
+            else
+                cerr << "In module " << filename << " " << name << " symbol is NULL" << endl;
+            
+            throw runtime_error("Failed to create use-defined operation");
+        }
+        return symbol;
+    }
 };
 
 
@@ -678,13 +1115,48 @@ const char* StatProcessor::defaultFormat =
     "Branches: %pb%% (%b of %B)\n";
 
 StatProcessor::StatProcessor():
-    traceFile(NULL), format(defaultFormat), prefix(NULL)
+    format(defaultFormat), prefix(NULL), tableFormat(NULL), jobs(0)
+{
+}
+
+/* 
+ * Append regular files from the directory to 'names', in sorted order.
+ * Hidden files are skipped.
+ */
+static int readDirectory(const char* dirname, vector<string>& names)
 {
+    DIR* dir = opendir(dirname);
+    if(dir == NULL)
+    {
+        cerr << "Error: Failed to open directory '" << dirname << "'." << endl;
+        return 1;
+    }
+    
+    vector<string> entries;
+    for(struct dirent* entry = readdir(dir); entry; entry = readdir(dir))
+    {
+        if(entry->d_name[0] == '.') continue;
+        
+        string name = string(dirname) + "/" + entry->d_name;
+        struct stat st;
+        if(stat(name.c_str(), &st) || !S_ISREG(st.st_mode)) continue;
+        
+        entries.push_back(name);
+    }
+    closedir(dir);
+    
+    sort(entries.begin(), entries.end());
+    names.insert(names.end(), entries.begin(), entries.end());
+    
+    return 0;
 }
 
 int StatProcessor::parseParams(int argc, char** argv)
 {
-    static const char options[] = "+o:f:p:";
+    static const char options[] = "+o:f:p:mt:j:l:";
+    
+    const char* listFile = NULL;
+    bool formatGiven = false;
     
     for(int opt = getopt(argc, argv, options);
         opt != -1;
@@ -700,10 +1172,34 @@ int StatProcessor::parseParams(int argc, char** argv)
             break;
         case 'f':
             format = optarg;
+            formatGiven = true;
             break;
         case 'p':
             prefix = optarg;
             break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 't':
+            if(strcmp(optarg, "csv") && strcmp(optarg, "json"))
+            {
+                cerr << "Error: Unknown table format '" << optarg
+                    << "', should be 'csv' or 'json'." << endl;
+                return -1;
+            }
+            tableFormat = optarg;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            if(jobs <= 0)
+            {
+                cerr << "Error: Number of jobs should be positive." << endl;
+                return -1;
+            }
+            break;
+        case 'l':
+            listFile = optarg;
+            break;
         default:
             return -1;
         }
@@ -712,14 +1208,39 @@ int StatProcessor::parseParams(int argc, char** argv)
     char** argv_rest = argv + optind;
     int argc_rest = argc - optind;
     
-    if(argc_rest != 1)
+    bool hasDirectory = false;
+    for(int i = 0; i < argc_rest; i++)
     {
-        if(argc_rest == 0) cerr << "Trace file is missed." << endl;
-        else cerr << "Exceeded command-line argument: " << argv_rest[1] << endl;
+        struct stat st;
+        if((stat(argv_rest[i], &st) == 0) && S_ISDIR(st.st_mode))
+        {
+            if(readDirectory(argv_rest[i], traceFiles)) return -1;
+            hasDirectory = true;
+        }
+        else
+        {
+            traceFiles.push_back(argv_rest[i]);
+        }
+    }
+    
+    if(listFile && readFilesList(listFile, traceFiles)) return -1;
+    
+    /* Anything except single trace is output as a table. */
+    if(!tableFormat && ((argc_rest > 1) || hasDirectory || listFile))
+        tableFormat = "csv";
+    
+    if(tableFormat && formatGiven)
+    {
+        cerr << "Error: Option '-f' cannot be used when statistic is output as a table." << endl;
         return -1;
     }
     
-    traceFile = argv_rest[0];
+    if(traceFiles.empty())
+    {
+        if(tableFormat) cerr << "No trace files are given." << endl;
+        else cerr << "Trace file is missed." << endl;
+        return -1;
+    }
     
     return 0;
 }
@@ -729,63 +1250,22 @@ int StatProcessor::parseParams(int argc, char** argv)
 class StatPrinter
 {
 public:
-    StatPrinter(Trace& trace, ostream& os);
+    StatPrinter(const CoverageTotals& totals, ostream& os);
     
     void print(const char* format);
 private:
-    Trace& trace;
+    const CoverageTotals& totals;
     ostream& os;
     /* Print specificator. Return pointer to the end of specificator. */
     const char* printSpec(const char* specPointer);
     /* Print escape sequence. Return pointer to the end of the sequence. */
     const char* printEsc(const char* seqPointer);
 
-    int linesTotal;
-    int linesTotalHit;
-    int functionsTotal;
-    int functionsTotalHit;
-    int branchesTotal;
-    int branchesTotalHit;
-    
-    int getLinesTotal(void)
-    {
-        if(linesTotal == -1) linesTotal = trace.linesTotal();
-        return linesTotal;
-    }
-    int getLinesTotalHit(void)
-    {
-        if(linesTotalHit == -1) linesTotalHit = trace.linesTotalHit();
-        return linesTotalHit;
-    }
-    int getFunctionsTotal(void)
-    {
-        if(functionsTotal == -1) functionsTotal = trace.functionsTotal();
-        return functionsTotal;
-    }
-    int getFunctionsTotalHit(void)
-    {
-        if(functionsTotalHit == -1) functionsTotalHit = trace.functionsTotalHit();
-        return functionsTotalHit;
-    }
-    int getBranchesTotal(void)
-    {
-        if(branchesTotal == -1) branchesTotal = trace.branchesTotal();
-        return branchesTotal;
-    }
-    int getBranchesTotalHit(void)
-    {
-        if(branchesTotalHit == -1) branchesTotalHit = trace.branchesTotalHit();
-        return branchesTotalHit;
-    }
-
     void printPercent(int a, int A);
 };
 
-StatPrinter::StatPrinter(Trace& trace, ostream& os)
-    : trace(trace), os(os),
-        linesTotal(-1), linesTotalHit(-1),
-        functionsTotal(-1), functionsTotalHit(-1),
-        branchesTotal(-1), branchesTotalHit(-1)
+StatPrinter::StatPrinter(const CoverageTotals& totals, ostream& os)
+    : totals(totals), os(os)
 {}
 
 void StatPrinter::print(const char* format)
@@ -812,35 +1292,35 @@ const char* StatPrinter::printSpec(const char* specPointer)
     switch(*specPointer)
     {
     case 'l':
-        count = getLinesTotalHit();
+        count = totals.linesHit;
         os << count;
         break;
     case 'L':
-        os << getLinesTotal();
+        os << totals.lines;
         break;
     case 'f':
-        os << getFunctionsTotalHit();
+        os << totals.functionsHit;
         break;
     case 'F':
-        os << getFunctionsTotal();
+        os << totals.functions;
         break;
     case 'b':
-        os << getBranchesTotalHit();
+        os << totals.branchesHit;
         break;
     case 'B':
-        os << getBranchesTotal();
+        os << totals.branches;
         break;
     case 'p':
         switch(specPointer[1])
         {
         case 'l':
-            printPercent(getLinesTotalHit(), getLinesTotal());
+            printPercent(totals.linesHit, totals.lines);
             break;
         case 'f':
-            printPercent(getFunctionsTotalHit(), getFunctionsTotal());
+            printPercent(totals.functionsHit, totals.functions);
             break;
         case 'b':
-            printPercent(getBranchesTotalHit(), getBranchesTotal());
+            printPercent(totals.branchesHit, totals.branches);
             break;
         case '\0':
             cerr << "WARINING: Unknown specificator '%p' at the end of stat format." << endl;
@@ -909,11 +1389,52 @@ void StatPrinter::printPercent(int a, int A)
     os.width(oldWidth);
 }
 
+/* Quote value for CSV if needed. */
+static void printCsvValue(ostream& os, const string& value)
+{
+    if(value.find_first_of(",\"\n\r") == string::npos)
+    {
+        os << value;
+        return;
+    }
+    
+    os << '"';
+    for(int i = 0; i < (int)value.size(); i++)
+    {
+        if(value[i] == '"') os << '"';
+        os << value[i];
+    }
+    os << '"';
+}
+
+static void printJsonString(ostream& os, const string& value)
+{
+    static const char hex[] = "0123456789abcdef";
+    
+    os << '"';
+    for(int i = 0; i < (int)value.size(); i++)
+    {
+        unsigned char c = value[i];
+        switch(c)
+        {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\r': os << "\\r"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if(c < 0x20) os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+            else os << c;
+        }
+    }
+    os << '"';
+}
+
 /* Exec */
-int StatProcessor::exec()
+CoverageTotals StatProcessor::collectTotals(const char* traceFile)
 {
-    Trace trace;
-    trace.read(traceFile);
+    CompactTrace trace;
+    loadTrace(trace, traceFile, mappedRead);
 
     trace.groupFiles();
     
@@ -925,8 +1446,111 @@ int StatProcessor::exec()
         trace.filterSources(prefixStr);
     }
     
+    return trace.totals();
+}
+
+/* 
+ * Collect statistic of traces in parallel.
+ *
+ * Failure to process one trace doesn't affect others, it is only
+ * remembered.
+ */
+class StatProcessor::TotalsCollector: public ParallelTask
+{
+public:
+    TotalsCollector(StatProcessor& processor, CoverageTotals* totals,
+        char* failed): processor(processor), totals(totals), failed(failed) {}
+    
+    void run(int i, int /*thread*/)
+    {
+        const char* traceFile = processor.traceFiles[i].c_str();
+        try
+        {
+            totals[i] = processor.collectTotals(traceFile);
+        }
+        catch(exception&)
+        {
+            /* Error is already reported by the trace loader. */
+            failed[i] = 1;
+        }
+    }
+private:
+    StatProcessor& processor;
+    CoverageTotals* totals;
+    char* failed;
+};
+
+int StatProcessor::execTable(void)
+{
+    int n = traceFiles.size();
+    
+    vector<CoverageTotals> totals(n);
+    vector<char> failed(n, 0);
+    
+    TotalsCollector collector(*this, &totals[0], &failed[0]);
+    runParallel(collector, n, jobs ? jobs : processorsNumber());
+    
+    ostream& outStream = getOutStream();
+    bool json = strcmp(tableFormat, "json") == 0;
+    
+    int result = 0;
+    
+    if(json) outStream << "[";
+    else outStream << "trace,lines,lines_hit,functions,functions_hit,"
+        "branches,branches_hit" << endl;
+    
+    bool first = true;
+    for(int i = 0; i < n; i++)
+    {
+        if(failed[i])
+        {
+            cerr << "Error: Failed to collect statistic for trace '"
+                << traceFiles[i] << "'." << endl;
+            result = 1;
+            continue;
+        }
+        
+        const CoverageTotals& t = totals[i];
+        if(json)
+        {
+            outStream << (first ? "\n" : ",\n") << "{\"trace\": ";
+            printJsonString(outStream, traceFiles[i]);
+            outStream << ", \"lines\": " << t.lines
+                << ", \"lines_hit\": " << t.linesHit
+                << ", \"functions\": " << t.functions
+                << ", \"functions_hit\": " << t.functionsHit
+                << ", \"branches\": " << t.branches
+                << ", \"branches_hit\": " << t.branchesHit << "}";
+        }
+        else
+        {
+            printCsvValue(outStream, traceFiles[i]);
+            outStream << ',' << t.lines << ',' << t.linesHit
+                << ',' << t.functions << ',' << t.functionsHit
+                << ',' << t.branches << ',' << t.branchesHit << endl;
+        }
+        first = false;
+    }
+    
+    if(json) outStream << "\n]" << endl;
+    
+    if(!outStream)
+    {
+        cerr << "Errors occure while write statistic." << endl;
+        return 1;
+    }
+    
+    return result;
+}
+
+int StatProcessor::exec()
+{
+    if(tableFormat) return execTable();
+    
+    CoverageTotals totals = collectTotals(traceFiles[0].c_str());
+    
     ostream& outStream = getOutStream();
-    StatPrinter printer(trace, outStream);
+    StatPrinter printer(totals, outStream);
     printer.print(format);
 
     if(!outStream)
@@ -945,14 +1569,17 @@ void StatProcessor::usage(void)
     print_usage_stat();
 }
 
-/****************** Optimize-tests implementation *********************/
+/********************** Rollup implementation *************************/
 /* Params */
-OptimizeTestsProcessor::OptimizeTestsProcessor()
-    : testsFile(NULL), verbose(false) {}
+RollupProcessor::RollupProcessor():
+    traceFile(NULL), prefix(NULL), outputFormat("text"), maxDepth(-1),
+    withFunctions(true)
+{
+}
 
-int OptimizeTestsProcessor::parseParams(int argc, char** argv)
+int RollupProcessor::parseParams(int argc, char** argv)
 {
-    static const char options[] = "+o:v";
+    static const char options[] = "+o:p:mt:d:F";
     
     for(int opt = getopt(argc, argv, options);
         opt != -1;
@@ -966,8 +1593,32 @@ int OptimizeTestsProcessor::parseParams(int argc, char** argv)
         case 'o':
             setOutFile(optarg);
             break;
-        case 'v':
-            verbose = true;
+        case 'p':
+            prefix = optarg;
+            break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 't':
+            if(strcmp(optarg, "text") && strcmp(optarg, "csv")
+                && strcmp(optarg, "json"))
+            {
+                cerr << "Error: Unknown output format '" << optarg
+                    << "', should be 'text', 'csv' or 'json'." << endl;
+                return -1;
+            }
+            outputFormat = optarg;
+            break;
+        case 'd':
+            maxDepth = atoi(optarg);
+            if(maxDepth < 0)
+            {
+                cerr << "Error: Depth should be non-negative." << endl;
+                return -1;
+            }
+            break;
+        case 'F':
+            withFunctions = false;
             break;
         default:
             return -1;
@@ -979,67 +1630,724 @@ int OptimizeTestsProcessor::parseParams(int argc, char** argv)
     
     if(argc_rest != 1)
     {
-        if(argc_rest == 0) cerr << "Tests file is missed." << endl;
+        if(argc_rest == 0) cerr << "Trace file is missed." << endl;
         else cerr << "Exceeded command-line argument: " << argv_rest[1] << endl;
         return -1;
     }
     
-    testsFile = argv_rest[0];
+    traceFile = argv_rest[0];
     
     return 0;
 }
 
-int OptimizeTestsProcessor::exec()
+/* Output */
+class RollupPrinter
 {
-    vector<TestCoverageDesc> tests;
-    loadTests(tests);
+public:
+    RollupPrinter(const CoverageRollup& rollup, ostream& os,
+        int maxDepth, bool withFunctions): rollup(rollup), os(os),
+        maxDepth(maxDepth), withFunctions(withFunctions) {}
     
-    TestSetOptimizer optimizer(tests);
-    const vector<TestCoverageDesc>& optTests = optimizer.optimize(verbose);
-
-    ostream& os = getOutStream();
+    void printText(void)
+    {
+        os << "uncovered\tlines\tlines_hit\tfunctions\tfunctions_hit"
+            "\tbranches\tbranches_hit\tname" << endl;
+        printTextNode(0, 0);
+    }
     
-    for(int i = 0; i < (int)optTests.size(); i++)
+    void printCsv(void)
     {
-        os << optTests[i].traceFile << endl;
+        os << "kind,path,function,line,uncovered,lines,lines_hit,"
+            "functions,functions_hit,branches,branches_hit" << endl;
+        printCsvNode(0, 0, "");
     }
-    return 0;
-}
-
-DEFINE_FILE_PRINTER(usage_optimize_tests)
-void OptimizeTestsProcessor::usage(void)
-{
-    print_usage_optimize_tests();
-}
-
-
-void OptimizeTestsProcessor::loadTests(vector<TestCoverageDesc>& tests)
-{
-    FILE* f = fopen(testsFile, "r");
-    if(f == NULL)
+    
+    void printJson(void)
     {
-        cerr << "Failed to open file with tests." << endl;
-        throw runtime_error("Failed to open file");
+        printJsonNode(0, 0, "");
+        os << endl;
     }
+private:
+    const CoverageRollup& rollup;
+    ostream& os;
+    int maxDepth;
+    bool withFunctions;
     
-    char* line = NULL;
-    size_t buffer_size;
-    ssize_t len;
-    while((len = getline(&line, &buffer_size, f)) != -1)
+    typedef CoverageRollup::Node Node;
+    
+    static const char* kindName(const Node& node)
     {
-        /* Drop delimiter if it is. */
-        if((len > 0) && (line[len - 1] == '\n')) line[len - 1] = '\0';
-        /* Ignore empty lines and lines started with '#' */
-        if((line[0] == '\0') || (line[0] == '#')) continue;
-        
-        char* filename_start;
+        switch(node.kind)
+        {
+        case CoverageRollup::directoryNode: return "directory";
+        case CoverageRollup::fileNode: return "file";
+        default: return "function";
+        }
+    }
+    
+    /* Whether children of the node at given depth are output. */
+    bool isExpanded(const Node& node, int depth) const
+    {
+        if((maxDepth >= 0) && (depth >= maxDepth)) return false;
+        if((node.kind == CoverageRollup::fileNode) && !withFunctions)
+            return false;
+        return true;
+    }
+    
+    void printTextNode(int index, int depth)
+    {
+        const Node& node = rollup.nodes[index];
+        const CoverageTotals& t = node.totals;
         
-        double weight = strtod(line, &filename_start);
+        os << node.linesUncovered() << '\t' << t.lines << '\t' << t.linesHit
+            << '\t' << t.functions << '\t' << t.functionsHit
+            << '\t' << t.branches << '\t' << t.branchesHit << '\t';
+        for(int i = 0; i < depth; i++) os << "  ";
+        if(node.kind == CoverageRollup::functionNode)
+            os << node.name << "()";
+        else if(node.kind == CoverageRollup::directoryNode)
+            os << node.name << '/';
+        else
+            os << node.name;
+        os << endl;
         
-        while(isspace(*filename_start)) ++filename_start;
+        if(!isExpanded(node, depth)) return;
+        for(int i = 0; i < (int)node.children.size(); i++)
+            printTextNode(node.children[i], depth + 1);
+    }
+    
+    void printCsvNode(int index, int depth, const string& filename)
+    {
+        const Node& node = rollup.nodes[index];
+        const CoverageTotals& t = node.totals;
         
-        tests.push_back(TestCoverageDesc(filename_start, weight));
+        os << kindName(node) << ',';
+        if(node.kind == CoverageRollup::functionNode)
+        {
+            printCsvValue(os, filename);
+            os << ',';
+            printCsvValue(os, node.name);
+            os << ',' << node.line;
+        }
+        else
+        {
+            printCsvValue(os, node.name);
+            os << ",,";
+        }
+        os << ',' << node.linesUncovered() << ',' << t.lines << ',' << t.linesHit
+            << ',' << t.functions << ',' << t.functionsHit
+            << ',' << t.branches << ',' << t.branchesHit << endl;
+        
+        if(!isExpanded(node, depth)) return;
+        for(int i = 0; i < (int)node.children.size(); i++)
+            printCsvNode(node.children[i], depth + 1, node.name);
     }
     
-    free(line);
+    void printJsonNode(int index, int depth, const string& indent)
+    {
+        const Node& node = rollup.nodes[index];
+        const CoverageTotals& t = node.totals;
+        
+        os << indent << "{\"kind\": \"" << kindName(node) << "\", \"name\": ";
+        printJsonString(os, node.name);
+        if(node.kind == CoverageRollup::functionNode)
+            os << ", \"line\": " << node.line;
+        os << ", \"uncovered\": " << node.linesUncovered()
+            << ", \"lines\": " << t.lines
+            << ", \"lines_hit\": " << t.linesHit
+            << ", \"functions\": " << t.functions
+            << ", \"functions_hit\": " << t.functionsHit
+            << ", \"branches\": " << t.branches
+            << ", \"branches_hit\": " << t.branchesHit;
+        
+        if(isExpanded(node, depth) && !node.children.empty())
+        {
+            os << ", \"children\": [";
+            for(int i = 0; i < (int)node.children.size(); i++)
+            {
+                os << (i ? ",\n" : "\n");
+                printJsonNode(node.children[i], depth + 1, indent + "  ");
+            }
+            os << "\n" << indent << "]";
+        }
+        os << "}";
+    }
+};
+
+/* Exec */
+int RollupProcessor::exec()
+{
+    CompactTrace trace;
+    readTrace(trace, traceFile);
+
+    trace.groupFiles();
+    
+    if(prefix)
+    {
+        string prefixStr = prefix;
+        if(*prefix != '/')
+            prefixStr = trace.commonSourcePrefix() + prefix;
+        trace.filterSources(prefixStr);
+    }
+    
+    CoverageRollup rollup;
+    rollup.build(trace);
+    rollup.sort();
+    
+    ostream& outStream = getOutStream();
+    RollupPrinter printer(rollup, outStream, maxDepth, withFunctions);
+    if(strcmp(outputFormat, "csv") == 0) printer.printCsv();
+    else if(strcmp(outputFormat, "json") == 0) printer.printJson();
+    else printer.printText();
+
+    if(!outStream)
+    {
+        cerr << "Errors occure while write statistic." << endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_rollup)
+
+void RollupProcessor::usage(void)
+{
+    print_usage_rollup();
+}
+
+/******************** Diff-related commands implementation ***********/
+/* Params */
+DiffProcessor::DiffProcessor():
+    diffFile(NULL), traceFile(NULL), strip(1)
+{
+}
+
+int DiffProcessor::parseParams(int argc, char** argv)
+{
+    static const char options[] = "+o:p:m";
+    
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case '?':
+            //error in options
+            return -1;
+        case 'o':
+            setOutFile(optarg);
+            break;
+        case 'p':
+            strip = atoi(optarg);
+            if(strip < 0)
+            {
+                cerr << "Error: Number of stripped components should be non-negative." << endl;
+                return -1;
+            }
+            break;
+        case 'm':
+            mappedRead = true;
+            break;
+        default:
+            return -1;
+        }
+    }
+    
+    char** argv_rest = argv + optind;
+    int argc_rest = argc - optind;
+    
+    if(argc_rest != 2)
+    {
+        if(argc_rest < 2) cerr << "Diff file and trace file are required." << endl;
+        else cerr << "Exceeded command-line argument: " << argv_rest[2] << endl;
+        return -1;
+    }
+    
+    diffFile = argv_rest[0];
+    traceFile = argv_rest[1];
+    
+    return 0;
+}
+
+/* Exec */
+int RemapProcessor::exec()
+{
+    SourceDiff diff;
+    diff.read(diffFile, strip);
+    
+    CompactTrace trace;
+    readTrace(trace, traceFile);
+    
+    diff.remapTrace(trace);
+    
+    ostream& outStream = getOutStream();
+    trace.write(outStream);
+    if(!outStream)
+    {
+        cerr << "Errors occure while write trace." << endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
+/* Output ranges of lines in form "1-3,7,10-12". */
+static void printLineRanges(ostream& os, const vector<int>& lines)
+{
+    for(int i = 0; i < (int)lines.size();)
+    {
+        int j = i + 1;
+        while((j < (int)lines.size()) && (lines[j] == lines[j - 1] + 1)) j++;
+        
+        if(i) os << ',';
+        os << lines[i];
+        if(j - i > 1) os << '-' << lines[j - 1];
+        i = j;
+    }
+}
+
+static void printChangedCoverage(ostream& os, int hit, int total)
+{
+    os << hit << " of " << total << " changed lines covered";
+    if(total)
+    {
+        ios_base::fmtflags flags = os.flags();
+        streamsize precision = os.precision(2);
+        os.setf(ios_base::fixed, ios_base::floatfield);
+        os << " (" << (hit * 100.0 / total) << "%)";
+        os.precision(precision);
+        os.flags(flags);
+    }
+}
+
+int DiffCoverageProcessor::exec()
+{
+    SourceDiff diff;
+    diff.read(diffFile, strip);
+    
+    CompactTrace trace;
+    readTrace(trace, traceFile);
+    trace.groupFiles();
+    
+    ostream& outStream = getOutStream();
+    
+    int totalHit = 0, total = 0;
+    vector<int> uncovered;
+    
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+    {
+        const CompactTrace::FileData& file = trace.fileGroups[i].files[0];
+        const SourceDiff::FileDiff* fileDiff = diff.findNew(trace.strings[file.name]);
+        if(!fileDiff || fileDiff->added.empty()) continue;
+        
+        /* Both lines and added ranges are sorted. */
+        const vector<SourceDiff::LineRange>& added = fileDiff->added;
+        int hit = 0, instrumented = 0, k = 0;
+        uncovered.clear();
+        for(int j = 0; j < (int)file.lines.size(); j++)
+        {
+            int line = file.lines[j];
+            while((k < (int)added.size()) && (added[k].last < line)) k++;
+            if(k == (int)added.size()) break;
+            if(line < added[k].first) continue;
+            
+            instrumented++;
+            if(file.lineCounters[j] > 0) hit++;
+            else uncovered.push_back(line);
+        }
+        if(!instrumented) continue;
+        
+        outStream << trace.strings[file.name] << ": ";
+        printChangedCoverage(outStream, hit, instrumented);
+        if(!uncovered.empty())
+        {
+            outStream << ", uncovered: ";
+            printLineRanges(outStream, uncovered);
+        }
+        outStream << endl;
+        
+        totalHit += hit;
+        total += instrumented;
+    }
+    
+    outStream << "Total: ";
+    printChangedCoverage(outStream, totalHit, total);
+    outStream << endl;
+    
+    if(!outStream)
+    {
+        cerr << "Errors occure while write statistic." << endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_remap)
+
+void RemapProcessor::usage(void)
+{
+    print_usage_remap();
+}
+
+DEFINE_FILE_PRINTER(usage_diff_coverage)
+
+void DiffCoverageProcessor::usage(void)
+{
+    print_usage_diff_coverage();
+}
+
+/****************** Optimize-tests implementation *********************/
+/* Params */
+OptimizeTestsProcessor::OptimizeTestsProcessor()
+    : testsFile(NULL), verbose(false), timeLimit(0), exhaustive(false),
+    preserveBranches(false), preserveFunctions(false) {}
+
+int OptimizeTestsProcessor::parseParams(int argc, char** argv)
+{
+    static const char options[] = "+o:vmt:xbf";
+    
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case '?':
+            //error in options
+            return -1;
+        case 'o':
+            setOutFile(optarg);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 't':
+            timeLimit = strtod(optarg, NULL);
+            if(timeLimit <= 0)
+            {
+                cerr << "Time limit should be positive." << endl;
+                return -1;
+            }
+            break;
+        case 'x':
+            exhaustive = true;
+            break;
+        case 'b':
+            preserveBranches = true;
+            break;
+        case 'f':
+            preserveFunctions = true;
+            break;
+        default:
+            return -1;
+        }
+    }
+    
+    char** argv_rest = argv + optind;
+    int argc_rest = argc - optind;
+    
+    if(argc_rest != 1)
+    {
+        if(argc_rest == 0) cerr << "Tests file is missed." << endl;
+        else cerr << "Exceeded command-line argument: " << argv_rest[1] << endl;
+        return -1;
+    }
+    
+    testsFile = argv_rest[0];
+    
+    return 0;
+}
+
+int OptimizeTestsProcessor::exec()
+{
+    vector<TestCoverageDesc> tests;
+    loadTests(testsFile, tests);
+    
+    TestSetOptimizer optimizer(tests, mappedRead);
+    optimizer.setTimeLimit(timeLimit);
+    optimizer.setExhaustive(exhaustive);
+    optimizer.setPreserveBranches(preserveBranches);
+    optimizer.setPreserveFunctions(preserveFunctions);
+    const vector<TestCoverageDesc>& optTests = optimizer.optimize(verbose);
+
+    ostream& os = getOutStream();
+    
+    for(int i = 0; i < (int)optTests.size(); i++)
+    {
+        os << optTests[i].traceFile << endl;
+    }
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_optimize_tests)
+void OptimizeTestsProcessor::usage(void)
+{
+    print_usage_optimize_tests();
+}
+
+
+/********************** Convert implementation ************************/
+ConvertProcessor::ConvertProcessor()
+    : traceFile(NULL), toText(false) {}
+
+int ConvertProcessor::parseParams(int argc, char** argv)
+{
+    static const char options[] = "+o:mt";
+    
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case '?':
+            //error in options
+            return -1;
+        case 'o':
+            setOutFile(optarg);
+            break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 't':
+            toText = true;
+            break;
+        default:
+            return -1;
+        }
+    }
+    
+    char** argv_rest = argv + optind;
+    int argc_rest = argc - optind;
+    
+    if(argc_rest != 1)
+    {
+        if(argc_rest == 0) cerr << "Trace file is missed." << endl;
+        else cerr << "Exceeded command-line argument: " << argv_rest[1] << endl;
+        return -1;
+    }
+    
+    traceFile = argv_rest[0];
+    
+    return 0;
+}
+
+int ConvertProcessor::exec()
+{
+    CompactTrace trace;
+    readTrace(trace, traceFile);
+    
+    ostream& outStream = getOutStream();
+    if(toText)
+        trace.write(outStream);
+    else
+        trace.writeBinary(outStream);
+    
+    if(!outStream)
+    {
+        cerr << "Errors occure while write trace." << endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_convert)
+
+void ConvertProcessor::usage(void)
+{
+    print_usage_convert();
+}
+
+/*********************** Index implementation *************************/
+IndexProcessor::IndexProcessor()
+    : indexFile(NULL), testsFile(NULL), verbose(false), rebuild(false),
+    jobs(0) {}
+
+int IndexProcessor::parseParams(int argc, char** argv)
+{
+    static const char options[] = "+vmrj:";
+    
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case '?':
+            //error in options
+            return -1;
+        case 'v':
+            verbose = true;
+            break;
+        case 'm':
+            mappedRead = true;
+            break;
+        case 'r':
+            rebuild = true;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            if(jobs <= 0)
+            {
+                cerr << "Error: Number of jobs should be positive." << endl;
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+    
+    char** argv_rest = argv + optind;
+    int argc_rest = argc - optind;
+    
+    if(argc_rest != 2)
+    {
+        if(argc_rest == 0) cerr << "Index file is missed." << endl;
+        else if(argc_rest == 1) cerr << "Tests file is missed." << endl;
+        else cerr << "Exceeded command-line argument: " << argv_rest[2] << endl;
+        return -1;
+    }
+    
+    indexFile = argv_rest[0];
+    testsFile = argv_rest[1];
+    
+    return 0;
+}
+
+int IndexProcessor::exec()
+{
+    vector<TestCoverageDesc> tests;
+    loadTests(testsFile, tests);
+    
+    vector<string> traceFiles;
+    for(int i = 0; i < (int)tests.size(); i++)
+        traceFiles.push_back(tests[i].traceFile);
+    
+    CoverageIndex index;
+    if(!rebuild && (access(indexFile, F_OK) == 0))
+        index.read(indexFile);
+    
+    int nLoaded = index.update(traceFiles, mappedRead,
+        jobs ? jobs : processorsNumber());
+    index.write(indexFile);
+    
+    if(verbose)
+    {
+        cerr << "Traces loaded: " << nLoaded << endl;
+        cerr << "Tests: " << index.testsNumber()
+            << ", source files: " << index.filesNumber()
+            << ", lines covered: " << index.linesNumber()
+            << ", functions covered: " << index.functionsNumber() << endl;
+    }
+    
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_index)
+void IndexProcessor::usage(void)
+{
+    print_usage_index();
+}
+
+/*********************** Query implementation *************************/
+QueryProcessor::QueryProcessor()
+    : indexFile(NULL), query(NULL) {}
+
+int QueryProcessor::parseParams(int argc, char** argv)
+{
+    static const char options[] = "+o:";
+    
+    for(int opt = getopt(argc, argv, options);
+        opt != -1;
+        opt = getopt(argc, argv, options))
+    {
+        switch(opt)
+        {
+        case '?':
+            //error in options
+            return -1;
+        case 'o':
+            setOutFile(optarg);
+            break;
+        default:
+            return -1;
+        }
+    }
+    
+    char** argv_rest = argv + optind;
+    int argc_rest = argc - optind;
+    
+    if(argc_rest != 2)
+    {
+        if(argc_rest == 0) cerr << "Index file is missed." << endl;
+        else if(argc_rest == 1) cerr << "Query is missed." << endl;
+        else cerr << "Exceeded command-line argument: " << argv_rest[2] << endl;
+        return -1;
+    }
+    
+    indexFile = argv_rest[0];
+    query = argv_rest[1];
+    
+    return 0;
+}
+
+int QueryProcessor::exec()
+{
+    CoverageIndex index;
+    index.read(indexFile);
+    
+    /* Query is <source-file>[:<line>|:<function>] */
+    string source = query;
+    string item;
+    string::size_type colon = source.rfind(':');
+    if(colon != string::npos)
+    {
+        item = source.substr(colon + 1);
+        source.erase(colon);
+    }
+    
+    CompressedBitmap ids;
+    bool found;
+    if(item.empty())
+    {
+        found = index.queryFile(source, ids);
+    }
+    else if(item.find_first_not_of("0123456789") == string::npos)
+    {
+        found = index.queryLine(source, atoi(item.c_str()), ids);
+    }
+    else
+    {
+        found = index.queryFunction(source, item, ids);
+    }
+    
+    if(!found)
+    {
+        cerr << "Source file '" << source << "' is not covered by any test." << endl;
+    }
+    
+    vector<string> traceFiles;
+    index.getTraceFiles(ids, traceFiles);
+    
+    ostream& os = getOutStream();
+    for(int i = 0; i < (int)traceFiles.size(); i++)
+    {
+        os << traceFiles[i] << endl;
+    }
+    
+    return 0;
+}
+
+DEFINE_FILE_PRINTER(usage_query)
+void QueryProcessor::usage(void)
+{
+    print_usage_query();
 }
@@ -0,0 +1,534 @@
+// set_cover.cpp - solver for weighted set cover problem.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "set_cover.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+#include <cmath> /* HUGE_VAL */
+
+#include <time.h>
+
+using namespace std;
+
+int SetCoverProblem::addSet(const Bitset& set, double weight)
+{
+    if(set.size() != nElements)
+        throw logic_error("Set size doesn't correspond to the problem");
+
+    sets.push_back(set);
+    weights.push_back(weight);
+
+    return sets.size() - 1;
+}
+
+/* Stop search after given time. */
+class Deadline
+{
+public:
+    /* Non-positive 'seconds' means no limit. */
+    Deadline(double seconds): limited(seconds > 0), expired(false), counter(0)
+    {
+        if(!limited) return;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        end.tv_sec += (time_t)seconds;
+        end.tv_nsec += (long)((seconds - (time_t)seconds) * 1e9);
+        if(end.tv_nsec >= 1000000000)
+        {
+            end.tv_sec++;
+            end.tv_nsec -= 1000000000;
+        }
+    }
+
+    /* Clock is checked only once per several calls. */
+    bool isExpired(void)
+    {
+        if(!limited || expired) return expired;
+        if(++counter % 256) return false;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        expired = (now.tv_sec > end.tv_sec)
+            || ((now.tv_sec == end.tv_sec) && (now.tv_nsec >= end.tv_nsec));
+        return expired;
+    }
+
+    /* Whether time was exceeded, as noticed by 'isExpired'. */
+    bool wasExpired(void) const {return expired;}
+private:
+    bool limited;
+    bool expired;
+    int counter;
+    struct timespec end;
+};
+
+/*********************** SetCoverSolver *******************************/
+SetCoverSolver::SetCoverSolver(const SetCoverProblem& problem):
+    problem(problem), universe(problem.nElements),
+    elementSets(problem.nElements), bestWeight(0), nodes(0)
+{
+    int nSets = problem.sets.size();
+    for(int i = 0; i < nSets; i++)
+    {
+        const Bitset& set = problem.sets[i];
+        for(int e = set.findFirst(); e != -1; e = set.findNext(e + 1))
+            elementSets[e].push_back(i);
+
+        universe.unite(set);
+        bestSet.push_back(i);
+        bestWeight += problem.weights[i];
+    }
+}
+
+void SetCoverSolver::updateSolution(vector<int>& sets, double weight)
+{
+    if(weight >= bestWeight) return;
+
+    sort(sets.begin(), sets.end());
+    bestSet = sets;
+    bestWeight = weight;
+}
+
+/************************** Greedy ************************************/
+void SetCoverSolver::greedy(void)
+{
+    int nSets = problem.sets.size();
+
+    Bitset uncovered = universe;
+    vector<bool> taken(nSets, false);
+    vector<int> sets;
+    double weight = 0;
+
+    /* Number of sets in solution covered every element. */
+    vector<int> coverCount(problem.nElements, 0);
+
+    while(!uncovered.none())
+    {
+        int bestIndex = -1;
+        double bestRatio = 0;
+        for(int i = 0; i < nSets; i++)
+        {
+            if(taken[i]) continue;
+
+            int newCovered = problem.sets[i].countCommon(uncovered);
+            if(newCovered == 0) continue;
+
+            double ratio = problem.weights[i] / newCovered;
+            if((bestIndex == -1) || (ratio < bestRatio))
+            {
+                bestIndex = i;
+                bestRatio = ratio;
+            }
+        }
+        assert(bestIndex != -1);
+
+        const Bitset& set = problem.sets[bestIndex];
+        taken[bestIndex] = true;
+        sets.push_back(bestIndex);
+        weight += problem.weights[bestIndex];
+        uncovered.subtract(set);
+
+        for(int e = set.findFirst(); e != -1; e = set.findNext(e + 1))
+            coverCount[e]++;
+    }
+
+    /* Drop redundant sets, heaviest first. */
+    vector<pair<double, int> > order;
+    for(int i = 0; i < (int)sets.size(); i++)
+        order.push_back(make_pair(-problem.weights[sets[i]], sets[i]));
+    sort(order.begin(), order.end());
+
+    vector<int> result;
+    for(int i = 0; i < (int)order.size(); i++)
+    {
+        const Bitset& set = problem.sets[order[i].second];
+        bool redundant = true;
+        for(int e = set.findFirst(); e != -1; e = set.findNext(e + 1))
+        {
+            if(coverCount[e] == 1)
+            {
+                redundant = false;
+                break;
+            }
+        }
+
+        if(redundant)
+        {
+            for(int e = set.findFirst(); e != -1; e = set.findNext(e + 1))
+                coverCount[e]--;
+            weight += order[i].first;
+        }
+        else
+        {
+            result.push_back(order[i].second);
+        }
+    }
+
+    updateSolution(result, weight);
+}
+
+/************************ Branch and bound ****************************/
+/*
+ * Depth-first search. At every node an uncovered element with the
+ * fewest sets able to cover it is chosen, and the search branches on
+ * which of that sets covers it. Sets tried in previous branches are
+ * excluded from the following ones, so every subfamily is visited
+ * at most once.
+ *
+ * Node is pruned when its weight plus lower bound for covering the
+ * rest elements is not less than weight of the best solution.
+ */
+class SetCoverSolver::BranchAndBound
+{
+public:
+    BranchAndBound(SetCoverSolver& solver, double timeLimit):
+        solver(solver), problem(solver.problem), deadline(timeLimit),
+        excluded(problem.sets.size(), false)
+    {
+        /* Elements covered by fewer sets are more likely independent. */
+        vector<pair<int, int> > order;
+        for(int e = 0; e < problem.nElements; e++)
+        {
+            if(!solver.elementSets[e].empty())
+                order.push_back(make_pair(solver.elementSets[e].size(), e));
+        }
+        sort(order.begin(), order.end());
+
+        for(int i = 0; i < (int)order.size(); i++)
+            boundOrder.push_back(order[i].second);
+    }
+
+    /* Return true if search is completed. */
+    bool run(void)
+    {
+        removeDominated();
+
+        search(solver.universe, 0);
+        return !deadline.wasExpired();
+    }
+private:
+    SetCoverSolver& solver;
+    const SetCoverProblem& problem;
+    Deadline deadline;
+
+    /* Sets which may not be added in the current subtree. */
+    vector<bool> excluded;
+    /* Sets chosen on the path to the current node. */
+    vector<int> chosen;
+    /* Order of elements for compute lower bound. */
+    vector<int> boundOrder;
+
+    /*
+     * Exclude sets which are subsets of other sets with same or less
+     * weight: there is always optimal solution without them.
+     */
+    void removeDominated(void)
+    {
+        int nSets = problem.sets.size();
+        for(int i = 0; i < nSets; i++)
+        {
+            for(int j = 0; j < nSets; j++)
+            {
+                if((i == j) || excluded[j]) continue;
+                if(problem.weights[j] > problem.weights[i]) continue;
+                if(!problem.sets[i].isSubsetOf(problem.sets[j])) continue;
+                /* Of equal sets with equal weights keep the first. */
+                if((problem.weights[j] == problem.weights[i])
+                    && (problem.sets[i] == problem.sets[j]) && (j > i))
+                    continue;
+
+                excluded[i] = true;
+                break;
+            }
+        }
+    }
+
+    /*
+     * Lower bound for weight of sets needed for cover 'uncovered'.
+     *
+     * Maximum of two bounds:
+     *
+     * 1) every element costs at least minimal weight per element
+     *    among available sets;
+     * 2) elements, no two of which may be covered by the same set,
+     *    need separate sets.
+     *
+     * If some element cannot be covered, return HUGE_VAL.
+     */
+    double lowerBound(const Bitset& uncovered)
+    {
+        int nUncovered = uncovered.count();
+        double minRatio = -1;
+        int nSets = problem.sets.size();
+        for(int i = 0; i < nSets; i++)
+        {
+            if(excluded[i]) continue;
+
+            int n = problem.sets[i].countCommon(uncovered);
+            if(n == 0) continue;
+
+            double ratio = problem.weights[i] / n;
+            if((minRatio < 0) || (ratio < minRatio)) minRatio = ratio;
+        }
+        double ratioBound = minRatio * nUncovered;
+
+        double disjointBound = 0;
+        Bitset blocked(problem.nElements);
+        for(int k = 0; k < (int)boundOrder.size(); k++)
+        {
+            int e = boundOrder[k];
+            if(!uncovered.test(e) || blocked.test(e)) continue;
+
+            const vector<int>& sets = solver.elementSets[e];
+            double minWeight = -1;
+            for(int i = 0; i < (int)sets.size(); i++)
+            {
+                if(excluded[sets[i]]) continue;
+
+                double weight = problem.weights[sets[i]];
+                if((minWeight < 0) || (weight < minWeight)) minWeight = weight;
+                blocked.unite(problem.sets[sets[i]]);
+            }
+            /* Element cannot be covered. */
+            if(minWeight < 0) return HUGE_VAL;
+
+            disjointBound += minWeight;
+        }
+
+        return max(ratioBound, disjointBound);
+    }
+
+    void search(const Bitset& uncovered, double weight)
+    {
+        if(deadline.isExpired()) return;
+        solver.nodes++;
+
+        if(uncovered.none())
+        {
+            solver.updateSolution(chosen, weight);
+            return;
+        }
+
+        /* Also prunes subtrees where some element cannot be covered. */
+        if(weight + lowerBound(uncovered) >= solver.bestWeight) return;
+
+        /* 
+         * Element with the fewest available sets. Only several elements
+         * with the fewest sets in total are checked, as checking all
+         * elements costs too much for large problems.
+         */
+        int element = -1;
+        int minSets = 0;
+        int nChecked = 0;
+        for(int k = 0; (k < (int)boundOrder.size()) && (nChecked < 256); k++)
+        {
+            int e = boundOrder[k];
+            if(!uncovered.test(e)) continue;
+            nChecked++;
+
+            const vector<int>& sets = solver.elementSets[e];
+            int n = 0;
+            for(int i = 0; i < (int)sets.size(); i++)
+                if(!excluded[sets[i]]) n++;
+
+            if((element == -1) || (n < minSets))
+            {
+                element = e;
+                minSets = n;
+                if(n == 1) break;
+            }
+        }
+
+        /* Try sets with less weight per newly covered element first. */
+        const vector<int>& sets = solver.elementSets[element];
+        vector<pair<double, int> > order;
+        for(int i = 0; i < (int)sets.size(); i++)
+        {
+            int s = sets[i];
+            if(excluded[s]) continue;
+
+            double ratio = problem.weights[s] / problem.sets[s].countCommon(uncovered);
+            order.push_back(make_pair(ratio, s));
+        }
+        sort(order.begin(), order.end());
+
+        Bitset rest(problem.nElements);
+        for(int i = 0; i < (int)order.size(); i++)
+        {
+            int s = order[i].second;
+            if(weight + problem.weights[s] < solver.bestWeight)
+            {
+                rest = uncovered;
+                rest.subtract(problem.sets[s]);
+
+                chosen.push_back(s);
+                search(rest, weight + problem.weights[s]);
+                chosen.pop_back();
+            }
+            /* Following branches do not contain this set. */
+            excluded[s] = true;
+        }
+
+        for(int i = 0; i < (int)order.size(); i++)
+            excluded[order[i].second] = false;
+    }
+};
+
+bool SetCoverSolver::branchAndBound(double timeLimit)
+{
+    nodes = 0;
+    return BranchAndBound(*this, timeLimit).run();
+}
+
+/************************* Exhaustive search **************************/
+/*
+ * Sets are sorted by weight per element. Subfamilies are enumerated
+ * in lexicographical order of indices, with cutting when remaining
+ * weight per uncovered element is less than one of the next set.
+ */
+class SetCoverSolver::Enumerator
+{
+public:
+    Enumerator(SetCoverSolver& solver, double timeLimit):
+        solver(solver), problem(solver.problem), deadline(timeLimit),
+        currentWeight(0)
+    {
+        int nSets = problem.sets.size();
+        vector<pair<double, int> > order;
+        for(int i = 0; i < nSets; i++)
+        {
+            int n = problem.sets[i].count();
+            if(n == 0) continue;
+            order.push_back(make_pair(problem.weights[i] / n, i));
+        }
+        sort(order.begin(), order.end());
+
+        for(int i = 0; i < (int)order.size(); i++)
+        {
+            sWeights.push_back(order[i].first);
+            indices.push_back(order[i].second);
+        }
+
+        coverageStack.reserve(indices.size() + 1);
+        coverageStack.push_back(solver.universe);
+    }
+
+    /* Return true if search is completed. */
+    bool run(void)
+    {
+        if(indices.empty()) return true;
+
+        setAddTrace(0);
+        while(!deadline.isExpired())
+        {
+            solver.nodes++;
+            if(setCheck() && setAddTrace()) continue;
+            if(!setDropAndNext()) break;
+        }
+        return !deadline.wasExpired();
+    }
+private:
+    SetCoverSolver& solver;
+    const SetCoverProblem& problem;
+    Deadline deadline;
+
+    /* Sets in order of enumeration and their weights per element. */
+    vector<int> indices;
+    vector<double> sWeights;
+
+    /* Current subfamily(positions in 'indices'). */
+    vector<int> currentSet;
+    double currentWeight;
+
+    /* Uncovered elements after adding every set in 'currentSet'. */
+    vector<Bitset> coverageStack;
+
+    /*
+     * Check, whether set can be continued with futher sets to be
+     * optimal one. If current set is better than optimal one, update
+     * optimal.
+     */
+    bool setCheck(void)
+    {
+        if(solver.bestWeight <= currentWeight) return false;
+
+        int uncovered = coverageStack.back().count();
+        if(uncovered == 0)
+        {
+            vector<int> sets;
+            for(int i = 0; i < (int)currentSet.size(); i++)
+                sets.push_back(indices[currentSet[i]]);
+            solver.updateSolution(sets, currentWeight);
+            return false;
+        }
+
+        int next = currentSet.back() + 1;
+        if(next >= (int)indices.size()) return false;
+
+        return (solver.bestWeight - currentWeight) / uncovered >= sWeights[next];
+    }
+
+    bool setAddTrace(void)
+    {
+        int next = currentSet.back() + 1;
+        if(next >= (int)indices.size()) return false;
+
+        setAddTrace(next);
+        return true;
+    }
+
+    bool setDropAndNext(void)
+    {
+        setDropTrace();
+        if(currentSet.empty()) return false;
+
+        int next = currentSet.back() + 1;
+
+        setDropTrace();
+        setAddTrace(next);
+        return true;
+    }
+
+    void setAddTrace(int pos)
+    {
+        currentSet.push_back(pos);
+        currentWeight += problem.weights[indices[pos]];
+
+        coverageStack.push_back(coverageStack.back());
+        coverageStack.back().subtract(problem.sets[indices[pos]]);
+    }
+
+    void setDropTrace(void)
+    {
+        currentWeight -= problem.weights[indices[currentSet.back()]];
+        currentSet.pop_back();
+        coverageStack.pop_back();
+    }
+};
+
+bool SetCoverSolver::exhaustive(double timeLimit)
+{
+    nodes = 0;
+    return Enumerator(*this, timeLimit).run();
+}
@@ -0,0 +1,105 @@
+/*
+ * Solver for weighted set cover problem.
+ *
+ * Given sets of elements with weights, find subfamily of the sets
+ * with minimal total weight, which covers all elements covered by
+ * the whole family.
+ *
+ * Used for optimize tests set: elements are groups of lines, sets are
+ * tests.
+ */
+
+#ifndef SET_COVER_HH
+#define SET_COVER_HH
+
+#include "bitset.hh"
+
+#include <vector>
+
+/* Instance of the problem. */
+struct SetCoverProblem
+{
+    /* Number of elements. */
+    int nElements;
+
+    /* Sets of elements and their weights. */
+    std::vector<Bitset> sets;
+    std::vector<double> weights;
+
+    SetCoverProblem(int nElements = 0): nElements(nElements) {}
+
+    /* Add set of given weight. Return index of the set. */
+    int addSet(const Bitset& set, double weight);
+};
+
+class SetCoverSolver
+{
+public:
+    /*
+     * Prepare solver for given problem. Initial solution contains all
+     * sets.
+     *
+     * Weights of all sets should be positive.
+     */
+    SetCoverSolver(const SetCoverProblem& problem);
+
+    /*
+     * Find approximate solution: repeatedly take set with minimal
+     * weight per newly covered element, then drop sets which become
+     * redundant.
+     *
+     * Solution is replaced only if it is better than current one.
+     */
+    void greedy(void);
+
+    /*
+     * Search for optimal solution using branch-and-bound.
+     *
+     * Current solution is used as initial upper bound, so calling
+     * 'greedy' before may significantly reduce search space.
+     *
+     * If 'timeLimit' is positive, search stops after given number of
+     * seconds with the best solution found so far.
+     *
+     * Return true if solution is proven to be optimal.
+     */
+    bool branchAndBound(double timeLimit = 0);
+
+    /*
+     * Search for optimal solution by enumerating sets of tests in order
+     * of weight per element covered.
+     *
+     * This is the algorithm used by 'optimize-tests' before. It is
+     * exponential even on simple problems and is kept for comparison.
+     *
+     * Return true if search is completed within 'timeLimit'(if positive).
+     */
+    bool exhaustive(double timeLimit = 0);
+
+    /* Indices of the sets in the current solution, in ascending order. */
+    const std::vector<int>& solution(void) const {return bestSet;}
+    double solutionWeight(void) const {return bestWeight;}
+
+    /* Number of search nodes processed by the last search. */
+    long nodesVisited(void) const {return nodes;}
+private:
+    const SetCoverProblem& problem;
+
+    /* Elements covered by at least one set. */
+    Bitset universe;
+    /* For every element, sets which cover it. */
+    std::vector<std::vector<int> > elementSets;
+
+    std::vector<int> bestSet;
+    double bestWeight;
+
+    long nodes;
+
+    /* Replace current solution with given one, if it is better. */
+    void updateSolution(std::vector<int>& sets, double weight);
+
+    class BranchAndBound;
+    class Enumerator;
+};
+
+#endif /* SET_COVER_HH */
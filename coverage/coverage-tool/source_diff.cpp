@@ -0,0 +1,500 @@
+// source_diff.cpp - changes of the sources read from unified diff.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "source_diff.hh"
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+/****************************** Parser ********************************/
+class SourceDiff::Parser
+{
+public:
+    Parser(SourceDiff& diff, int strip, const char* filename):
+        diff(diff), strip(strip), filename(filename), lineNumber(0),
+        inFile(false), hasNames(false), hasHunks(false), oldPos(1), newPos(1),
+        oldLeft(0), newLeft(0) {}
+
+    void parse(istream& is)
+    {
+        string line;
+        while(getline(is, line))
+        {
+            lineNumber++;
+            processLine(line);
+        }
+        if(oldLeft || newLeft) error("Unexpected end of hunk");
+        finishFile();
+    }
+private:
+    SourceDiff& diff;
+    int strip;
+    const char* filename;
+    int lineNumber;
+
+    /* File currently parsed. */
+    FileDiff current;
+    bool inFile;
+    /* Whether names of current file are taken from '---' and '+++'. */
+    bool hasNames;
+    /* Whether current file has hunks. */
+    bool hasHunks;
+    /* Next lines in old and new revisions. */
+    int oldPos;
+    int newPos;
+    /* Lines remained in the current hunk. */
+    int oldLeft;
+    int newLeft;
+
+    void error(const char* message)
+    {
+        cerr << filename << ":" << lineNumber << ": " << message << "." << endl;
+        throw runtime_error("Incorrect diff");
+    }
+
+    static bool startsWith(const string& line, const char* prefix)
+    {
+        return line.compare(0, strlen(prefix), prefix) == 0;
+    }
+
+    /* Extract file name from '---' or '+++' line, empty for /dev/null. */
+    string fileName(const string& line)
+    {
+        string name = line.substr(4);
+        /* Drop timestamp. */
+        size_t tab = name.find('\t');
+        if(tab != string::npos) name.resize(tab);
+        if(name == "/dev/null") return "";
+
+        for(int i = 0; i < strip; i++)
+        {
+            size_t slash = name.find('/');
+            if(slash == string::npos) break;
+            name.erase(0, slash + 1);
+        }
+        return name;
+    }
+
+    void startFile(void)
+    {
+        finishFile();
+        current = FileDiff();
+        inFile = true;
+        hasNames = false;
+        hasHunks = false;
+        oldPos = 1;
+        newPos = 1;
+    }
+
+    void finishFile(void)
+    {
+        if(!inFile) return;
+        inFile = false;
+
+        /* Nothing is changed in the file(e.g., only mode is changed). */
+        if(!hasHunks && (current.oldName == current.newName)) return;
+
+        addUnchanged(INT_MAX - oldPos);
+
+        int index = diff.fileDiffs.size();
+        if(!current.oldName.empty())
+            diff.oldNames.insert(make_pair(current.oldName, index));
+        if(!current.newName.empty())
+            diff.newNames.insert(make_pair(current.newName, index));
+        diff.fileDiffs.push_back(FileDiff());
+        diff.fileDiffs.back().oldName.swap(current.oldName);
+        diff.fileDiffs.back().newName.swap(current.newName);
+        diff.fileDiffs.back().unchanged.swap(current.unchanged);
+        diff.fileDiffs.back().added.swap(current.added);
+    }
+
+    /* Mark 'length' lines from current positions as unchanged. */
+    void addUnchanged(int length)
+    {
+        if(length <= 0) return;
+
+        vector<Interval>& unchanged = current.unchanged;
+        if(!unchanged.empty())
+        {
+            Interval& last = unchanged.back();
+            if((last.oldFirst + last.length == oldPos)
+                && (last.newFirst + last.length == newPos))
+            {
+                last.length += length;
+                oldPos += length;
+                newPos += length;
+                return;
+            }
+        }
+
+        Interval interval = {oldPos, newPos, length};
+        unchanged.push_back(interval);
+        oldPos += length;
+        newPos += length;
+    }
+
+    void addAdded(void)
+    {
+        vector<LineRange>& added = current.added;
+        if(!added.empty() && (added.back().last + 1 == newPos))
+        {
+            added.back().last++;
+        }
+        else
+        {
+            LineRange range = {newPos, newPos};
+            added.push_back(range);
+        }
+        newPos++;
+    }
+
+    /* Parse "<start>[,<count>]" after given character. */
+    bool parseRange(const char*& p, char sign, int& start, int& count)
+    {
+        if(*p != sign) return false;
+        char* end;
+        start = strtol(p + 1, &end, 10);
+        if(end == p + 1) return false;
+        count = 1;
+        if(*end == ',')
+        {
+            p = end + 1;
+            count = strtol(p, &end, 10);
+            if(end == p) return false;
+        }
+        p = end;
+        return (start >= 0) && (count >= 0);
+    }
+
+    void startHunk(const string& line)
+    {
+        if(!inFile) error("Hunk outside of file");
+
+        int oldStart, oldCount, newStart, newCount;
+        const char* p = line.c_str() + 3;
+        if(!parseRange(p, '-', oldStart, oldCount) || (*p++ != ' ')
+            || !parseRange(p, '+', newStart, newCount))
+            error("Incorrect hunk header");
+
+        /* Empty range is given by the line before it. */
+        int oldFirst = oldCount ? oldStart : oldStart + 1;
+        int newFirst = newCount ? newStart : newStart + 1;
+
+        int gap = oldFirst - oldPos;
+        if((gap < 0) || (newFirst - newPos != gap))
+            error("Hunk is inconsistent with previous ones");
+        addUnchanged(gap);
+
+        oldLeft = oldCount;
+        newLeft = newCount;
+        hasHunks = true;
+    }
+
+    void processHunkLine(const string& line)
+    {
+        /* Some tools strip trailing whitespace of empty context lines. */
+        char c = line.empty() ? ' ' : line[0];
+        switch(c)
+        {
+        case ' ':
+            if(!oldLeft || !newLeft) error("Unexpected context line");
+            addUnchanged(1);
+            oldLeft--;
+            newLeft--;
+            break;
+        case '-':
+            if(!oldLeft) error("Unexpected removed line");
+            oldPos++;
+            oldLeft--;
+            break;
+        case '+':
+            if(!newLeft) error("Unexpected added line");
+            addAdded();
+            newLeft--;
+            break;
+        case '\\':
+            /* "\ No newline at end of file" */
+            break;
+        default:
+            error("Unexpected line in hunk");
+        }
+    }
+
+    void processLine(const string& line)
+    {
+        if(oldLeft || newLeft)
+        {
+            processHunkLine(line);
+            return;
+        }
+
+        if(startsWith(line, "\\")) return; /* "\ No newline at end of file" */
+
+        if(startsWith(line, "diff "))
+        {
+            startFile();
+        }
+        else if(startsWith(line, "rename from "))
+        {
+            if(!inFile) startFile();
+            current.oldName = line.substr(12);
+        }
+        else if(startsWith(line, "rename to "))
+        {
+            if(!inFile) startFile();
+            current.newName = line.substr(10);
+        }
+        else if(startsWith(line, "--- "))
+        {
+            /* Plain diff, without "diff" lines. */
+            if(!inFile || hasNames) startFile();
+            current.oldName = fileName(line);
+        }
+        else if(startsWith(line, "+++ "))
+        {
+            if(!inFile) error("'+++' line without '---' one");
+            current.newName = fileName(line);
+            hasNames = true;
+        }
+        else if(startsWith(line, "@@ "))
+        {
+            startHunk(line);
+        }
+        /* Other lines('index', mode changes, etc.) are ignored. */
+    }
+};
+
+void SourceDiff::read(istream& is, int strip, const char* filename)
+{
+    fileDiffs.clear();
+    oldNames.clear();
+    newNames.clear();
+
+    Parser parser(*this, strip, filename);
+    parser.parse(is);
+}
+
+void SourceDiff::read(const char* filename, int strip)
+{
+    ifstream is(filename);
+    if(!is)
+    {
+        cerr << "Failed to open file '" << filename << "' for read diff." << endl;
+        throw runtime_error("Cannot open file");
+    }
+
+    read(is, strip, filename);
+}
+
+/****************************** Lookup ********************************/
+const SourceDiff::FileDiff* SourceDiff::find(
+    const unordered_map<string, int>& names, const string& filename,
+    string* matched) const
+{
+    /* Longer suffixes are checked first. */
+    size_t pos = 0;
+    while(true)
+    {
+        unordered_map<string, int>::const_iterator iter =
+            names.find(filename.substr(pos));
+        if(iter != names.end())
+        {
+            if(matched) *matched = iter->first;
+            return &fileDiffs[iter->second];
+        }
+
+        pos = filename.find('/', pos);
+        if(pos == string::npos) return NULL;
+        pos++;
+    }
+}
+
+const SourceDiff::FileDiff* SourceDiff::findOld(const string& filename) const
+{
+    return find(oldNames, filename);
+}
+
+const SourceDiff::FileDiff* SourceDiff::findNew(const string& filename) const
+{
+    return find(newNames, filename);
+}
+
+/****************************** Remapping *****************************/
+/*
+ * Map line of old revision onto new one, or return -1 if line is
+ * changed.
+ *
+ * Lines should be requested in non-decreasing order, 'k' is an index of
+ * the interval for continue search from.
+ */
+static int mapLine(const vector<SourceDiff::Interval>& unchanged, int& k,
+    int line)
+{
+    int n = unchanged.size();
+    while((k < n) && (unchanged[k].oldFirst + unchanged[k].length <= line)) k++;
+    if((k == n) || (line < unchanged[k].oldFirst)) return -1;
+    return unchanged[k].newFirst + (line - unchanged[k].oldFirst);
+}
+
+struct IntervalLess
+{
+    bool operator()(int line, const SourceDiff::Interval& interval) const
+    {
+        return line < interval.oldFirst;
+    }
+};
+
+/* Same as 'mapLine', but for lines in any order. */
+static int findLine(const vector<SourceDiff::Interval>& unchanged, int line)
+{
+    vector<SourceDiff::Interval>::const_iterator iter = upper_bound(
+        unchanged.begin(), unchanged.end(), line, IntervalLess());
+    if(iter == unchanged.begin()) return -1;
+    --iter;
+    if(line - iter->oldFirst >= iter->length) return -1;
+    return iter->newFirst + (line - iter->oldFirst);
+}
+
+static void remapFile(CompactTrace::FileData& file,
+    const SourceDiff::FileDiff& diff)
+{
+    const vector<SourceDiff::Interval>& unchanged = diff.unchanged;
+
+    /* Mapping preserves order of lines, so arrays remain sorted. */
+    int k = 0, nKept = 0;
+    for(int i = 0; i < (int)file.lines.size(); i++)
+    {
+        int line = mapLine(unchanged, k, file.lines[i]);
+        if(line < 0) continue;
+        file.lines[nKept] = line;
+        file.lineCounters[nKept] = file.lineCounters[i];
+        nKept++;
+    }
+    file.lines.resize(nKept);
+    file.lineCounters.resize(nKept);
+
+    k = 0; nKept = 0;
+    for(int i = 0; i < (int)file.branches.size(); i++)
+    {
+        int line = mapLine(unchanged, k, file.branches[i].line);
+        if(line < 0) continue;
+        file.branches[nKept] = file.branches[i];
+        file.branches[nKept].line = line;
+        file.branchCounters[nKept] = file.branchCounters[i];
+        nKept++;
+    }
+    file.branches.resize(nKept, CompactTrace::BranchID(0, 0, 0));
+    file.branchCounters.resize(nKept);
+
+    /* Functions are sorted by names, not by lines. */
+    for(int i = 0; i < (int)file.functions.size(); i++)
+    {
+        if(file.functionLines[i] >= 0)
+            file.functionLines[i] = findLine(unchanged, file.functionLines[i]);
+    }
+}
+
+/* Order of files in group and order of groups in the trace. */
+struct FileNameLess
+{
+    FileNameLess(const StringTable& strings): strings(strings) {}
+
+    bool operator()(const CompactTrace::FileData& file1,
+        const CompactTrace::FileData& file2) const
+    {
+        return strings[file1.name] < strings[file2.name];
+    }
+
+    bool operator()(const CompactTrace::FileGroup& group1,
+        const CompactTrace::FileGroup& group2) const
+    {
+        int cmp = strings[group1.filename].compare(strings[group2.filename]);
+        if(cmp) return cmp < 0;
+        return strings[group1.testName] < strings[group2.testName];
+    }
+private:
+    const StringTable& strings;
+};
+
+void SourceDiff::remapTrace(CompactTrace& trace) const
+{
+    bool renamed = false;
+
+    int nGroups = 0;
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+    {
+        CompactTrace::FileGroup& group = trace.fileGroups[i];
+
+        int nKept = 0;
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            CompactTrace::FileData& file = group.files[j];
+            string name = trace.strings[file.name];
+            string matched;
+            const FileDiff* diff = find(oldNames, name, &matched);
+            if(diff)
+            {
+                /* File is removed in new revision. */
+                if(diff->newName.empty()) continue;
+
+                remapFile(file, *diff);
+
+                if(diff->newName != diff->oldName)
+                {
+                    string newName = name.substr(0, name.size() - matched.size())
+                        + diff->newName;
+                    int id = trace.strings.intern(newName);
+                    if(group.filename == file.name) group.filename = id;
+                    file.name = id;
+                    renamed = true;
+                }
+            }
+
+            if(nKept != j) group.files[nKept].swap(file);
+            nKept++;
+        }
+        group.files.resize(nKept);
+
+        if(group.files.empty()) continue;
+        if(nGroups != i) trace.fileGroups[nGroups].swap(group);
+        nGroups++;
+    }
+    trace.fileGroups.resize(nGroups);
+
+    if(renamed)
+    {
+        FileNameLess less(trace.strings);
+        for(int i = 0; i < (int)trace.fileGroups.size(); i++)
+        {
+            vector<CompactTrace::FileData>& files = trace.fileGroups[i].files;
+            sort(files.begin(), files.end(), less);
+        }
+        stable_sort(trace.fileGroups.begin(), trace.fileGroups.end(), less);
+    }
+}
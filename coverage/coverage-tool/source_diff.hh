@@ -0,0 +1,96 @@
+/*
+ * Changes of the sources between two revisions, read from unified diff.
+ *
+ * For every changed file the diff is converted into:
+ *
+ * - intervals of lines which are not changed, with their positions in
+ *   both revisions, so line of old revision is mapped onto the new one
+ *   without rescanning the diff;
+ * - intervals of lines which are added(or changed) in new revision.
+ *
+ * Both are sorted, so lines of the file, which are sorted in the trace,
+ * are processed in one pass along them.
+ */
+
+#ifndef SOURCE_DIFF_HH
+#define SOURCE_DIFF_HH
+
+#include "compact_trace.hh"
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <unordered_map>
+
+class SourceDiff
+{
+public:
+    /* Lines [oldFirst, oldFirst + length) are moved to newFirst. */
+    struct Interval
+    {
+        int oldFirst;
+        int newFirst;
+        int length;
+    };
+
+    /* Lines [first, last] of the new revision. */
+    struct LineRange
+    {
+        int first;
+        int last;
+    };
+
+    struct FileDiff
+    {
+        /* Names in old and new revisions, empty if file is absent. */
+        std::string oldName;
+        std::string newName;
+
+        /* Unchanged lines, sorted. Last interval is unbounded. */
+        std::vector<Interval> unchanged;
+        /* Added lines, sorted. */
+        std::vector<LineRange> added;
+    };
+
+    /*
+     * Read diff from the stream.
+     *
+     * 'strip' leading components are removed from the file names, as
+     * with 'patch -p'. Throw exception on error.
+     */
+    void read(std::istream& is, int strip = 1, const char* filename = "");
+    void read(const char* filename, int strip = 1);
+
+    const std::vector<FileDiff>& files(void) const {return fileDiffs;}
+
+    /*
+     * Return diff for the file with given name in old(or new) revision.
+     *
+     * Names are matched as in the index: either exactly or as a suffix
+     * of 'filename' after '/'. Return NULL if file is not changed.
+     */
+    const FileDiff* findOld(const std::string& filename) const;
+    const FileDiff* findNew(const std::string& filename) const;
+
+    /*
+     * Make trace for old revision to correspond to the new one.
+     *
+     * Counters for changed and removed lines are dropped, other counters
+     * are moved to the new lines. Start lines of functions which are
+     * changed become unknown(-1). Removed files are dropped, renamed
+     * files are renamed.
+     */
+    void remapTrace(CompactTrace& trace) const;
+private:
+    std::vector<FileDiff> fileDiffs;
+    /* Indices of files by names in old and new revisions. */
+    std::unordered_map<std::string, int> oldNames;
+    std::unordered_map<std::string, int> newNames;
+
+    const FileDiff* find(const std::unordered_map<std::string, int>& names,
+        const std::string& filename, std::string* matched = NULL) const;
+
+    class Parser;
+};
+
+#endif /* SOURCE_DIFF_HH */
@@ -22,271 +22,263 @@
 //      MA 02110-1301, USA.
 
 #include "test_set_optimizer.hh"
+#include "set_cover.hh"
+#include "compact_trace.hh"
+#include "parallel.hh"
 
+#include <iostream>
+#include <sstream>
 #include <algorithm>
-#include <functional>
-#include <iterator>
-
-#include <list>
+#include <unordered_map>
 
+#include <stdint.h>
 #include <cassert>
 
 using namespace std;
 
-typedef Trace::counter_t counter_t;
-
-/* 
- * Information about test trace with which we will operate during
- * optimization procedure.
- */
-struct TestTraceInfo
-{
-    TestTraceInfo(void): test(NULL) {}
-
-    Trace trace;
-    double weight;
-    /* Correspondence with test */
-    const TestCoverageDesc* test;
-    /* Load information about test. */
-    void loadTest(const TestCoverageDesc& test);
-    
-    /* Auxiliary information */
-    
-    /* Groups which are included into trace. */
-    vector<bool> groups;
-    /* 
-     * Special weight - weight per number of groups included.
-     * 
-     * It will be used for sorting.
-     */
-    double sWeight;
-     /*
-      * Return number of groups covered by the trace.
-      */
-     int groupsCovered(void) const;
-     
-     /* 
-      * 'swap' overload for removing non-last element from array
-      * and for sorting algorithm.
-      */
-     friend void swap(TestTraceInfo& traceInfo, TestTraceInfo& traceInfo1);
-     
-     static bool sWeightLess(const TestTraceInfo& traceInfo,
-        const TestTraceInfo& traceInfo1)
-    { return traceInfo.sWeight < traceInfo1.sWeight; }
-};
+typedef CompactTrace::BranchID BranchID;
 
+/* Number of traces loaded at once. */
+static const int loadBatch = 64;
 
-/******* Some useful operations for vector of trace informations ******/
-
-/* 
- * Remove element with given index from array.
- * 
- * If element is not last, it will be swapped with last.
- */
-void testTraceArrayRemoveAt(vector<TestTraceInfo>& traces, int index);
-    
 /* 
- * Remove element with given index from array as it will be included
- * into optimal set.
+ * Items(lines, branches, functions) covered by the test.
  * 
- * Beside element removing, substract coverage of trace in that
- * element from all other traces.
+ * Filled from the test trace, which is dropped immediately after that.
  */
-void testTraceArrayRemoveAtIncluded(vector<TestTraceInfo>& traces, int index);
-
-/*************** Object used for iterate trace sets********************/
-class TraceSetIterator
+struct TestItems
 {
-public:
-    TraceSetIterator(const vector<TestTraceInfo>& testTraces);
-
-    const vector<TestTraceInfo>& traces;
-    
-    /* Setup first trace set, which contained only first trace. */
-    void setFirst();
-    /* 
-     * Check, whether set can be continued with futher traces to be 
-     * optimal one.
-     * 
-     * Return true if so, false otherwise.
-     * 
-     * If current set is better than current optimal one, update optimal.
-     */
-    bool setCheck();
-    
-    /* 
-     * Add next trace to the trace set.
-     * 
-     * Return true on success and false is last trace in the set is also
-     * last in traces array.
-     */
-    bool setAddTrace();
-    
-    /*
-     * Drop last trace in the set and move previous one to the next.
-     * 
-     * Return true on success and false if dropped trace was last one.
-     */
-    bool setDropAndNext();
-    
-    /* Optimal set(indecies in traces array). */
-    vector<int> optSet;
-    /* Optimal weight. */
-    double optWeight;
-
-    /* Current set(indecies in traces array). */
-    vector<int> currentSet;
-    /* Current weight. */
-    double currentWeight;
-
-    /* Groups coverage state. */
-    struct GroupsCoverage
+    /* Covered items in one file. */
+    struct FileItems
     {
-        vector<bool> covered;
-        /* Number of currently uncovered groups. */
-        int groupsUncovered;
+        string filename;
+        
+        vector<int> lines;
+        vector<BranchID> branches;
+        vector<string> functions;
     };
     
-    vector<GroupsCoverage> coverageStack;
+    vector<FileItems> files;
+    
+    int linesCovered;
     
-    void setAddTrace(int index);
-    void setDropTrace(void);
+    /* 
+     * Load covered items from the test trace. Branches and functions
+     * are collected only if requested.
+     */
+    void load(const TestCoverageDesc& test, bool mappedRead,
+        bool withBranches, bool withFunctions);
+    void clear(void);
 };
 
-/************************** Lines modificators for trace **************/
-/* 
- * Remove information about branches and functons from coverage trace
- * for simplify its processing.
- */
-static void traceClearExceptLines(Trace& trace);
-
-/* Clear all lines in trace which are also covered in mask. */
-static void traceClearLinesMasked(Trace& trace, const Trace& mask);
-/* Clear all lines in trace which are not covered in mask. */
-static void traceClearLinesNotMasked(Trace& trace, const Trace& mask);
-
-/****************** TestTraceInfo implementation **********************/
-void TestTraceInfo::loadTest(const TestCoverageDesc& test)
+void TestItems::load(const TestCoverageDesc& test, bool mappedRead,
+    bool withBranches, bool withFunctions)
 {
-    trace.read(test.traceFile.c_str());
+    CompactTrace trace;
+    if(mappedRead)
+        trace.readMapped(test.traceFile.c_str());
+    else
+        trace.read(test.traceFile.c_str());
     trace.groupFiles();
-    traceClearExceptLines(trace);
-    weight = test.weight;
-    this->test = &test;
-}
-
-int TestTraceInfo::groupsCovered(void) const
-{
-    int counter = 0;
-    for(int i = 0; i < (int)groups.size(); i++)
+    
+    linesCovered = 0;
+    for(int i = 0; i < (int)trace.fileGroups.size(); i++)
     {
-        if(groups[i]) counter++;
+        const CompactTrace::FileGroup& group = trace.fileGroups[i];
+        for(int j = 0; j < (int)group.files.size(); j++)
+        {
+            const CompactTrace::FileData& file = group.files[j];
+            FileItems items;
+            
+            for(int k = 0; k < (int)file.lines.size(); k++)
+            {
+                if(file.lineCounters[k] > 0) items.lines.push_back(file.lines[k]);
+            }
+            linesCovered += items.lines.size();
+            
+            if(withBranches)
+            {
+                /* Counter -1 means that branch is not covered. */
+                for(int k = 0; k < (int)file.branches.size(); k++)
+                {
+                    if(file.branchCounters[k] > 0)
+                        items.branches.push_back(file.branches[k]);
+                }
+            }
+            
+            if(withFunctions)
+            {
+                for(int k = 0; k < (int)file.functions.size(); k++)
+                {
+                    if(file.functionCounters[k] > 0)
+                        items.functions.push_back(trace.strings[file.functions[k]]);
+                }
+            }
+            
+            if(items.lines.empty() && items.branches.empty()
+                && items.functions.empty()) continue;
+            
+            items.filename = trace.strings[file.name];
+            files.push_back(FileItems());
+            swap(files.back().filename, items.filename);
+            files.back().lines.swap(items.lines);
+            files.back().branches.swap(items.branches);
+            files.back().functions.swap(items.functions);
+        }
     }
-    
-    return counter;
 }
 
-void swap(TestTraceInfo& traceInfo, TestTraceInfo& traceInfo1)
+void TestItems::clear(void)
 {
-    swap(traceInfo.test,             traceInfo1.test);
-    swap(traceInfo.trace.fileGroups, traceInfo1.trace.fileGroups);
-    swap(traceInfo.weight,           traceInfo1.weight);
-    swap(traceInfo.sWeight,          traceInfo1.sWeight);
-    swap(traceInfo.groups,           traceInfo1.groups);
+    vector<FileItems>().swap(files);
 }
 
-/********** Implementation of functions works with trace array ********/
-
-void testTraceArrayRemoveAt(vector<TestTraceInfo>& traces, int index)
-{
-    if(index != (int)traces.size() - 1)
-    {
-        swap(traces[index], traces.back());
-    }
-    
-    traces.pop_back();
-}
-    
-void testTraceArrayRemoveAtIncluded(vector<TestTraceInfo>& traces, int index)
+/* Load covered items of a batch of tests in parallel. */
+class TestItemsLoader: public ParallelTask
 {
-    for(int i = 0; i < (int)traces.size(); i++)
+public:
+    /* Loads traces of tests starting from 'first' into 'testItems'. */
+    TestItemsLoader(const vector<TestCoverageDesc>& tests, int first,
+        vector<TestItems>& testItems, bool mappedRead,
+        bool withBranches, bool withFunctions):
+        tests(tests), first(first), testItems(testItems),
+        mappedRead(mappedRead), withBranches(withBranches),
+        withFunctions(withFunctions) {}
+    
+    void run(int i, int /*thread*/)
     {
-        if(i == index) continue;
-        
-        traceClearLinesMasked(traces[i].trace, traces[index].trace);
+        testItems[i].load(tests[first + i], mappedRead, withBranches,
+            withFunctions);
     }
-    
-    testTraceArrayRemoveAt(traces, index);
-}
-
-
-/*********************** Optimizer implementation *********************/
-TestSetOptimizer::TestSetOptimizer(const vector<TestCoverageDesc>& tests)
-    : tests(tests) {}
-
-/* Line identificator in the trace. */
-struct TraceLineID
-{
-    Trace::FileGroupID groupID;
-    int line;
-    /* filename is same as one in groupID. */
+private:
+    const vector<TestCoverageDesc>& tests;
+    int first;
+    vector<TestItems>& testItems;
+    bool mappedRead;
+    bool withBranches;
+    bool withFunctions;
 };
 
 /* 
- * Search any line which is covered in the trace.
+ * Dense numbering of covered items.
  * 
- * If found, set lineID to identificator of that line and return true.
- * If trace doesn't cover any line, return false;
+ * Every item is identified by the name of the file and line number,
+ * branch identificator or function name in it.
  */
-bool traceGetLineCovered(const Trace& trace, TraceLineID& lineID)
+class ItemIndex
 {
-    map<Trace::FileGroupID, Trace::FileGroupInfo*>::const_iterator
-        iterGroup = trace.fileGroups.begin(), iterGroupEnd = trace.fileGroups.end();
-    for(; iterGroup != iterGroupEnd; ++iterGroup)
+public:
+    int getLine(int file, int line)
+    {
+        return get(ItemKey(file, ITEM_LINE, line));
+    }
+    
+    int getBranch(int file, const BranchID& branch)
     {
-        /* Assume only one file in group. */
-        map<string, Trace::FileInfo>::const_iterator iterFile =
-            iterGroup->second->files.begin();
+        return get(ItemKey(file, ITEM_BRANCH, branch.line,
+            branch.blockNumber, branch.branchNumber));
+    }
+    
+    int getFunction(int file, const string& name)
+    {
+        return get(ItemKey(file, ITEM_FUNCTION, names.intern(name)));
+    }
+    
+    /* Return identificator of the file. */
+    int getFile(const string& filename) {return files.intern(filename);}
+    
+    int size(void) const {return keys.size();}
+    
+    /* Pretty printer for item with given index. */
+    string describe(int index) const
+    {
+        const ItemKey& key = keys[index];
+        ostringstream os;
+        switch(key.kind)
+        {
+        case ITEM_LINE:
+            os << "Source line " << files[key.file] << ": " << key.a;
+            break;
+        case ITEM_BRANCH:
+            os << "Branch " << files[key.file] << ": "
+                << BranchID(key.a, key.b, key.c);
+            break;
+        case ITEM_FUNCTION:
+            os << "Function " << files[key.file] << ": " << names[key.a];
+            break;
+        }
+        return os.str();
+    }
+private:
+    enum ItemKind {ITEM_LINE, ITEM_BRANCH, ITEM_FUNCTION};
+    
+    struct ItemKey
+    {
+        int file;
+        int kind;
+        /* Line, branch(3 numbers) or identificator of function name. */
+        int a, b, c;
         
-        assert(iterFile != iterGroup->second->files.end());
-        assert(iterFile->first == iterGroup->first.filename);
+        ItemKey(int file, int kind, int a, int b = 0, int c = 0):
+            file(file), kind(kind), a(a), b(b), c(c) {}
         
-        map<int, counter_t>::const_iterator
-            iterLine = iterFile->second.lines.begin(),
-            iterLineEnd = iterFile->second.lines.end();
-
-        for(; iterLine != iterLineEnd; ++iterLine)
+        bool operator==(const ItemKey& key) const
+        {
+            return (file == key.file) && (kind == key.kind)
+                && (a == key.a) && (b == key.b) && (c == key.c);
+        }
+        
+        struct Hash
         {
-            if(iterLine->second > 0)
+            size_t operator()(const ItemKey& key) const
             {
-                lineID.groupID = iterGroup->first;
-                lineID.line = iterLine->first;
-                return true;
+                uint64_t h = ((uint64_t)key.file << 32) | (uint32_t)key.a;
+                h = h * 1099511628211ULL + ((uint64_t)key.kind << 40)
+                    + ((uint64_t)key.b << 20) + key.c;
+                return (size_t)(h ^ (h >> 29));
             }
-        }
+        };
+    };
+    
+    int get(const ItemKey& key)
+    {
+        pair<unordered_map<ItemKey, int, ItemKey::Hash>::iterator, bool> iterNew =
+            indices.insert(make_pair(key, (int)keys.size()));
+        if(iterNew.second) keys.push_back(key);
+        return iterNew.first->second;
     }
-    return false;
+    
+    StringTable files;
+    StringTable names;
+    unordered_map<ItemKey, int, ItemKey::Hash> indices;
+    
+    vector<ItemKey> keys;
+};
+
+/*********************** Optimizer implementation *********************/
+TestSetOptimizer::TestSetOptimizer(const vector<TestCoverageDesc>& tests,
+    bool mappedRead)
+    : tests(tests), mappedRead(mappedRead), timeLimit(0), exhaustive(false),
+    preserveBranches(false), preserveFunctions(false) {}
+
+void TestSetOptimizer::setPreserveBranches(bool preserve)
+{
+    preserveBranches = preserve;
 }
 
-bool traceHasLine(const Trace& trace, const TraceLineID& lineID)
+void TestSetOptimizer::setPreserveFunctions(bool preserve)
 {
-    map<Trace::FileGroupID, Trace::FileGroupInfo*>::const_iterator
-        iterGroup = trace.fileGroups.find(lineID.groupID);
-    if(iterGroup == trace.fileGroups.end()) return false;
-    
-    /* Assume only one file in group. */
-    map<string, Trace::FileInfo>::const_iterator iterFile =
-        iterGroup->second->files.begin();
-    
-    assert(iterFile != iterGroup->second->files.end());
-    assert(iterFile->first == iterGroup->first.filename);
+    preserveFunctions = preserve;
+}
 
-    map<int, counter_t>::const_iterator
-        iterLine = iterFile->second.lines.find(lineID.line);
-    if(iterLine == iterFile->second.lines.end()) return false;
-    
-    return iterLine->second > 0;
+void TestSetOptimizer::setTimeLimit(double seconds)
+{
+    timeLimit = seconds;
+}
+
+void TestSetOptimizer::setExhaustive(bool exhaustive)
+{
+    this->exhaustive = exhaustive;
 }
 
 /*************************** Optimize function ************************/
@@ -294,574 +286,198 @@ const vector<TestCoverageDesc>& TestSetOptimizer::optimize(bool verbose)
 {
 #define info(msg) if(verbose) cerr << msg << endl
 
-    /* Setup traces info array. */
-    vector<TestTraceInfo> testTraces;
-
     int nTests = tests.size();
     
-    testTraces.resize(nTests);
-    
-    for(int i = 0; i < nTests; i++)
-    {
-        TestTraceInfo& traceInfo = testTraces[i];
-
-        traceInfo.loadTest(tests[i]);
-        
-        info("Trace loaded from file " << traceInfo.test->traceFile
-            << ", " << traceInfo.trace.linesTotalHit()
-            << " lines covered.");
-    }
-
     /* 
-     * Tests which are included into result without tests set comparision
-     * for some reasons.
+     * Tests covered every item(line, branch or function).
+     * 
+     * Traces are loaded by batches, and each one is dropped after
+     * its items are numbered, so only few of them are kept in memory.
      */
-    vector<const TestCoverageDesc*> includedTests;
-    
-    /* Filter 0-weight traces, which are always included into result. */
-    for(int i = 0; i < (int)testTraces.size(); i++)
+    ItemIndex itemIndex;
+    vector<Bitset> itemTests;
     {
-        TestTraceInfo& traceInfo = testTraces[i];
-        if(traceInfo.weight == 0)
+        vector<TestItems> testItems;
+        for(int start = 0; start < nTests; start += loadBatch)
         {
-            info("Trace " << traceInfo.test->traceFile
-             << " has zero weight. It is unconditionally included into "
-             << "optimal set.");
+            int n = min(loadBatch, nTests - start);
+            testItems.resize(n);
             
-            includedTests.push_back(traceInfo.test);
-            testTraceArrayRemoveAtIncluded(testTraces, i);
-            /* New element is set for given index. */
-            --i;
-        }
-    }
-    
-    /* 
-     * Combine covered lines into groups.
-     * For each trace whole group is either included or not.
-     */
-
-    int currentTrace = 0;
-    while(currentTrace < (int)testTraces.size())
-    {
-        TestTraceInfo& traceInfo = testTraces[currentTrace];
-        /* Pick any line, covered in the trace. */
-        TraceLineID lineID;
-        
-        if(!traceGetLineCovered(traceInfo.trace, lineID))
-        {
-            /* Trace coverage is empty. */
+            TestItemsLoader loader(tests, start, testItems, mappedRead,
+                preserveBranches, preserveFunctions);
+            runParallel(loader, n, processorsNumber());
             
-            //debug
-            //cerr << "Trace " << currentTrace << " become empty." << endl;
-
-            if(traceInfo.groupsCovered() == 0)
+            for(int b = 0; b < n; b++)
             {
-                /* 
-                 * Trace cover no group. It cannot appear in optimal set,
-                 * so forgot it.
-                 */
-                info("Trace " << traceInfo.test->traceFile
-                    << " has zero coverage. Discard it.");
+                int i = start + b;
+                TestItems& items = testItems[b];
                 
-                testTraceArrayRemoveAt(testTraces, currentTrace);
-                /* New element is set for given index. */
-            }
-            else
-            {
-                /* All groups in the trace are defined, and it may be
-                 * included into optimal set.
-                 * 
-                 * Move to the next trace.
-                 */
-                currentTrace++;
-            }
-            continue;
-        }
-        //debug
-        //cerr << "Find group for trace " << currentTrace << "." << endl;
-        /* Coverage corresponded to the group */
-        Trace groupTrace = traceInfo.trace;
-        traceInfo.groups.push_back(true);
-        /* Whether group is covered by all traces. */
-        bool allCover = true;
-        /* Whether group is covered only by the current trace. */
-        bool oneCover = true;
-        
-        /* 
-         * Restrict group coverage corresponding to other traces.
-         * 
-         * Also set group coverage for other traces.
-         */
-        
-        /* Previous traces cannot contain given group. */
-        for(int j = 0; j < currentTrace; j++)
-        {
-            TestTraceInfo& traceInfo1 = testTraces[j];
-            traceInfo1.groups.push_back(false);
-            allCover = false;
-        }
-        /* Further traces may contain given group. */
-        for(int j = currentTrace + 1; j < (int)testTraces.size(); j++)
-        {
-            TestTraceInfo& traceInfo1 = testTraces[j];
-            if(traceHasLine(traceInfo1.trace, lineID))
-            {
-                //cerr << "Line " << lineID.groupID << ": " << lineID.line << " found in trace " << j << "." << endl;
-                traceInfo1.groups.push_back(true);
-                oneCover = false;
+                info("Trace loaded from file " << tests[i].traceFile
+                    << ", " << items.linesCovered << " lines covered.");
                 
-                traceClearLinesNotMasked(groupTrace, traceInfo1.trace);
-            }
-            else
-            {
-                //cerr << "Line " << lineID.groupID << ": " << lineID.line << " is not found in trace " << j << "." << endl;
-                traceInfo1.groups.push_back(false);
-                allCover = false;
+                vector<int> indices;
+                for(int j = 0; j < (int)items.files.size(); j++)
+                {
+                    const TestItems::FileItems& fileItems = items.files[j];
+                    int file = itemIndex.getFile(fileItems.filename);
+                    
+                    for(int k = 0; k < (int)fileItems.lines.size(); k++)
+                        indices.push_back(itemIndex.getLine(file, fileItems.lines[k]));
+                    for(int k = 0; k < (int)fileItems.branches.size(); k++)
+                        indices.push_back(itemIndex.getBranch(file, fileItems.branches[k]));
+                    for(int k = 0; k < (int)fileItems.functions.size(); k++)
+                        indices.push_back(itemIndex.getFunction(file, fileItems.functions[k]));
+                }
+                items.clear();
                 
-                traceClearLinesMasked(groupTrace, traceInfo1.trace);
-            }
-        }
-
-        //cerr << "Group contains " << groupTrace.linesTotalHit() << " lines." << endl;
-
-        /* 
-         * Remove coverage, corresponded to group, from traces
-         * (including current one) which include it.
-         */
-        for(int j = currentTrace; j < (int)testTraces.size(); j++)
-        {
-            TestTraceInfo& traceInfo1 = testTraces[j];
-            if(traceInfo1.groups.back())
-            {
-                //cerr << "Remove group coverage from trace " << j << "." << endl;
-                traceClearLinesMasked(traceInfo1.trace, groupTrace);
+                itemTests.resize(itemIndex.size(), Bitset(nTests));
+                for(int k = 0; k < (int)indices.size(); k++)
+                    itemTests[indices[k]].set(i);
             }
         }
-
-        if(oneCover)
-        {
-            info("Source line " << lineID.groupID << ": " << lineID.line
-                << "\nis covered only by trace " << traceInfo.test->traceFile
-                << ".\nIt should be included into optimal set.");
-            /* 
-             * Group is covered only by one trace. This trace should
-             * be included into optimal set.
-             */
-             includedTests.push_back(traceInfo.test);
-             testTraceArrayRemoveAtIncluded(testTraces, currentTrace);
-             
-            /* Clear indicators for given group from all traces. */
-            for(int j = 0; j < (int)testTraces.size(); j++)
-            {
-                TestTraceInfo& traceInfo1 = testTraces[j];
-                traceInfo1.groups.pop_back();
-            }
-            /* New element is set for given index. */
-            continue;
-        }
-
-
-        if(allCover)
-        {
-            /* 
-             * Group is covered by all traces.
-             */
-
-            //TODO
-        }
     }
     
-    if(testTraces.empty())
+    /* 
+     * Tests which are included into result without tests set comparision
+     * for some reasons.
+     */
+    Bitset included(nTests);
+    
+    /* 0-weight tests are always included into result. */
+    for(int i = 0; i < nTests; i++)
     {
-        info("Non-zero weights do not affect on optimal tests set.");
-
-        sort(includedTests.begin(), includedTests.end());
-        
-        vector<TestCoverageDesc> optTests;
-        optTests.reserve(includedTests.size());
-        
-        for(int i = 0; i < (int)includedTests.size(); i++)
+        if(tests[i].weight == 0)
         {
-            optTests.push_back(*includedTests[i]);
+            info("Trace " << tests[i].traceFile
+             << " has zero weight. It is unconditionally included into "
+             << "optimal set.");
+            included.set(i);
         }
-        
-        swap(tests, optTests);
-        
-        return tests;
-
     }
     
     /* 
-     * Now all groups are determined and some optimizations take a place.
+     * Combine covered items into groups: items covered by the same set
+     * of tests. For each test whole group is either included or not.
      * 
-     * Sort traces by special weights.
+     * Items covered only by one test make that test to be included.
      */
+    unordered_map<Bitset, int, Bitset::Hash> groupIndices;
+    /* Tests covered every group. */
+    vector<const Bitset*> groupTests;
     
-    info("Search optimal set from tests:");
-    for(int i = 0; i < (int)testTraces.size(); i++)
-    {
-        TestTraceInfo& traceInfo = testTraces[i];
-        traceInfo.sWeight = traceInfo.weight / traceInfo.groupsCovered();
-        
-        info(traceInfo.test->traceFile);
-    }
-    info("---------------------------------");
-    sort(testTraces.begin(), testTraces.end(), TestTraceInfo::sWeightLess);
-    
-    /* Iterate through trace sets. */
-    TraceSetIterator traceSetIterator(testTraces);
-    
-    traceSetIterator.setFirst();
-    while(1)
+    for(int item = 0; item < itemIndex.size(); item++)
     {
-        if(traceSetIterator.setCheck())
+        const Bitset& covering = itemTests[item];
+        if(covering.count() == 1)
         {
-            if(traceSetIterator.setAddTrace())
+            int test = covering.findFirst();
+            if(!included.test(test))
             {
-                continue;
+                info(itemIndex.describe(item)
+                    << "\nis covered only by trace " << tests[test].traceFile
+                    << ".\nIt should be included into optimal set.");
+                included.set(test);
             }
+            continue;
         }
-        if(!traceSetIterator.setDropAndNext()) break;
-    }
-    /* Now traceSetIterator.optSet contains optimal trace. */
-
-    vector<const TestCoverageDesc*> optTestsP = includedTests;
-    
-    optTestsP.reserve(optTestsP.size() + traceSetIterator.optSet.size());
-    for(int i = 0; i < (int)traceSetIterator.optSet.size(); i++)
-    {
-        optTestsP.push_back(testTraces[traceSetIterator.optSet[i]].test);
+        
+        pair<unordered_map<Bitset, int, Bitset::Hash>::iterator, bool> iterNew =
+            groupIndices.insert(make_pair(covering, (int)groupTests.size()));
+        if(iterNew.second) groupTests.push_back(&iterNew.first->first);
     }
+    vector<Bitset>().swap(itemTests);
     
-    sort(optTestsP.begin(), optTestsP.end());
-    
-    vector<TestCoverageDesc> optTests;
-    optTests.reserve(optTestsP.size());
-    
-    for(int i = 0; i < (int)optTestsP.size(); i++)
+    /* Groups which are not covered by included tests. */
+    vector<int> groups;
+    for(int g = 0; g < (int)groupTests.size(); g++)
     {
-        optTests.push_back(*optTestsP[i]);
+        if(!groupTests[g]->intersects(included)) groups.push_back(g);
     }
     
-    swap(tests, optTests);
-    
-    return tests;
-}
-
-
-/********************** Trace cleaner *********************************/
-class TraceCleaner
-{
-public:
-    void operator()(map<Trace::FileGroupID, Trace::FileGroupInfo*>::value_type& group)
+    /* Groups covered by every test, which is not included. */
+    int nGroups = groups.size();
+    vector<Bitset> testGroups(nTests, Bitset(nGroups));
+    for(int g = 0; g < nGroups; g++)
     {
-        for_each(group.second->files.begin(), group.second->files.end(), *this);
+        const Bitset& covering = *groupTests[groups[g]];
+        for(int t = covering.findFirst(); t != -1; t = covering.findNext(t + 1))
+            testGroups[t].set(g);
     }
     
-    void operator()(map<string, Trace::FileInfo>::value_type& file)
-    {
-        file.second.functions.clear();
-        file.second.branches.clear();
-    }
-};
-
-void traceClearExceptLines(Trace& trace)
-{
-    for_each(trace.fileGroups.begin(), trace.fileGroups.end(), TraceCleaner());
-}
-
-/************************Clear masked lines from trace *****************/
-
-class TraceClearLinesMasked
-{
-public:
-    TraceClearLinesMasked(Trace& traceModified) {modified.trace = &traceModified;}
-
-    void operator()(const std::map<Trace::FileGroupID, Trace::FileGroupInfo*>::value_type& group)
+    /* Tests which may appear in optimal set. */
+    vector<int> candidates;
+    for(int i = 0; i < nTests; i++)
     {
-        std::map<Trace::FileGroupID, Trace::FileGroupInfo*>::iterator iter =
-            modified.trace->fileGroups.find(group.first);
-        if(iter != modified.trace->fileGroups.end())
+        if(included.test(i)) continue;
+        
+        if(testGroups[i].none())
         {
-            for_each(group.second->files.begin(),
-                        group.second->files.end(),
-                        TraceClearLinesMasked(*iter->second));
+            /* 
+             * Test covers no group. It cannot appear in optimal set,
+             * so forgot it.
+             */
+            info("Trace " << tests[i].traceFile
+                << " has zero coverage. Discard it.");
+            continue;
         }
+        candidates.push_back(i);
     }
     
-    void operator()(const std::map<string, Trace::FileInfo>::value_type& file)
+    if(candidates.empty())
     {
-        std::map<string, Trace::FileInfo>::iterator iter =
-            modified.group->files.find(file.first);
-        if(iter != modified.group->files.end())
-        {
-            for_each(file.second.lines.begin(),
-                        file.second.lines.end(),
-                        TraceClearLinesMasked(iter->second));
-        }
-    }
-
-    void operator()(const std::map<int, counter_t>::value_type& line)
-    {
-        if(line.second > 0)
-        {
-            std::map<int, counter_t>::iterator iter =
-                modified.file->lines.find(line.first);
-            if(iter != modified.file->lines.end())
-            {
-                modified.file->lines.erase(iter);
-            }
-        }
+        info("Non-zero weights do not affect on optimal tests set.");
     }
-
-    
-private:
-    union
-    {
-        Trace* trace;
-        Trace::FileGroupInfo* group;
-        Trace::FileInfo* file;
-    }modified;
-    
-    TraceClearLinesMasked(Trace::FileGroupInfo& groupModified)
-        { modified.group = &groupModified; }
-    
-    TraceClearLinesMasked(Trace::FileInfo& fileModified)
-        { modified.file = &fileModified; }
-};
-
-void traceClearLinesMasked(Trace& trace, const Trace& mask)
-{
-    for_each(mask.fileGroups.begin(), mask.fileGroups.end(), TraceClearLinesMasked(trace));
-}
-
-/******************** Clear not masked lines from trace ***************/
-class TraceClearLinesNotMasked
-{
-public:
-    TraceClearLinesNotMasked(const Trace& traceMask)
-        {mask.trace = &traceMask;}
-    
-    void clear(Trace& trace)
+    else
     {
-        std::map<Trace::FileGroupID, Trace::FileGroupInfo*>::iterator
-            iter = trace.fileGroups.begin(),
-            iterEnd = trace.fileGroups.end(),
-            iterNext;
+        /* 
+         * Now all groups are determined, and the task is weighted set
+         * cover: every test is a set of groups.
+         */
+        SetCoverProblem problem(nGroups);
         
-        for(; (iter != iterEnd); iter = iterNext)
+        info("Search optimal set from tests:");
+        for(int i = 0; i < (int)candidates.size(); i++)
         {
-            iterNext = iter;
-            ++iterNext;
+            problem.addSet(testGroups[candidates[i]], tests[candidates[i]].weight);
             
-            std::map<Trace::FileGroupID, Trace::FileGroupInfo*>::const_iterator
-                maskIter = mask.trace->fileGroups.find(iter->first);
-            
-            if(maskIter != mask.trace->fileGroups.end())
-            {
-                TraceClearLinesNotMasked(*maskIter->second).clear(*iter->second);
-            }
-            else
-            {
-                trace.fileGroups.erase(iter);
-            }
+            info(tests[candidates[i]].traceFile);
         }
-    }
-
-private:
-    TraceClearLinesNotMasked(const Trace::FileGroupInfo& groupMask)
-        {mask.group = &groupMask;}
-
-    void clear(Trace::FileGroupInfo& group)
-    {
-        std::map<string, Trace::FileInfo>::iterator
-            iter = group.files.begin(),
-            iterEnd = group.files.end(),
-            iterNext;
+        info("---------------------------------");
         
-        for(; (iter != iterEnd); iter = iterNext)
+        SetCoverSolver solver(problem);
+        bool isOptimal;
+        if(exhaustive)
         {
-            iterNext = iter;
-            ++iterNext;
-            
-            std::map<string, Trace::FileInfo>::const_iterator
-                maskIter = mask.group->files.find(iter->first);
-            
-            if(maskIter != mask.group->files.end())
-            {
-                TraceClearLinesNotMasked(maskIter->second).clear(iter->second);
-            }
-            else
-            {
-                group.files.erase(iter);
-            }
+            isOptimal = solver.exhaustive(timeLimit);
         }
-    }
-
-    TraceClearLinesNotMasked(const Trace::FileInfo& fileMask)
-        {mask.file = &fileMask;}
-
-    void clear(Trace::FileInfo& file)
-    {
-        std::map<int, counter_t>::iterator
-            iter = file.lines.begin(),
-            iterEnd = file.lines.end(),
-            iterNext;
-        
-        for(; (iter != iterEnd); iter = iterNext)
+        else
         {
-            iterNext = iter;
-            ++iterNext;
-
-            std::map<int, counter_t>::const_iterator
-                maskIter = mask.file->lines.find(iter->first);
-            
-            if((maskIter == mask.file->lines.end())
-                || (maskIter->second == 0))
-            {
-                file.lines.erase(iter);
-            }
+            solver.greedy();
+            info("Greedy algorithm finds set of weight " << solver.solutionWeight()
+                << ".");
+            isOptimal = solver.branchAndBound(timeLimit);
         }
+        info(solver.nodesVisited() << " sets of tests are checked.");
+        if(!isOptimal)
+        {
+            info("Time limit is exceeded. Best set found has weight "
+                << solver.solutionWeight() << ", but it may be not optimal.");
+        }
+        
+        const vector<int>& optSet = solver.solution();
+        for(int i = 0; i < (int)optSet.size(); i++)
+            included.set(candidates[optSet[i]]);
     }
-
-    union
-    {
-        const Trace* trace;
-        const Trace::FileGroupInfo* group;
-        const Trace::FileInfo* file;
-    }mask;
-};
-
-
-void traceClearLinesNotMasked(Trace& trace, const Trace& mask)
-{
-    TraceClearLinesNotMasked(mask).clear(trace);
-}
-
-/********************TraceSetIterator implementation*******************/
-TraceSetIterator::TraceSetIterator(const vector<TestTraceInfo>& traces)
-    : traces(traces), optWeight(0), currentWeight(0)
-{
-    assert(!traces.empty());
-    
-    optSet.reserve(traces.size());
-    coverageStack.reserve(traces.size() + 1);
-    
-    for(int i = 0; i < (int)traces.size(); i++)
-    {
-        optSet.push_back(i);
-        optWeight += traces[i].weight;
-    }
-
-    coverageStack.push_back(GroupsCoverage());
-    
-    const TestTraceInfo& firstTraceInfo = traces[0];
-    GroupsCoverage& firstCoverage = coverageStack[0];
-
-    firstCoverage.covered.resize(firstTraceInfo.groups.size());
-    firstCoverage.groupsUncovered = firstTraceInfo.groups.size();
-}
-
-/* Setup first trace set, which contained only first trace. */
-void TraceSetIterator::setFirst()
-{
-    setAddTrace(0);
-}
-/* 
- * Check, whether set can be continued with futher traces to be 
- * optimal one.
- * 
- * Return true if so, false otherwise.
- * 
- * If current set is better than current optimal one, update optimal.
- */
-bool TraceSetIterator::setCheck()
-{
-    if(optWeight <=  currentWeight) return false;
-    
-    GroupsCoverage& coverage = coverageStack.back();
-    if(coverage.groupsUncovered == 0)
-    {
-        optSet = currentSet;
-        optWeight = currentWeight;
-        return false;
-    }
-    
-    int nextTraceIndex = currentSet.back() + 1;
-    if(nextTraceIndex >= (int)traces.size()) return false;
-    
-    const TestTraceInfo& nextTraceInfo = traces[nextTraceIndex];
-    if((optWeight - currentWeight) / coverage.groupsUncovered < nextTraceInfo.sWeight)
-    {
-        return false;
-    }
-    
-    return true;
-}
-
-/* 
- * Add next trace to the trace set.
- * 
- * Return true on success and false is last trace in the set is also
- * last in traces array.
- */
-bool TraceSetIterator::setAddTrace()
-{
-    int nextTraceIndex = currentSet.back() + 1;
-    if(nextTraceIndex >= (int)traces.size()) return false;
-
-    setAddTrace(nextTraceIndex);
-    
-    return true;
-}
-
-/*
- * Drop last trace in the set and move previous one to the next.
- * 
- * Return true on success and false if dropped trace was last one.
- */
-bool TraceSetIterator::setDropAndNext()
-{
-    setDropTrace();
-    
-    if(currentSet.empty()) return false;
-    
-    int nextTraceIndex = currentSet.back() + 1;
-    
-    setDropTrace();
-    setAddTrace(nextTraceIndex);
-    
-    return true;
-}
-
-void TraceSetIterator::setAddTrace(int index)
-{
-    currentSet.push_back(index);
-    coverageStack.push_back(GroupsCoverage());
-
-    const TestTraceInfo& traceInfo = traces[index];
-    GroupsCoverage& coverage = coverageStack.back();
-
-    currentWeight += traceInfo.weight;
-
-    coverage = coverageStack[coverageStack.size() - 2];
     
-    for(int i = 0; i < (int)coverage.covered.size(); i++)
+    /* Order of tests is preserved. */
+    vector<TestCoverageDesc> optTests;
+    for(int i = 0; i < nTests; i++)
     {
-        if(!coverage.covered[i] && traceInfo.groups[i])
-        {
-            coverage.covered[i] = true;
-            --coverage.groupsUncovered;
-        }
+        if(included.test(i)) optTests.push_back(tests[i]);
     }
-}
-
-void TraceSetIterator::setDropTrace(void)
-{
-    const TestTraceInfo& traceInfo = traces[currentSet.back()];
     
-    currentWeight -= traceInfo.weight;
-    currentSet.pop_back();
+    swap(tests, optTests);
     
-    coverageStack.pop_back();
+    return tests;
+#undef info
 }
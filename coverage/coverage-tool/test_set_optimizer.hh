@@ -1,5 +1,6 @@
 /*
- * Optimize tests set, line coverage remain unchanged.
+ * Optimize tests set, line coverage(and, optionally, branch and function
+ * coverage) remain unchanged.
  */
 
 #ifndef OPTIMIZE_TESTS_HH
@@ -37,11 +38,38 @@ class TestSetOptimizer
 public:
     /* 
      * Load given test set into optimizer.
+     * 
+     * If 'mappedRead' is true, traces are loaded using 'TraceMmapParser'.
      */
-    TestSetOptimizer(const std::vector<TestCoverageDesc>& tests);
+    TestSetOptimizer(const std::vector<TestCoverageDesc>& tests,
+        bool mappedRead = false);
+    
     /* 
-     * Return test set which has same line coverage as one, passed to
-     * constructor, but minimal weight.
+     * Limit time of searching optimal set, in seconds. When limit is
+     * exceeded, best set found so far is returned. It is not less
+     * optimal than one found by greedy algorithm.
+     * 
+     * Non-positive value means no limit(default).
+     */
+    void setTimeLimit(double seconds);
+    
+    /* 
+     * Use exhaustive search of optimal set instead of branch-and-bound.
+     * It is much slower and is kept only for comparision.
+     */
+    void setExhaustive(bool exhaustive);
+    
+    /* 
+     * Preserve also branch and(or) function coverage. By default, only
+     * line coverage is preserved.
+     */
+    void setPreserveBranches(bool preserve);
+    void setPreserveFunctions(bool preserve);
+    
+    /* 
+     * Return test set which has same line coverage(and branch and
+     * function coverage, if requested) as one, passed to constructor,
+     * but minimal weight.
      * 
      * Order is be preserved.
      * 
@@ -51,6 +79,12 @@ public:
 private:
     /* Input and output(optimal) tests set. */
     std::vector<TestCoverageDesc> tests;
+    
+    bool mappedRead;
+    double timeLimit;
+    bool exhaustive;
+    bool preserveBranches;
+    bool preserveFunctions;
 };
 
 
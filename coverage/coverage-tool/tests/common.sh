@@ -0,0 +1,53 @@
+# Common part of the test scripts, should be sourced by them.
+#
+# Every test script is run as
+#
+#     <script> <tool> <data-dir> <work-dir> [<args>...]
+#
+# where <tool> is the path to coverage_tool, <data-dir> contains input
+# traces and expected outputs, and <work-dir> is a scratch directory for
+# files produced by the test. It is recreated on each run.
+
+set -e
+
+TOOL="$1"
+DATA="$2"
+WORK="$3"
+shift 3
+
+rm -rf "$WORK"
+mkdir -p "$WORK"
+cd "$WORK"
+
+# Report failure of the test and exit.
+fail()
+{
+    echo "FAILED: $*" >&2
+    exit 1
+}
+
+# Check that file <actual> is equal to <expected> byte for byte.
+check_output()
+{
+    if ! cmp -s "$1" "$2"; then
+        diff -u "$1" "$2" >&2 || true
+        fail "'$2' differs from '$1'"
+    fi
+}
+
+# Run the tool, which is expected to fail with error message containing
+# given <pattern>.
+#
+#     expect_error <pattern> <tool-args>...
+expect_error()
+{
+    pattern="$1"
+    shift
+    if "$TOOL" "$@" > /dev/null 2> error.log; then
+        fail "'$*' succeeded, but it should fail"
+    fi
+    grep -q "$pattern" error.log || {
+        cat error.log >&2
+        fail "'$*' should fail with '$pattern'"
+    }
+}
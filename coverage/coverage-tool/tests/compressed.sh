@@ -0,0 +1,68 @@
+# Compressed traces on input and output.
+#
+# Arguments are the names of the formats("gzip", "zstd") which support
+# is built into the tool. For other formats the tool should report
+# that support is not built in.
+. "$(dirname "$0")/common.sh"
+
+A="$DATA/a.info"
+B="$DATA/b.info"
+
+supported()
+{
+    for f in "$@"; do
+        if [ "$f" = "$format" ]; then return 0; fi
+    done
+    return 1
+}
+
+for format in gzip zstd; do
+    case $format in
+    gzip) ext=gz;;
+    zstd) ext=zst;;
+    esac
+
+    if ! command -v $format > /dev/null; then
+        echo "'$format' program is not found, skip the test for it."
+        continue
+    fi
+
+    $format -c "$A" > a.info.$ext
+    $format -c "$B" > b.info.$ext
+
+    if ! supported "$@"; then
+        expect_error "not built in" stat a.info.$ext
+        expect_error "not built in" add -o ab.info.$ext "$A" "$B"
+        continue
+    fi
+
+    # Compressed input gives the same result as the uncompressed one.
+    for opts in "" "-m"; do
+        "$TOOL" stat $opts a.info.$ext > stat.out
+        check_output "$DATA/stat.expected" stat.out
+
+        "$TOOL" add $opts a.info.$ext b.info.$ext > add.out
+        check_output "$DATA/add.expected" add.out
+
+        "$TOOL" add $opts a.info.$ext "$B" > add.out
+        check_output "$DATA/add.expected" add.out
+    done
+
+    # Compressed output is readable by the compressor and by the tool.
+    "$TOOL" add -o ab.info.$ext "$A" "$B"
+    $format -d -c ab.info.$ext > add.out
+    check_output "$DATA/add.expected" add.out
+
+    "$TOOL" convert -t -o add.out ab.info.$ext
+    check_output "$DATA/add.expected" add.out
+
+    # Same for binary traces.
+    "$TOOL" convert -o ab.bin.$ext "$DATA/add.expected"
+    "$TOOL" convert -m -t -o add.out ab.bin.$ext
+    check_output "$DATA/add.expected" add.out
+
+    # Truncated compressed data is detected.
+    head -c 40 a.info.$ext > truncated.info.$ext
+    expect_error "truncated.info.$ext: " stat truncated.info.$ext
+    expect_error "truncated.info.$ext: " stat -m truncated.info.$ext
+done
@@ -0,0 +1,25 @@
+# Truncated or damaged binary trace should be rejected as corrupted.
+#
+# Extra argument: path to mutate_file helper.
+. "$(dirname "$0")/common.sh"
+
+MUTATE="$1"
+
+"$TOOL" convert -o a.bin "$DATA/a.info"
+size=$(wc -c < a.bin)
+
+# Cut the payload, and the header itself.
+for cut in $((size - 1)) $((size / 2)) 20; do
+    cp a.bin truncated.bin
+    "$MUTATE" truncate truncated.bin $cut
+    expect_error "Binary trace is corrupted" stat truncated.bin
+    expect_error "Binary trace is corrupted" stat -m truncated.bin
+done
+
+# Flip a bit in the payload and in the payload size.
+for offset in $((size - 1)) $((size / 2)) 16; do
+    cp a.bin flipped.bin
+    "$MUTATE" flip flipped.bin $offset
+    expect_error "Binary trace is corrupted" convert -t flipped.bin
+    expect_error "Binary trace is corrupted" convert -m -t flipped.bin
+done
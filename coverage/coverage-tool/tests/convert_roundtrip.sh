@@ -0,0 +1,17 @@
+# lcov -> binary -> lcov conversion should reproduce the input exactly.
+. "$(dirname "$0")/common.sh"
+
+for trace in a.info b.info; do
+    "$TOOL" convert -o "$trace.bin" "$DATA/$trace"
+    "$TOOL" convert -t -o "$trace" "$trace.bin"
+    check_output "$DATA/$trace" "$trace"
+
+    # Hand-written parser reads binary traces too.
+    "$TOOL" convert -m -t -o "$trace.m" "$trace.bin"
+    check_output "$DATA/$trace" "$trace.m"
+
+    # Binary trace is accepted by other commands as lcov one.
+    "$TOOL" stat "$DATA/$trace" > stat.expected
+    "$TOOL" stat "$trace.bin" > stat.actual
+    check_output stat.expected stat.actual
+done
@@ -0,0 +1,81 @@
+# Incremental update of the index should give the same answers as the
+# index built from scratch.
+. "$(dirname "$0")/common.sh"
+
+QUERIES="list.c list.c:13 list.c:20 list.c:list_del lib/list.c:list_add
+main.c main.c:7 hash.c hash.c:hash_init /src/proj/lib/list.c:11 none.c"
+
+# Compare answers of the updated index with ones of fresh index, built
+# for the same tests file.
+check_index()
+{
+    "$TOOL" index -r fresh.idx tests.list
+    for q in $QUERIES; do
+        "$TOOL" query updated.idx "$q" > updated.out 2> updated.err
+        "$TOOL" query fresh.idx "$q" > fresh.out 2> fresh.err
+        check_output fresh.out updated.out
+        check_output fresh.err updated.err
+    done
+}
+
+# Set modification time of the trace explicitly, so change is detected
+# even if it is made within the same second.
+set_mtime()
+{
+    touch -t "$2" "$1"
+}
+
+cp "$DATA/a.info" t1.info
+cp "$DATA/b.info" t2.info
+sed -e 's/^DA:13,1$/DA:13,0/' -e 's/^DA:7,0$/DA:7,5/' "$DATA/a.info" > t3.info
+printf '1 %s\n' t1.info t2.info t3.info > tests.list
+
+"$TOOL" index updated.idx tests.list
+check_index
+
+# Nothing is changed.
+"$TOOL" index updated.idx tests.list
+check_index
+
+# Content of a trace is changed, size is the same.
+sed -e 's/^DA:13,0$/DA:13,7/' t2.info > t2.new
+mv t2.new t2.info
+set_mtime t2.info 203001010000
+"$TOOL" index updated.idx tests.list
+check_index
+
+# Size is changed.
+cp "$DATA/b.info" t1.info
+"$TOOL" index updated.idx tests.list
+check_index
+
+# A test is removed, so its id is free.
+printf '1 %s\n' t1.info t3.info > tests.list
+"$TOOL" index updated.idx tests.list
+check_index
+
+# New tests are added, one of them reuses the id of the removed test.
+cp "$DATA/a.info" t4.info
+sed -e 's/^FNDA:0,hash_init$/FNDA:4,hash_init/' \
+    -e 's/^DA:3,0$/DA:3,4/' "$DATA/b.info" > t5.info
+printf '1 %s\n' t1.info t4.info t3.info t5.info > tests.list
+"$TOOL" index updated.idx tests.list
+check_index
+
+# Removed and added at once, with reordering.
+printf '1 %s\n' t5.info t2.info t1.info > tests.list
+"$TOOL" index updated.idx tests.list
+check_index
+
+# Same traces loaded via hand-written parser.
+"$TOOL" index -m updated.idx tests.list
+check_index
+
+# Answers are the ones expected for the final set of tests.
+"$TOOL" query updated.idx hash.c:hash_init > hash_init.out
+printf 't5.info\n' > hash_init.expected
+check_output hash_init.expected hash_init.out
+
+"$TOOL" query updated.idx list.c:13 > list13.out
+printf 't2.info\n' > list13.expected
+check_output list13.expected list13.out
@@ -0,0 +1,59 @@
+/*
+ * Damage the file for test reaction on corrupted input.
+ *
+ *     mutate_file truncate <file> <size>
+ *         Truncate file to given size.
+ *
+ *     mutate_file flip <file> <offset>
+ *         Invert the lowest bit of the byte at given offset.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+    if(argc != 4)
+    {
+        fprintf(stderr, "Usage: %s truncate|flip <file> <number>\n", argv[0]);
+        return 1;
+    }
+
+    const char* filename = argv[2];
+    long number = strtol(argv[3], NULL, 0);
+
+    if(!strcmp(argv[1], "truncate"))
+    {
+        if(truncate(filename, number))
+        {
+            perror(filename);
+            return 1;
+        }
+        return 0;
+    }
+    else if(!strcmp(argv[1], "flip"))
+    {
+        FILE* f = fopen(filename, "r+b");
+        if(!f || fseek(f, number, SEEK_SET))
+        {
+            perror(filename);
+            return 1;
+        }
+        int c = fgetc(f);
+        if(c == EOF)
+        {
+            fprintf(stderr, "%s: offset %ld is beyond the end.\n",
+                filename, number);
+            return 1;
+        }
+        fseek(f, number, SEEK_SET);
+        fputc(c ^ 1, f);
+        fclose(f);
+        return 0;
+    }
+
+    fprintf(stderr, "Unknown mutation: %s\n", argv[1]);
+    return 1;
+}
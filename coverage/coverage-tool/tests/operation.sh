@@ -0,0 +1,57 @@
+# Predefined and user-defined trace operations.
+#
+# Arguments are modules which implement per-counter sum via the
+# per-object interface and via the batch one.
+. "$(dirname "$0")/common.sh"
+
+A="$DATA/a.info"
+B="$DATA/b.info"
+
+"$TOOL" add "$A" "$B" > add.out
+check_output "$DATA/add.expected" add.out
+
+"$TOOL" operation add -o add.out "$A" "$B"
+check_output "$DATA/add.expected" add.out
+
+"$TOOL" diff "$A" "$B" > diff.out
+check_output "$DATA/diff.expected" diff.out
+
+"$TOOL" new-coverage "$B" "$A" > new_coverage.out
+check_output "$DATA/new_coverage.expected" new_coverage.out
+
+expect_error "precisely 2 trace arguments" diff "$A" "$B" "$A"
+
+# Result doesn't depend on parser and number of threads.
+for opts in "-m" "-j 1" "-j 3" "-m -j 2"; do
+    "$TOOL" add $opts "$A" "$B" "$B" "$A" "$B" > add_many.out
+    check_output "$DATA/add_many.expected" add_many.out
+done
+
+# Traces given in the list file, partly or completely.
+printf '%s\n' "$B" "" "# comment" "$B" "$A" "$B" > traces.list
+"$TOOL" add -l traces.list "$A" > add_many.out
+check_output "$DATA/add_many.expected" add_many.out
+
+printf '%s\n' "$A" | cat - traces.list | "$TOOL" add -l - > add_many.out
+check_output "$DATA/add_many.expected" add_many.out
+
+# Streaming mode gives the same result for any fanout.
+for fanout in 1 2 3 5 10; do
+    "$TOOL" add -s $fanout -l traces.list "$A" > add_many.out
+    check_output "$DATA/add_many.expected" add_many.out
+done
+
+expect_error "Streaming mode is supported only" diff -s 2 "$A" "$B"
+
+# User-defined operations, with both interfaces.
+for module in "$@"; do
+    "$TOOL" operation "$module" "$A" "$B" > add.out
+    check_output "$DATA/add.expected" add.out
+
+    for opts in "-j 1" "-j 3" "-m"; do
+        "$TOOL" operation "$module" $opts "$A" "$B" "$B" "$A" "$B" > add_many.out
+        check_output "$DATA/add_many.expected" add_many.out
+    done
+done
+
+expect_error "Failed to load module" operation ./no_such_module.so "$A" "$B"
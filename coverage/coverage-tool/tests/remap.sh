@@ -0,0 +1,38 @@
+# Moving trace to the new revision of the sources and coverage of the
+# changes.
+#
+# change.diff inserts and changes lines in lib/list.c, renames
+# lib/hash.c, removes main.c and adds lib/util.c. new.info is a trace
+# for the new revision.
+. "$(dirname "$0")/common.sh"
+
+DIFF="$DATA/change.diff"
+
+for opts in "" "-m"; do
+    "$TOOL" remap $opts "$DIFF" "$DATA/add.expected" > remap.out
+    check_output "$DATA/remap.expected" remap.out
+
+    "$TOOL" diff-coverage $opts "$DIFF" "$DATA/new.info" > diff_coverage.out
+    check_output "$DATA/diff_coverage.expected" diff_coverage.out
+done
+
+# Same diff without 'a/' and 'b/' prefixes in file names.
+sed -e 's, a/, ,g' -e 's, b/, ,g' "$DIFF" > change_p0.diff
+
+"$TOOL" remap -p 0 -o remap.out change_p0.diff "$DATA/add.expected"
+check_output "$DATA/remap.expected" remap.out
+
+"$TOOL" diff-coverage -p 0 -o diff_coverage.out change_p0.diff "$DATA/new.info"
+check_output "$DATA/diff_coverage.expected" diff_coverage.out
+
+# Binary trace is remapped in the same way.
+"$TOOL" convert -o ab.bin "$DATA/add.expected"
+"$TOOL" remap "$DIFF" ab.bin > remap.out
+check_output "$DATA/remap.expected" remap.out
+
+# Empty diff changes nothing.
+: > empty.diff
+"$TOOL" remap empty.diff "$DATA/add.expected" > remap.out
+check_output "$DATA/add.expected" remap.out
+
+expect_error "Diff file and trace file are required" remap "$DATA/add.expected"
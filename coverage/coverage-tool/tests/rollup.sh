@@ -0,0 +1,31 @@
+# Coverage statistic per directory, file and function.
+. "$(dirname "$0")/common.sh"
+
+# Sum of a.info and b.info, it covers all source files.
+AB="$DATA/add.expected"
+
+"$TOOL" rollup "$DATA/a.info" > rollup.out
+check_output "$DATA/rollup.expected" rollup.out
+
+"$TOOL" rollup -m -t text -o rollup.out "$DATA/a.info"
+check_output "$DATA/rollup.expected" rollup.out
+
+"$TOOL" rollup -t csv "$AB" > rollup.out
+check_output "$DATA/rollup_csv.expected" rollup.out
+
+"$TOOL" rollup -t json "$AB" > rollup.out
+check_output "$DATA/rollup_json.expected" rollup.out
+
+"$TOOL" rollup -t json -d 1 "$AB" > rollup.out
+check_output "$DATA/rollup_depth.expected" rollup.out
+
+"$TOOL" rollup -F -p lib "$AB" > rollup.out
+check_output "$DATA/rollup_prefix.expected" rollup.out
+
+# Binary trace gives the same statistic.
+"$TOOL" convert -o ab.bin "$AB"
+"$TOOL" rollup -t csv ab.bin > rollup.out
+check_output "$DATA/rollup_csv.expected" rollup.out
+
+expect_error "Exceeded command-line argument" rollup "$DATA/a.info" "$DATA/b.info"
+expect_error "Unknown output format" rollup -t xml "$DATA/a.info"
@@ -0,0 +1,50 @@
+# Statistic for one trace and tables for several ones.
+. "$(dirname "$0")/common.sh"
+
+# Names of the traces are the part of the tables.
+mkdir traces
+cp "$DATA/a.info" "$DATA/b.info" traces
+
+"$TOOL" stat traces/a.info > stat.out
+check_output "$DATA/stat.expected" stat.out
+
+"$TOOL" stat -p lib traces/a.info > stat.out
+check_output "$DATA/stat_prefix.expected" stat.out
+
+# Table is output even for single trace if format is given.
+"$TOOL" stat -t csv traces/a.info > stat.out
+head -n 2 "$DATA/stat_csv.expected" > stat.expected
+check_output stat.expected stat.out
+
+for format in csv json; do
+    expected="$DATA/stat_$format.expected"
+
+    "$TOOL" stat -t $format traces/a.info traces/b.info > stat.out
+    check_output "$expected" stat.out
+
+    for opts in "-m" "-j 1" "-j 2"; do
+        "$TOOL" stat -t $format $opts traces/a.info traces/b.info > stat.out
+        check_output "$expected" stat.out
+    done
+
+    # Traces from the directory and from the list.
+    "$TOOL" stat -t $format traces > stat.out
+    check_output "$expected" stat.out
+
+    printf '%s\n' traces/b.info | "$TOOL" stat -t $format -l - traces/a.info > stat.out
+    check_output "$expected" stat.out
+
+    # Row for the trace which cannot be processed is omitted.
+    if "$TOOL" stat -t $format traces/a.info missing.info traces/b.info \
+        > stat.out 2> error.log; then
+        fail "stat should fail for missing trace"
+    fi
+    check_output "$expected" stat.out
+    grep -q "missing.info" error.log || fail "missing trace is not reported"
+done
+
+# Default table format is csv.
+"$TOOL" stat traces/a.info traces/b.info > stat.out
+check_output "$DATA/stat_csv.expected" stat.out
+
+expect_error "Unknown table format" stat -t xml traces/a.info
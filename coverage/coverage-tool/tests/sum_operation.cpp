@@ -0,0 +1,35 @@
+/*
+ * Per-counter sum of the traces, implemented via TraceOperation
+ * interface of user-defined operations.
+ *
+ * Result should be the same as one of predefined 'add' operation.
+ */
+
+#include <trace_operation_include/trace_operation.hh>
+
+using namespace std;
+
+class TraceOperationSum: public TraceOperationUnified
+{
+public:
+    counter_t counterOperation(const vector<counter_t>& operands)
+    {
+        counter_t sum = operands[0];
+        for(int i = 1; i < (int)operands.size(); i++)
+        {
+            if(operands[i] < 0) continue;
+            sum = (sum > 0 ? sum : 0) + operands[i];
+        }
+        return sum;
+    }
+};
+
+extern "C" TraceOperation* getOperation(int, const map<string,string>&)
+{
+    return new TraceOperationSum();
+}
+
+extern "C" void putOperation(TraceOperation* op)
+{
+    delete op;
+}
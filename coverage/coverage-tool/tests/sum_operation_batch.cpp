@@ -0,0 +1,40 @@
+/*
+ * Per-counter sum of the traces, implemented via TraceOperationBatch
+ * interface of user-defined operations.
+ *
+ * Result should be the same as one of predefined 'add' operation.
+ */
+
+#include <trace_operation_include/trace_operation.hh>
+
+using namespace std;
+
+class TraceOperationBatchSum: public TraceOperationBatchUnified
+{
+public:
+    void counterOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result)
+    {
+        for(int k = 0; k < count; k++) result[k] = operands[0][k];
+
+        for(int i = 1; i < n; i++)
+        {
+            for(int k = 0; k < count; k++)
+            {
+                counter_t op = operands[i][k];
+                if(op < 0) continue;
+                result[k] = (result[k] > 0 ? result[k] : 0) + op;
+            }
+        }
+    }
+};
+
+extern "C" TraceOperationBatch* getOperationBatch(int, const map<string,string>&)
+{
+    return new TraceOperationBatchSum();
+}
+
+extern "C" void putOperationBatch(TraceOperationBatch* op)
+{
+    delete op;
+}
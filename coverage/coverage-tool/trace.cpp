@@ -24,6 +24,9 @@
 
 #include "trace.hh"
 #include "trace_parser.hh"
+#include "trace_mmap_parser.hh"
+#include "compact_trace.hh" /* binary traces */
+#include "compressed_stream.hh"
 
 #include <iostream>
 #include <string>
@@ -668,6 +671,17 @@ public:
         parser.parse(is, *this, filename);
     }
 
+    /* Return false if the parser fails. */
+    bool build(Trace* trace, TraceMmapParser& parser, const char* filename)
+    {
+        delete currentGroupInfo;
+        currentGroupInfo = NULL;
+
+        this->trace = trace;
+
+        return parser.parse(filename, *this);
+    }
+
 
     /* TN: <testName> */
     void onTestStart(const std::string& testName, int /*traceLine*/)
@@ -837,6 +851,14 @@ private:
 
 void Trace::read(std::istream& is, TraceParser& parser, const char* filename)
 {
+    if(CompactTrace::isBinary(is))
+    {
+        CompactTrace trace;
+        trace.readBinary(is, filename);
+        trace.exportTo(*this);
+        return;
+    }
+    
     TraceBuilder builder;
     
     builder.build(this, is, parser, filename);
@@ -850,14 +872,24 @@ void Trace::read(std::istream& is, const char* filename)
 
 void Trace::read(const char* filename, TraceParser& parser)
 {
-    ifstream is(filename);
+    CompressedIfstream is(filename);
     if(!is)
     {
         cerr << "Failed to open file '" << filename << "' for read trace." << endl;
         throw runtime_error("Cannot open file");
     }
     
-    read(is, parser, filename);
+    try
+    {
+        read(is, parser, filename);
+    }
+    catch(...)
+    {
+        /* Corrupted compressed data is more likely cause of the error. */
+        is.close();
+        throw;
+    }
+    is.close();
 }
 
 void Trace::read(const char* filename)
@@ -866,6 +898,20 @@ void Trace::read(const char* filename)
     read(filename, parser);
 }
 
+void Trace::readMapped(const char* filename)
+{
+    TraceMmapParser parser;
+    TraceBuilder builder;
+    
+    if(builder.build(this, parser, filename)) return;
+    
+    /* Drop partially loaded groups and parse again. */
+    Trace empty;
+    swap(fileGroups, empty.fileGroups);
+    
+    read(filename);
+}
+
 
 /* 
  * Write file information into stream.
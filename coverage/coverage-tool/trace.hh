@@ -33,6 +33,13 @@ struct Trace
 	/* Load trace from file. */
 	void read(const char* filename);
 	void read(const char* filename, TraceParser& parser);
+	/* 
+	 * Load trace from file using 'TraceMmapParser'.
+	 * 
+	 * If that parser fails, trace is reloaded using usual parser,
+	 * which reports errors.
+	 */
+	void readMapped(const char* filename);
 
 	/* Store trace to the stream */
 	void write(std::ostream& os) const;
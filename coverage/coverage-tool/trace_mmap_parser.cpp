@@ -0,0 +1,287 @@
+// trace_mmap_parser.cpp - hand-written parser for the trace file.
+
+//
+//      Copyright (C) 2026, agent <agent@local>
+//      Author:
+//          agent <agent@local>
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; either version 2 of the License, or
+//      (at your option) any later version.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//      MA 02110-1301, USA.
+
+#include "trace_mmap_parser.hh"
+#include "file_mapping.hh"
+
+#include <cstring>
+
+using namespace std;
+
+typedef TraceEventProcessor::counter_t counter_t;
+
+/* Characters classes, same as in trace_scanner.l. */
+static inline bool isDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline bool isAlpha(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'));
+}
+
+static inline bool isIdChar(char c)
+{
+    return isAlpha(c) || isDigit(c) || (c == '_') || (c == '.');
+}
+
+static inline bool isPathChar(char c)
+{
+    return isIdChar(c) || (c == '/') || (c == '@') || (c == '-');
+}
+
+/* Cursor over parameters of one directive. */
+class DirectiveCursor
+{
+public:
+    DirectiveCursor(const char* p, const char* end): p(p), end(end) {}
+
+    bool atEnd(void) const {return p == end;}
+
+    bool skip(char c)
+    {
+        if((p == end) || (*p != c)) return false;
+        ++p;
+        return true;
+    }
+
+    bool number(unsigned long& value)
+    {
+        if((p == end) || !isDigit(*p)) return false;
+
+        value = 0;
+        do
+        {
+            value = value * 10 + (*p - '0');
+        } while((++p != end) && isDigit(*p));
+
+        return true;
+    }
+
+    /* Rest of the directive is an identificator(name of test or function). */
+    bool id(string& value)
+    {
+        if((p == end) || !(isAlpha(*p) || (*p == '_'))) return false;
+
+        const char* start = p;
+        while((++p != end) && isIdChar(*p));
+        if(p != end) return false;
+
+        value.assign(start, p - start);
+        return true;
+    }
+
+    /* Rest of the directive is an absolute path. */
+    bool path(string& value)
+    {
+        if((p == end) || (*p != '/')) return false;
+
+        const char* start = p;
+        while((++p != end) && isPathChar(*p));
+        if(p != end) return false;
+
+        value.assign(start, p - start);
+        return true;
+    }
+
+    /* Directive has exactly one numeric parameter. */
+    bool singleNumber(unsigned long& value)
+    {
+        return number(value) && atEnd();
+    }
+private:
+    const char* p;
+    const char* end;
+};
+
+/* Compare keyword [start, end) with given null-terminated string. */
+static inline bool isKeyword(const char* start, const char* end,
+    const char* keyword, size_t keywordLen)
+{
+    return ((size_t)(end - start) == keywordLen)
+        && (memcmp(start, keyword, keywordLen) == 0);
+}
+
+#define KEYWORD(keyword) isKeyword(keyStart, keyEnd, keyword, sizeof(keyword) - 1)
+
+bool TraceMmapParser::parse(const char* start, const char* end,
+    TraceEventProcessor& ep)
+{
+    /* Where we are in terms of the trace grammar. */
+    enum {STATE_NONE, STATE_TEST, STATE_SOURCE} state = STATE_NONE;
+
+    int traceLine = 0;
+    /* Line of the last directive in the current test. */
+    int testEndLine = 0;
+
+    const char* lineStart = start;
+    while(lineStart != end)
+    {
+        const char* lineEnd = (const char*)memchr(lineStart, '\n', end - lineStart);
+        if(!lineEnd) lineEnd = end;
+
+        traceLine++;
+
+        const char* keyStart = lineStart;
+        lineStart = (lineEnd != end) ? lineEnd + 1 : end;
+
+        if(keyStart == lineEnd) continue; /* Empty line */
+
+        const char* keyEnd = keyStart;
+        while((keyEnd != lineEnd) && (*keyEnd != ':')) ++keyEnd;
+
+        /* 'end_of_record' is the only directive without parameters. */
+        if(keyEnd == lineEnd)
+        {
+            if(!KEYWORD("end_of_record") || (state != STATE_SOURCE))
+                return false;
+
+            ep.onSourceEnd(traceLine);
+            state = STATE_TEST;
+            testEndLine = traceLine;
+            continue;
+        }
+
+        DirectiveCursor d(keyEnd + 1, lineEnd);
+        unsigned long n1, n2, n3, n4;
+
+        if(KEYWORD("TN"))
+        {
+            if(state == STATE_SOURCE) return false;
+            if(state == STATE_TEST) ep.onTestEnd(testEndLine);
+
+            if(d.atEnd()) name.clear();
+            else if(!d.id(name)) return false;
+
+            ep.onTestStart(name, traceLine);
+            state = STATE_TEST;
+            testEndLine = traceLine;
+            continue;
+        }
+        else if(KEYWORD("SF"))
+        {
+            if((state != STATE_TEST) || !d.path(name)) return false;
+
+            ep.onSourceStart(name, traceLine);
+            state = STATE_SOURCE;
+            testEndLine = traceLine;
+            continue;
+        }
+
+        /* All other directives are inside source. */
+        if(state != STATE_SOURCE) return false;
+        testEndLine = traceLine;
+
+        /* Most frequent directives are checked first. */
+        if(KEYWORD("DA"))
+        {
+            if(!d.number(n1) || !d.skip(',')) return false;
+            if(d.skip('-'))
+            {
+                /* Negative line counter. Assume it to be zero. */
+                if(!d.singleNumber(n2)) return false;
+                n2 = 0;
+            }
+            else if(!d.singleNumber(n2)) return false;
+
+            ep.onLineCounter(n1, n2, traceLine);
+        }
+        else if(KEYWORD("BRDA"))
+        {
+            if(!d.number(n1) || !d.skip(',') || !d.number(n2) || !d.skip(',')
+                || !d.number(n3) || !d.skip(','))
+                return false;
+
+            if(d.skip('-'))
+            {
+                if(!d.atEnd()) return false;
+                ep.onBranchNotCovered(n1, n2, n3, traceLine);
+            }
+            else
+            {
+                if(!d.singleNumber(n4)) return false;
+                ep.onBranchCoverage(n1, n2, n3, n4, traceLine);
+            }
+        }
+        else if(KEYWORD("FN"))
+        {
+            if(!d.number(n1) || !d.skip(',') || !d.id(name)) return false;
+            ep.onFunction(name, n1, traceLine);
+        }
+        else if(KEYWORD("FNDA"))
+        {
+            if(!d.number(n1) || !d.skip(',') || !d.id(name)) return false;
+            ep.onFunctionCounter(name, n1, traceLine);
+        }
+        else if(KEYWORD("LF"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onLinesTotal(n1, traceLine);
+        }
+        else if(KEYWORD("LH"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onLinesTotalHit(n1, traceLine);
+        }
+        else if(KEYWORD("BRF"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onBranchesTotal(n1, traceLine);
+        }
+        else if(KEYWORD("BRH"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onBranchesTotalHit(n1, traceLine);
+        }
+        else if(KEYWORD("FNF"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onFunctionsTotal(n1, traceLine);
+        }
+        else if(KEYWORD("FNH"))
+        {
+            if(!d.singleNumber(n1)) return false;
+            ep.onFunctionsTotalHit(n1, traceLine);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    /* Source without 'end_of_record' is an error. */
+    if(state == STATE_SOURCE) return false;
+    if(state == STATE_TEST) ep.onTestEnd(testEndLine);
+
+    return true;
+}
+
+#undef KEYWORD
+
+bool TraceMmapParser::parse(const char* filename, TraceEventProcessor& ep)
+{
+    FileMapping mapping;
+    if(!mapping.map(filename)) return false;
+
+    return parse(mapping.begin(), mapping.end(), ep);
+}
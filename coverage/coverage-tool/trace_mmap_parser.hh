@@ -0,0 +1,51 @@
+/*
+ * Hand-written parser for trace files, generated by lcov.
+ *
+ * Unlike 'TraceParser', it doesn't use scanner and streams: file is
+ * mapped into memory and records are scanned directly from the mapped
+ * buffer. Names are passed to the event processor through the single
+ * reused string, numbers are converted in place.
+ *
+ * Parser doesn't report errors. Instead, on any unexpected input it
+ * simply stops and returns false. In that case caller is expected to
+ * reparse the trace with 'TraceParser', which produces normal error
+ * messages.
+ */
+#ifndef TRACE_MMAP_PARSER_HH
+#define TRACE_MMAP_PARSER_HH
+
+#include "trace_parser.hh"
+
+#include <string>
+
+class TraceMmapParser
+{
+public:
+    TraceMmapParser() {}
+
+    /*
+     * Parse file, calling corresponded callback functions of
+     * eventProcessor when needed.
+     *
+     * Return true on success. Return false if file cannot be mapped
+     * (e.g., it is not a regular file) or it is malformed.
+     * Some events may be already delivered to the processor in the
+     * last case.
+     *
+     * Exceptions thrown by the event processor are propagated.
+     */
+    bool parse(const char* filename, TraceEventProcessor& eventProcessor);
+
+    /* Same but for trace already in memory. */
+    bool parse(const char* start, const char* end,
+        TraceEventProcessor& eventProcessor);
+private:
+    /* Not copiable and assignable */
+    TraceMmapParser(const TraceMmapParser& parser);
+    TraceMmapParser& operator=(const TraceMmapParser& parser);
+
+    /* Reused buffer for names passed to the event processor. */
+    std::string name;
+};
+
+#endif /* TRACE_MMAP_PARSER_HH */
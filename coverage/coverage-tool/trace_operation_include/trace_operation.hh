@@ -62,4 +62,61 @@ public:
     virtual counter_t counterOperation(const std::vector<counter_t>& operands) = 0;
 };
 
+/*
+ * Batch interface of the operation.
+ * 
+ * Instead of one call per object, operation is called once per file for
+ * every kind of objects(functions, lines, branches) with counters of all
+ * objects of that kind, which exist at least in one trace.
+ * 
+ * 'operands' contains 'n' columns, one per trace, each with 'count'
+ * counters: operands[i][k] is the counter of k-th object in i-th trace.
+ * Counters are encoded as for TraceOperation, so -1 in the column marks
+ * that object is absent in the trace.
+ * 
+ * 'result' should be filled with 'count' counters for the resulted
+ * trace, -1 means that object shouldn't be present in it.
+ * 
+ * Columns are contiguous arrays, so simple loops over them may be
+ * vectorized by the compiler.
+ */
+class TraceOperationBatch
+{
+public:
+    virtual ~TraceOperationBatch() {}
+    
+    typedef TraceOperation::counter_t counter_t;
+    
+    virtual void lineOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result) = 0;
+    virtual void functionOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result) = 0;
+    virtual void branchOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result) = 0;
+};
+
+/* Batch operation which affect on all types of counters in same fashion. */
+class TraceOperationBatchUnified: public TraceOperationBatch
+{
+public:
+    virtual void lineOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result)
+    {
+        counterOperation(operands, n, count, result);
+    }
+    virtual void functionOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result)
+    {
+        counterOperation(operands, n, count, result);
+    }
+    virtual void branchOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result)
+    {
+        counterOperation(operands, n, count, result);
+    }
+    
+    virtual void counterOperation(const counter_t* const* operands, int n,
+        int count, counter_t* result) = 0;
+};
+
 #endif /* TRACE_OPERATION_HH_INCLUDE */